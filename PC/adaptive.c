@@ -0,0 +1,84 @@
+//
+// Adaptive ordering of a sequence of checks.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "adaptive.h"
+
+struct adaptive_rank {
+    double rate;
+    size_t position;
+};
+
+// Decreasing rate, then increasing position so that ties keep their order:
+static int compare_ranks(const void *a, const void *b) {
+    const struct adaptive_rank *rank_a = a;
+    const struct adaptive_rank *rank_b = b;
+    if (rank_a->rate != rank_b->rate) {
+        return rank_a->rate < rank_b->rate ? 1 : -1;
+    }
+    return (rank_a->position > rank_b->position) - (rank_a->position < rank_b->position);
+}
+
+/**
+ * Start with the checks in their natural order.
+ * Returns 0 on success, -1 if memory is exhausted.
+ */
+int adaptive_order_init(adaptive_order *o, size_t count) {
+    o->count = count;
+    o->order = malloc(count * sizeof(*o->order) + 1);
+    o->rejects = calloc(count + 1, sizeof(*o->rejects));
+    o->passes = 0;
+    o->ranks = malloc(count * sizeof(*o->ranks) + 1);
+    o->scratch = malloc(count * sizeof(*o->scratch) + 1);
+    if (!o->order || !o->rejects || !o->ranks || !o->scratch) {
+        adaptive_order_free(o);
+        return -1;
+    }
+    for (size_t p=0; p<count; p++) {
+        o->order[p] = p;
+    }
+    return 0;
+}
+
+/**
+ * Sort the positions by decreasing rejection rate, and reset the counts.
+ * If permutation isn't NULL, it receives the old position of the check now
+ * at each position, so that the caller can reorder its own data the same way.
+ */
+void adaptive_order_update(adaptive_order *o, size_t *permutation) {
+    // Position p is tested by the keys rejected at p or after, and the passes:
+    uint64_t tests = o->passes;
+    for (size_t p=o->count; p-->0; ) {
+        tests += o->rejects[p];
+        o->ranks[p].rate = tests ? (double) o->rejects[p] / tests : 0;
+        o->ranks[p].position = p;
+    }
+    qsort(o->ranks, o->count, sizeof(*o->ranks), compare_ranks);
+
+    for (size_t i=0; i<o->count; i++) {
+        o->scratch[i] = o->order[o->ranks[i].position];
+    }
+    memcpy(o->order, o->scratch, o->count * sizeof(*o->order));
+    if (permutation) {
+        for (size_t i=0; i<o->count; i++) {
+            permutation[i] = o->ranks[i].position;
+        }
+    }
+
+    memset(o->rejects, 0, o->count * sizeof(*o->rejects));
+    o->passes = 0;
+}
+
+void adaptive_order_free(adaptive_order *o) {
+    free(o->order);
+    free(o->rejects);
+    free(o->ranks);
+    free(o->scratch);
+    o->order = NULL;
+    o->rejects = NULL;
+    o->ranks = NULL;
+    o->scratch = NULL;
+}
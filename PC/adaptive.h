@@ -0,0 +1,34 @@
+//
+// Adaptive ordering of a sequence of checks, so that the most selective ones
+// run first and a rejected key costs as little work as possible.
+//
+// The hot loop only counts, for each position, how many times the check at
+// that position rejected a key. The rejection rate of a position is derived
+// from these counts when reordering: it is tested by every key that passed
+// the previous positions. Each search thread has its own orders, so nothing
+// is shared.
+//
+
+#ifndef __ADAPTIVE_H
+#define __ADAPTIVE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+    size_t count;
+    // order[p]: index of the check run at position p.
+    size_t *order;
+    // Rejections at each position, and full passes, since the last update.
+    uint64_t *rejects;
+    uint64_t passes;
+    // Scratch space for the updates.
+    struct adaptive_rank *ranks;
+    size_t *scratch;
+} adaptive_order;
+
+int adaptive_order_init(adaptive_order *o, size_t count);
+void adaptive_order_update(adaptive_order *o, size_t *permutation);
+void adaptive_order_free(adaptive_order *o);
+
+#endif
@@ -0,0 +1,409 @@
+//
+// Search of the prepared keys of many meters in a single sweep.
+//
+// Same scheduling as search.c: the workers take chunks of SEARCH_CHUNK_SIZE
+// Gray code indexes from an atomic cursor, and publish their statistics once
+// per chunk.
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "batch.h"
+#include "stats.h"
+
+typedef struct {
+    batch_search *batch;
+    gray_keystream basis[32];
+    stats_counters *stats;
+} batch_worker;
+
+// Byte 0 of keystream(prepared key) that decodes the check byte of a frame:
+static uint8_t check_bucket(const gray_keystream *target) {
+    return (uint8_t)(target->low ^ 0x4B);
+}
+
+static int compare_keys(const void *a, const void *b) {
+    uint32_t key_a = *(const uint32_t *) a;
+    uint32_t key_b = *(const uint32_t *) b;
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+// Reduce the frames of a captured meter to what the sweep needs. Returns 0 on
+// success, 1 if no frame is left once the header constraints are applied, -1
+// if memory is exhausted.
+static int prepare_meter(batch_meter *meter, const capture_group *group, const payload_constraints *constraints) {
+    meter->meter_id = group->meter_id;
+    meter->targets = NULL;
+    meter->keys = NULL;
+    meter->key_count = 0;
+    atomic_init(&meter->candidates, NULL);
+    if (frame_set_prepare(&meter->set, (const uint8_t (*)[FRAME_LEN]) group->frames, group->count) != 0) {
+        return -1;
+    }
+    frame_set_retain(&meter->set, frame_header_plausible, constraints);
+    if (meter->set.count == 0) {
+        frame_set_free(&meter->set);
+        return 1;
+    }
+    if (constraints->monotonic && constraints->access_offset >= 0 && frame_set_sort_by_access(&meter->set, constraints->access_offset) != 0) {
+        frame_set_free(&meter->set);
+        return -1;
+    }
+
+    meter->targets = malloc(meter->set.count * sizeof(gray_keystream));
+    if (!meter->targets) {
+        frame_set_free(&meter->set);
+        return -1;
+    }
+    meter->consistent = 1;
+    for (size_t f=0; f<meter->set.count; f++) {
+        gray_prepare_frame(&meter->targets[f], &meter->set.records[f]);
+        if (check_bucket(&meter->targets[f]) != check_bucket(&meter->targets[0])) {
+            meter->consistent = 0;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Prepare the search of the keys of all the meters of a capture. The frames
+ * of each meter are deduplicated and filtered by the header constraints;
+ * meters without any frame left are dropped.
+ * Returns 0 on success, -1 if memory is exhausted.
+ */
+int batch_init(batch_search *batch, const capture *cap, const payload_constraints *constraints) {
+    memset(batch, 0, sizeof(*batch));
+    batch->constraints = constraints;
+    atomic_init(&batch->next_chunk, 0);
+    atomic_init(&batch->stop, 0);
+    batch->meters = malloc(cap->group_count * sizeof(batch_meter) + 1);
+    batch->bucket_entries = malloc(cap->group_count * sizeof(batch_entry) + 1);
+    if (!batch->meters || !batch->bucket_entries) {
+        batch_free(batch);
+        return -1;
+    }
+
+    for (size_t g=0; g<cap->group_count; g++) {
+        int result = prepare_meter(&batch->meters[batch->meter_count], &cap->groups[g], constraints);
+        if (result < 0) {
+            batch_free(batch);
+            return -1;
+        }
+        if (result == 0) {
+            batch->meter_count++;
+        }
+    }
+
+    // The decoded bits fixed by the constraints, as a keystream mask and the
+    // values of the bits:
+    gf2_known_bit known_bits[8 * FRAME_PAYLOAD_LEN];
+    size_t known_count = gf2_known_bits_from_constraints(constraints, known_bits);
+    gray_keystream known_values = {0, 0};
+    for (size_t k=0; k<known_count; k++) {
+        unsigned bit = 8 * known_bits[k].byte + known_bits[k].bit;
+        if (bit < 64) {
+            batch->known_mask.low |= (uint64_t) 1 << bit;
+            known_values.low |= (uint64_t) known_bits[k].value << bit;
+        } else {
+            batch->known_mask.high |= (uint32_t) 1 << (bit - 64);
+            known_values.high |= (uint32_t) known_bits[k].value << (bit - 64);
+        }
+    }
+
+    // Counting sort of the consistent meters by bucket:
+    for (size_t m=0; m<batch->meter_count; m++) {
+        if (batch->meters[m].consistent) {
+            batch->bucket_start[check_bucket(&batch->meters[m].targets[0]) + 1]++;
+        }
+    }
+    for (int b=0; b<256; b++) {
+        batch->bucket_start[b + 1] += batch->bucket_start[b];
+    }
+    size_t next[256];
+    memcpy(next, batch->bucket_start, sizeof(next));
+    for (size_t m=0; m<batch->meter_count; m++) {
+        if (batch->meters[m].consistent) {
+            const gray_keystream *target = &batch->meters[m].targets[0];
+            batch_entry *entry = &batch->bucket_entries[next[check_bucket(target)]++];
+            entry->expected.low = (target->low ^ known_values.low) & batch->known_mask.low;
+            entry->expected.high = (target->high ^ known_values.high) & batch->known_mask.high;
+            entry->meter = m;
+        }
+    }
+    return 0;
+}
+
+// Add a prepared key to the list of a meter, without locking.
+static void push_candidate(batch_meter *meter, uint32_t prepared_key) {
+    search_candidate *candidate = malloc(sizeof(*candidate));
+    if (!candidate) {
+        perror("malloc");
+        exit(2);
+    }
+    candidate->prepared_key = prepared_key;
+    candidate->next = atomic_load_explicit(&meter->candidates, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&meter->candidates, &candidate->next, candidate, memory_order_release, memory_order_relaxed)) {
+    }
+}
+
+// Whether keystream(prepared key) decodes all the frames of a meter. The
+// check byte of the frames is already known to decode.
+static int meter_decodes(const batch_search *batch, const batch_meter *meter, const gray_keystream *stream, uint32_t prepared_key) {
+    for (size_t f=0; f<meter->set.count; f++) {
+        uint64_t low = stream->low ^ meter->targets[f].low;
+        uint32_t high = stream->high ^ meter->targets[f].high;
+        uint8_t decoded_frame[FRAME_PAYLOAD_LEN];
+        for (int j=0; j<8; j++) {
+            decoded_frame[j] = (uint8_t)(low >> (8 * j));
+        }
+        for (int j=8; j<FRAME_PAYLOAD_LEN; j++) {
+            decoded_frame[j] = (uint8_t)(high >> (8 * (j - 8)));
+        }
+        if (!payload_plausible(batch->constraints, decoded_frame)) {
+            return 0;
+        }
+    }
+    return payload_sequence_plausible(batch->constraints, (const uint8_t (*)[FRAME_LEN]) meter->set.frames, meter->set.count, prepared_key);
+}
+
+// Try the keys gray(first) .. gray(end - 1) against the meters of their bucket.
+// Returns the number of candidates found.
+static uint64_t batch_range(batch_worker *worker, uint64_t first, uint64_t end) {
+    batch_search *batch = worker->batch;
+    uint64_t found = 0;
+
+    uint32_t prepared_key = (uint32_t)(first ^ (first >> 1));
+    gray_keystream stream = {0, 0};
+    for (int b=0; b<32; b++) {
+        if ((prepared_key >> b) & 1) {
+            stream.low ^= worker->basis[b].low;
+            stream.high ^= worker->basis[b].high;
+        }
+    }
+
+    for (uint64_t i=first; ; ) {
+        uint8_t bucket = (uint8_t) stream.low;
+        gray_keystream known = {stream.low & batch->known_mask.low, stream.high & batch->known_mask.high};
+        for (size_t n=batch->bucket_start[bucket]; n<batch->bucket_start[bucket + 1]; n++) {
+            const batch_entry *entry = &batch->bucket_entries[n];
+            if (((known.low ^ entry->expected.low) | (known.high ^ entry->expected.high)) != 0) {
+                continue;
+            }
+            batch_meter *meter = &batch->meters[entry->meter];
+            if (meter_decodes(batch, meter, &stream, prepared_key)) {
+                push_candidate(meter, prepared_key);
+                found++;
+            }
+        }
+
+        if (++i >= end) {
+            break;
+        }
+        int b = __builtin_ctzll(i);
+        prepared_key ^= (uint32_t) 1 << b;
+        stream.low ^= worker->basis[b].low;
+        stream.high ^= worker->basis[b].high;
+    }
+    return found;
+}
+
+static void *batch_worker_main(void *arg) {
+    batch_worker *worker = arg;
+    batch_search *batch = worker->batch;
+
+    while (!atomic_load_explicit(&batch->stop, memory_order_relaxed)) {
+        uint64_t chunk = atomic_fetch_add_explicit(&batch->next_chunk, 1, memory_order_relaxed);
+        if (chunk >= SEARCH_KEY_CHUNKS) {
+            break;
+        }
+        uint64_t first = chunk * SEARCH_CHUNK_SIZE;
+        uint64_t found = batch_range(worker, first, first + SEARCH_CHUNK_SIZE);
+        if (found) {
+            stats_add(&worker->stats->candidates, found);
+        }
+        stats_add(&worker->stats->keys, SEARCH_CHUNK_SIZE);
+    }
+    return NULL;
+}
+
+/**
+ * Make the workers stop after their current chunk. Async-signal-safe.
+ */
+void batch_stop(batch_search *batch) {
+    atomic_store_explicit(&batch->stop, 1, memory_order_relaxed);
+}
+
+// Move the candidates of a meter to its sorted array of keys.
+static int collect_keys(batch_meter *meter) {
+    search_candidate *list = atomic_exchange(&meter->candidates, NULL);
+    size_t count = 0;
+    for (search_candidate *c=list; c; c=c->next) {
+        count++;
+    }
+    uint32_t *keys = realloc(meter->keys, (meter->key_count + count) * sizeof(*keys) + 1);
+    if (!keys) {
+        search_free_candidates(list);
+        return -1;
+    }
+    meter->keys = keys;
+    for (search_candidate *c=list; c; c=c->next) {
+        meter->keys[meter->key_count++] = c->prepared_key;
+    }
+    search_free_candidates(list);
+    qsort(meter->keys, meter->key_count, sizeof(*meter->keys), compare_keys);
+    return 0;
+}
+
+/**
+ * Sweep all the prepared keys on thread_count threads, and report the
+ * statistics every report_interval seconds until it completes. The keys of
+ * each meter are then in its keys array.
+ * Returns 0 on success, -1 if the threads could not be started.
+ */
+int batch_run(batch_search *batch, unsigned thread_count, unsigned report_interval) {
+    batch_worker *workers = calloc(thread_count, sizeof(*workers));
+    pthread_t *threads = calloc(thread_count, sizeof(*threads));
+    stats_counters *stats = stats_alloc(thread_count);
+    if (!workers || !threads || !stats) {
+        perror("calloc");
+        return -1;
+    }
+    for (unsigned t=0; t<thread_count; t++) {
+        workers[t].batch = batch;
+        gray_prepare_basis(workers[t].basis);
+        workers[t].stats = &stats[t];
+    }
+
+    stats_reporter reporter = {
+        .counters = stats,
+        .counter_count = thread_count,
+        .key_name = "prepared keys",
+        .total_keys = 1ULL << 32,
+        .interval = report_interval,
+        .json = batch->json_stats,
+    };
+    if (stats_reporter_start(&reporter) != 0) {
+        return -1;
+    }
+
+    unsigned started = 0;
+    for (; started<thread_count; started++) {
+        if (pthread_create(&threads[started], NULL, batch_worker_main, &workers[started]) != 0) {
+            fprintf(stderr, "Cannot start search thread %u\n", started);
+            break;
+        }
+    }
+    for (unsigned t=0; t<started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    stats_reporter_stop(&reporter);
+    stats_sample sample;
+    stats_sample_all(stats, thread_count, &sample);
+    stats_report(&reporter, &sample, 1);
+
+    int result = started == thread_count ? 0 : -1;
+    for (size_t m=0; m<batch->meter_count; m++) {
+        if (collect_keys(&batch->meters[m]) != 0) {
+            perror("collect_keys");
+            result = -1;
+        }
+    }
+    free(workers);
+    free(threads);
+    free(stats);
+    return result;
+}
+
+typedef struct {
+    uint32_t prepared_key;
+    uint32_t meter_id;
+} key_meter;
+
+static int compare_key_meters(const void *a, const void *b) {
+    const key_meter *x = a;
+    const key_meter *y = b;
+    if (x->prepared_key != y->prepared_key) {
+        return (x->prepared_key > y->prepared_key) - (x->prepared_key < y->prepared_key);
+    }
+    return (x->meter_id > y->meter_id) - (x->meter_id < y->meter_id);
+}
+
+/**
+ * Find the prepared keys that decode more than one meter, sorted by key, each
+ * with its meter ids in increasing order. The array is to be freed with
+ * batch_free_shared_keys().
+ * Returns the number of shared keys, or (size_t) -1 if memory is exhausted.
+ */
+size_t batch_shared_keys(const batch_search *batch, batch_shared_key **shared) {
+    size_t pair_count = 0;
+    for (size_t m=0; m<batch->meter_count; m++) {
+        pair_count += batch->meters[m].key_count;
+    }
+    key_meter *pairs = malloc(pair_count * sizeof(*pairs) + 1);
+    *shared = malloc(pair_count / 2 * sizeof(**shared) + 1);
+    if (!pairs || !*shared) {
+        free(pairs);
+        free(*shared);
+        return (size_t) -1;
+    }
+    pair_count = 0;
+    for (size_t m=0; m<batch->meter_count; m++) {
+        for (size_t k=0; k<batch->meters[m].key_count; k++) {
+            pairs[pair_count].prepared_key = batch->meters[m].keys[k];
+            pairs[pair_count].meter_id = batch->meters[m].meter_id;
+            pair_count++;
+        }
+    }
+    qsort(pairs, pair_count, sizeof(*pairs), compare_key_meters);
+
+    size_t count = 0;
+    for (size_t i=0; i<pair_count; ) {
+        size_t run = 1;
+        while (i + run < pair_count && pairs[i + run].prepared_key == pairs[i].prepared_key) {
+            run++;
+        }
+        if (run > 1) {
+            batch_shared_key *key = &(*shared)[count];
+            key->prepared_key = pairs[i].prepared_key;
+            key->meter_count = run;
+            key->meter_ids = malloc(run * sizeof(*key->meter_ids));
+            if (!key->meter_ids) {
+                batch_free_shared_keys(*shared, count);
+                free(pairs);
+                return (size_t) -1;
+            }
+            for (size_t j=0; j<run; j++) {
+                key->meter_ids[j] = pairs[i + j].meter_id;
+            }
+            count++;
+        }
+        i += run;
+    }
+    free(pairs);
+    return count;
+}
+
+void batch_free_shared_keys(batch_shared_key *shared, size_t count) {
+    for (size_t i=0; i<count; i++) {
+        free(shared[i].meter_ids);
+    }
+    free(shared);
+}
+
+void batch_free(batch_search *batch) {
+    for (size_t m=0; m<batch->meter_count; m++) {
+        frame_set_free(&batch->meters[m].set);
+        free(batch->meters[m].targets);
+        free(batch->meters[m].keys);
+        search_free_candidates(atomic_exchange(&batch->meters[m].candidates, NULL));
+    }
+    free(batch->meters);
+    free(batch->bucket_entries);
+    memset(batch, 0, sizeof(*batch));
+}
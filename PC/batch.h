@@ -0,0 +1,87 @@
+//
+// Search of the prepared keys of many meters in a single sweep.
+//
+// The keystream is linear in the seed (see gray.h): the decoded payload of a
+// frame is target ^ keystream(prepared key), whatever the meter. The sweep
+// enumerates the prepared keys once, in Gray code order, and every meter
+// tries the same keystream against its own targets.
+//
+// Byte 0 of keystream(prepared key) must decode the check byte of every frame
+// of a meter, so it is the same for all of them. The meters are bucketed by
+// that byte: a key is only tried against the meters of its bucket, 1/256 of
+// them on average. A meter whose frames need different bytes can't be decoded
+// by a single key, and is left out of the sweep.
+//
+// The bits of the decoded payloads the constraints fix (see
+// gf2_known_bits_from_constraints()) then filter the meters of the bucket
+// with a couple of masked XORs on their first frame, before decoding them.
+//
+
+#ifndef __BATCH_H
+#define __BATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include "capture.h"
+#include "search.h"
+#include "gray.h"
+#include "gf2_solver.h"
+
+typedef struct {
+    uint32_t meter_id;
+    frame_set set;
+    gray_keystream *targets;
+    // Zero if the check bytes of its frames already rule out every key.
+    int consistent;
+
+    // The prepared keys that decode all its frames, found by the workers,
+    // then sorted into keys once batch_run() returns.
+    _Atomic(search_candidate *) candidates;
+    uint32_t *keys;
+    size_t key_count;
+} batch_meter;
+
+// A meter in its bucket: the keystream bits its first frame needs where the
+// decoded bits are known, the others being 0.
+typedef struct {
+    gray_keystream expected;
+    size_t meter;
+} batch_entry;
+
+// State shared by all the workers of a batch search.
+typedef struct batch_search {
+    batch_meter *meters;
+    size_t meter_count;
+    const payload_constraints *constraints;
+
+    // The consistent meters whose byte 0 of keystream(prepared key) must be
+    // b: bucket_entries[bucket_start[b] .. bucket_start[b + 1]), and the
+    // keystream bits their entries give.
+    size_t bucket_start[257];
+    batch_entry *bucket_entries;
+    gray_keystream known_mask;
+
+    // Scheduling: index of the next chunk of Gray code indexes to hand out.
+    atomic_uint_fast64_t next_chunk;
+    // Set to make the workers stop after their current chunk.
+    atomic_int stop;
+    int json_stats;
+} batch_search;
+
+// A prepared key and the meters it decodes, more than one.
+typedef struct {
+    uint32_t prepared_key;
+    uint32_t *meter_ids;
+    size_t meter_count;
+} batch_shared_key;
+
+int batch_init(batch_search *batch, const capture *cap, const payload_constraints *constraints);
+void batch_stop(batch_search *batch);
+int batch_run(batch_search *batch, unsigned thread_count, unsigned report_interval);
+size_t batch_shared_keys(const batch_search *batch, batch_shared_key **shared);
+void batch_free_shared_keys(batch_shared_key *shared, size_t count);
+void batch_free(batch_search *batch);
+
+#endif
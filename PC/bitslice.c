@@ -0,0 +1,106 @@
+//
+// Bit-sliced trial of a batch of prepared keys, with a portable 64 lane kernel
+// and AVX2/AVX-512 kernels selected at runtime on x86 hosts.
+//
+
+#include <string.h>
+
+#include "bitslice.h"
+
+// Bit k of the index of each lane: row k holds the words of the lane vector.
+static const uint64_t bs_lane_patterns[9][8] = {
+#define BS_REPEAT8(word) {word, word, word, word, word, word, word, word}
+    BS_REPEAT8(0xAAAAAAAAAAAAAAAAULL),
+    BS_REPEAT8(0xCCCCCCCCCCCCCCCCULL),
+    BS_REPEAT8(0xF0F0F0F0F0F0F0F0ULL),
+    BS_REPEAT8(0xFF00FF00FF00FF00ULL),
+    BS_REPEAT8(0xFFFF0000FFFF0000ULL),
+    BS_REPEAT8(0xFFFFFFFF00000000ULL),
+#undef BS_REPEAT8
+    {0, ~0ULL, 0, ~0ULL, 0, ~0ULL, 0, ~0ULL},
+    {0, 0, ~0ULL, ~0ULL, 0, 0, ~0ULL, ~0ULL},
+    {0, 0, 0, 0, ~0ULL, ~0ULL, ~0ULL, ~0ULL},
+};
+
+// Portable kernel: 64 lanes in a uint64_t.
+#define BS_VEC uint64_t
+#define BS_WORDS 1
+#define BS_LOG2_LANES 6
+#define BS_SUFFIX _64
+#define BS_TARGET
+#include "bitslice_kernel.h"
+#undef BS_VEC
+#undef BS_WORDS
+#undef BS_LOG2_LANES
+#undef BS_SUFFIX
+#undef BS_TARGET
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BITSLICE_X86
+
+// AVX2 kernel: 256 lanes.
+typedef uint64_t bs_vec256 __attribute__((vector_size(32)));
+#define BS_VEC bs_vec256
+#define BS_WORDS 4
+#define BS_LOG2_LANES 8
+#define BS_SUFFIX _256
+#define BS_TARGET __attribute__((target("avx2")))
+#include "bitslice_kernel.h"
+#undef BS_VEC
+#undef BS_WORDS
+#undef BS_LOG2_LANES
+#undef BS_SUFFIX
+#undef BS_TARGET
+
+// AVX-512 kernel: 512 lanes.
+typedef uint64_t bs_vec512 __attribute__((vector_size(64)));
+#define BS_VEC bs_vec512
+#define BS_WORDS 8
+#define BS_LOG2_LANES 9
+#define BS_SUFFIX _512
+#define BS_TARGET __attribute__((target("avx512f")))
+#include "bitslice_kernel.h"
+#undef BS_VEC
+#undef BS_WORDS
+#undef BS_LOG2_LANES
+#undef BS_SUFFIX
+#undef BS_TARGET
+#endif
+
+// From the widest to the narrowest:
+static const bitslice_kernel kernels[] = {
+#ifdef BITSLICE_X86
+    {"avx512", 512, bs_trial_512},
+    {"avx2", 256, bs_trial_256},
+#endif
+    {"uint64", 64, bs_trial_64},
+};
+
+static int kernel_supported(const bitslice_kernel *kernel) {
+#ifdef BITSLICE_X86
+    __builtin_cpu_init();
+    if (kernel->trial == bs_trial_512) {
+        return __builtin_cpu_supports("avx512f");
+    }
+    if (kernel->trial == bs_trial_256) {
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+    return 1;
+}
+
+/**
+ * Get the kernel with the given name, or the widest one the CPU supports if
+ * name is NULL. Returns NULL if the kernel is unknown or not supported.
+ */
+const bitslice_kernel *bitslice_select(const char *name) {
+    for (size_t i=0; i<sizeof(kernels) / sizeof(kernels[0]); i++) {
+        if (name && strcmp(name, kernels[i].name) != 0) {
+            continue;
+        }
+        if (kernel_supported(&kernels[i])) {
+            return &kernels[i];
+        }
+    }
+    return NULL;
+}
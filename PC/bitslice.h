@@ -0,0 +1,35 @@
+//
+// Bit-sliced trial of a batch of prepared keys.
+//
+// The 32 bits of the LFSR are stored in 32 words, bit i of each word belonging
+// to the i-th key of the batch. A LFSR step is then 3 XORs for the whole batch,
+// whatever its size: 64 keys with uint64_t words, 256 with AVX2, 512 with AVX-512.
+//
+
+#ifndef __BITSLICE_H
+#define __BITSLICE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "search.h"
+
+// Try the keys [base, base + lanes) against all the frames, base being a
+// multiple of lanes. Bit i of survivors is set if key base + i passes all the
+// checks. Returns 0 if no key passes, after counting the frame that rejected
+// the last lanes in frame_rejects. The lanes each instruction of the
+// constraints rejects are added to op_rejects.
+typedef int (*bitslice_trial)(const frame_record *frames, size_t frame_count, const payload_constraints *constraints, uint32_t base, uint64_t *survivors, uint64_t *frame_rejects, uint64_t *op_rejects);
+
+typedef struct bitslice_kernel {
+    const char *name;
+    unsigned lanes;
+    bitslice_trial trial;
+} bitslice_kernel;
+
+#define BITSLICE_MAX_LANES 512
+
+void bitslice_prepare_frame(frame_record *out, const uint8_t *frame);
+const bitslice_kernel *bitslice_select(const char *name);
+
+#endif
@@ -0,0 +1,181 @@
+//
+// Body of a bit-sliced kernel, included by bitslice.c once per word type.
+// Expects BS_VEC (the word type), BS_WORDS (its number of uint64_t),
+// BS_LOG2_LANES, BS_SUFFIX and BS_TARGET (function attributes) to be defined.
+//
+
+#define BS_CAT2(a, b) a##b
+#define BS_CAT(a, b) BS_CAT2(a, b)
+#define BS_FN(name) BS_CAT(name, BS_SUFFIX)
+
+// All lanes to 0, all lanes to 1, and bit 0 of x to all lanes:
+#define BS_ZERO ((BS_VEC){0})
+#define BS_ONES (~(BS_VEC){0})
+#define BS_BROADCAST(x) (BS_ZERO - (uint64_t)((x) & 1))
+
+// Number of generated bits: y[0..31] is the seed, y[32 + t] the output of step t.
+#define BS_STREAM_LEN (32 + 8 * FRAME_PAYLOAD_LEN)
+// Bit k of the i-th keystream byte:
+#define BS_KEYSTREAM(y, i, k) ((y)[39 + 8 * (i) - (k)])
+
+BS_TARGET static int BS_FN(bs_any)(BS_VEC v) {
+    uint64_t words[BS_WORDS];
+    memcpy(words, &v, sizeof(words));
+    uint64_t any = 0;
+    for (int w=0; w<BS_WORDS; w++) {
+        any |= words[w];
+    }
+    return any != 0;
+}
+
+BS_TARGET static uint64_t BS_FN(bs_count)(BS_VEC v) {
+    uint64_t words[BS_WORDS];
+    memcpy(words, &v, sizeof(words));
+    uint64_t count = 0;
+    for (int w=0; w<BS_WORDS; w++) {
+        count += __builtin_popcountll(words[w]);
+    }
+    return count;
+}
+
+// Load the seed (prepared key ^ header key) of every lane into y[0..31].
+BS_TARGET static void BS_FN(bs_load_seed)(BS_VEC *y, const BS_VEC *lane_bits, uint32_t seed) {
+    for (int k=0; k<32; k++) {
+        BS_VEC bit = BS_BROADCAST(seed >> k);
+        if (k < BS_LOG2_LANES) {
+            bit ^= lane_bits[k];
+        }
+        // Bit k of the LFSR is the (31 - k)-th oldest one:
+        y[31 - k] = bit;
+    }
+}
+
+// Run the LFSR for steps steps: new bit = bit 1 ^ bit 2 ^ bit 11 ^ bit 31.
+BS_TARGET static void BS_FN(bs_run_lfsr)(BS_VEC *y, int steps) {
+    for (int t=0; t<steps; t++) {
+        y[32 + t] = y[30 + t] ^ y[29 + t] ^ y[20 + t] ^ y[t];
+    }
+}
+
+// Lanes where the n bit value a is lower or equal to b:
+BS_TARGET static BS_VEC BS_FN(bs_le)(const BS_VEC *a, const BS_VEC *b, int n) {
+    BS_VEC lt = BS_ZERO;
+    BS_VEC eq = BS_ONES;
+    for (int i=n-1; i>=0; i--) {
+        lt |= eq & ~a[i] & b[i];
+        eq &= ~(a[i] ^ b[i]);
+    }
+    return lt | eq;
+}
+
+BS_TARGET static void BS_FN(bs_constant)(BS_VEC *out, uint32_t value, int n) {
+    for (int i=0; i<n; i++) {
+        out[i] = BS_BROADCAST(value >> i);
+    }
+}
+
+// Lanes where the n bit value a equals value:
+BS_TARGET static BS_VEC BS_FN(bs_eq_constant)(const BS_VEC *a, uint32_t value, int n) {
+    BS_VEC eq = BS_ONES;
+    for (int i=0; i<n; i++) {
+        eq &= ((value >> i) & 1) ? a[i] : ~a[i];
+    }
+    return eq;
+}
+
+// Check byte and compiled constraints (see payload_plausible()), on all the
+// lanes at once. The lanes each instruction rejects are counted in op_rejects.
+BS_TARGET static BS_VEC BS_FN(bs_check_payload)(const BS_VEC *y, const uint8_t *payload, const payload_constraints *constraints, BS_VEC alive, uint64_t *op_rejects) {
+    BS_VEC decoded[FRAME_PAYLOAD_LEN][8];
+    for (int i=0; i<FRAME_PAYLOAD_LEN; i++) {
+        for (int k=0; k<8; k++) {
+            decoded[i][k] = BS_KEYSTREAM(y, i, k) ^ BS_BROADCAST(payload[i] >> k);
+        }
+    }
+
+    // Check byte, already tested for all the frames:
+    BS_VEC ok = alive & BS_FN(bs_eq_constant)(decoded[0], 0x4B, 8);
+
+    // Gather the bits of the fields:
+    BS_VEC fields[FIELD_COUNT][32], bound[32];
+    for (int f=0; f<FIELD_COUNT; f++) {
+        for (uint8_t bit=0; bit<payload_field_width(f); bit++) {
+            uint8_t byte, byte_bit;
+            payload_field_bit(f, bit, &byte, &byte_bit);
+            fields[f][bit] = decoded[byte][byte_bit];
+        }
+    }
+
+    for (size_t i=0; i<constraints->op_count; i++) {
+        const constraint_op *op = &constraints->ops[i];
+        BS_VEC pass = BS_ONES;
+        if (op->opcode == OP_H0_LE_CURRENT) {
+            pass = BS_FN(bs_le)(fields[FIELD_H0], fields[FIELD_CURRENT], 32);
+        } else {
+            const BS_VEC *field = fields[op->opcode];
+            int width = payload_field_width(op->opcode);
+            uint32_t max = op->min + op->span;
+            if (op->span == 0) {
+                pass = BS_FN(bs_eq_constant)(field, op->min, width);
+            }
+            if (op->span != 0 && op->min > 0) {
+                BS_FN(bs_constant)(bound, op->min, width);
+                pass &= BS_FN(bs_le)(bound, field, width);
+            }
+            if (op->span != 0 && (width == 32 ? max < UINT32_MAX : max < ((uint32_t) 1 << width) - 1)) {
+                BS_FN(bs_constant)(bound, max, width);
+                pass &= BS_FN(bs_le)(field, bound, width);
+            }
+        }
+        op_rejects[i] += BS_FN(bs_count)(ok & ~pass);
+        ok &= pass;
+    }
+
+    return ok;
+}
+
+BS_TARGET static int BS_FN(bs_trial)(const frame_record *frames, size_t frame_count, const payload_constraints *constraints, uint32_t base, uint64_t *survivors, uint64_t *frame_rejects, uint64_t *op_rejects) {
+    BS_VEC y[BS_STREAM_LEN];
+    BS_VEC alive = BS_ONES;
+
+    // Bit k of the lane index, for the bits that vary inside the batch:
+    BS_VEC lane_bits[BS_LOG2_LANES];
+    for (int k=0; k<BS_LOG2_LANES; k++) {
+        memcpy(&lane_bits[k], bs_lane_patterns[k], sizeof(BS_VEC));
+    }
+
+    // The check byte of every frame rejects 255/256 of the keys: test it for
+    // all the frames first, this only needs 8 LFSR steps per frame.
+    for (size_t f=0; f<frame_count; f++) {
+        BS_FN(bs_load_seed)(y, lane_bits, base ^ frames[f].header_key);
+        BS_FN(bs_run_lfsr)(y, 8);
+        for (int k=0; k<8; k++) {
+            BS_VEC bit = BS_KEYSTREAM(y, 0, k);
+            alive &= ((frames[f].check_keystream >> k) & 1) ? bit : ~bit;
+        }
+        if (!BS_FN(bs_any)(alive)) {
+            frame_rejects[f]++;
+            return 0;
+        }
+    }
+
+    // Decode the whole payloads for the remaining lanes:
+    for (size_t f=0; f<frame_count; f++) {
+        BS_FN(bs_load_seed)(y, lane_bits, base ^ frames[f].header_key);
+        BS_FN(bs_run_lfsr)(y, 8 * FRAME_PAYLOAD_LEN);
+        alive = BS_FN(bs_check_payload)(y, frames[f].payload, constraints, alive, op_rejects);
+        if (!BS_FN(bs_any)(alive)) {
+            frame_rejects[f]++;
+            return 0;
+        }
+    }
+
+    memcpy(survivors, &alive, sizeof(alive));
+    return 1;
+}
+
+#undef BS_STREAM_LEN
+#undef BS_KEYSTREAM
+#undef BS_ZERO
+#undef BS_ONES
+#undef BS_BROADCAST
@@ -0,0 +1,312 @@
+//
+// Loading of captured frames from a file, grouped by meter.
+//
+// The file is memory-mapped and parsed in one pass: only the frames that are
+// kept are copied, in the group of their meter. The CRCs are checked
+// CAPTURE_BATCH frames at a time with wmbus_check_frames().
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "capture.h"
+#include "wmbus_batch.h"
+
+// Longest frame the S2-LP can hand over (size of its RX FIFO):
+#define CAPTURE_MAX_FRAME_LEN 128
+// Number of frames whose CRCs are checked together:
+#define CAPTURE_BATCH 4096
+
+// The frames waiting for their CRC check. Those of a binary capture are read
+// in place, those of a text one are parsed into storage.
+typedef struct {
+    const uint8_t *frames[CAPTURE_BATCH];
+    size_t lengths[CAPTURE_BATCH];
+    uint8_t (*storage)[CAPTURE_MAX_FRAME_LEN];
+    size_t count;
+    int check_crc;
+    wmbus_frame_fields fields;
+} pending_frames;
+
+static uint32_t meter_id_of(const uint8_t *frame) {
+    return frame[4] | frame[5] << 8 | frame[6] << 16 | (uint32_t) frame[7] << 24;
+}
+
+static size_t index_slot(const capture *cap, uint32_t meter_id) {
+    size_t slot = (meter_id * 0x9E3779B1u) & (cap->index_size - 1);
+    while (cap->index[slot] && cap->groups[cap->index[slot] - 1].meter_id != meter_id) {
+        slot = (slot + 1) & (cap->index_size - 1);
+    }
+    return slot;
+}
+
+// Keep the index at most half full:
+static int grow_index(capture *cap) {
+    size_t *old_index = cap->index;
+    size_t old_size = cap->index_size;
+
+    cap->index_size = old_size ? old_size * 2 : 64;
+    cap->index = calloc(cap->index_size, sizeof(*cap->index));
+    if (!cap->index) {
+        return -1;
+    }
+    for (size_t g=0; g<cap->group_count; g++) {
+        cap->index[index_slot(cap, cap->groups[g].meter_id)] = g + 1;
+    }
+    free(old_index);
+    return 0;
+}
+
+static capture_group *get_group(capture *cap, uint32_t meter_id) {
+    if (2 * (cap->group_count + 1) > cap->index_size && grow_index(cap) != 0) {
+        return NULL;
+    }
+    size_t slot = index_slot(cap, meter_id);
+    if (cap->index[slot]) {
+        return &cap->groups[cap->index[slot] - 1];
+    }
+
+    if (cap->group_count == cap->group_capacity) {
+        size_t capacity = cap->group_capacity ? cap->group_capacity * 2 : 16;
+        capture_group *groups = realloc(cap->groups, capacity * sizeof(*groups));
+        if (!groups) {
+            return NULL;
+        }
+        cap->groups = groups;
+        cap->group_capacity = capacity;
+    }
+    capture_group *group = &cap->groups[cap->group_count];
+    memset(group, 0, sizeof(*group));
+    group->meter_id = meter_id;
+    cap->index[slot] = ++cap->group_count;
+    return group;
+}
+
+// Add a frame to its meter group.
+static int add_frame(capture *cap, const uint8_t *frame) {
+    capture_group *group = get_group(cap, meter_id_of(frame));
+    if (!group) {
+        return -1;
+    }
+    if (group->count == group->capacity) {
+        size_t capacity = group->capacity ? group->capacity * 2 : 16;
+        uint8_t (*frames)[FRAME_LEN] = realloc(group->frames, capacity * FRAME_LEN);
+        if (!frames) {
+            return -1;
+        }
+        group->frames = frames;
+        group->capacity = capacity;
+    }
+    memcpy(group->frames[group->count++], frame, FRAME_LEN);
+    cap->frame_count++;
+    return 0;
+}
+
+// Check the CRCs of the pending frames if asked to, and add the valid ones.
+static int flush_frames(capture *cap, pending_frames *pending) {
+    if (pending->check_crc) {
+        wmbus_check_frames(pending->frames, pending->lengths, pending->count, &pending->fields);
+    }
+    for (size_t i=0; i<pending->count; i++) {
+        if (pending->check_crc && !wmbus_frame_valid(&pending->fields, i)) {
+            cap->rejected_count++;
+        } else if (add_frame(cap, pending->frames[i]) != 0) {
+            return -1;
+        }
+    }
+    pending->count = 0;
+    return 0;
+}
+
+// Queue a frame, if it looks like a PRIOS frame.
+static int queue_frame(capture *cap, pending_frames *pending, const uint8_t *frame, size_t len) {
+    if (len < FRAME_LEN || !(frame[0] == 0x19 && frame[1] == 0x44 && frame[2] == 0x30 && frame[3] == 0x4C)) {
+        cap->rejected_count++;
+        return 0;
+    }
+    pending->frames[pending->count] = frame;
+    pending->lengths[pending->count] = len;
+    if (++pending->count == CAPTURE_BATCH) {
+        return flush_frames(cap, pending);
+    }
+    return 0;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = tolower((unsigned char) c);
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+static int load_text(capture *cap, pending_frames *pending, const char *data, size_t size) {
+    const char *end = data + size;
+
+    while (data < end) {
+        uint8_t *frame = pending->storage[pending->count];
+        const char *eol = memchr(data, '\n', end - data);
+        if (!eol) {
+            eol = end;
+        }
+
+        // Parse the line, giving up on the first character that doesn't fit:
+        size_t len = 0;
+        int valid = 1;
+        const char *c = data;
+        while (c < eol && valid) {
+            if (isspace((unsigned char) *c)) {
+                c++;
+            } else if (*c == '#' && len == 0) {
+                break;
+            } else if (c + 1 < eol && hex_value(c[0]) >= 0 && hex_value(c[1]) >= 0 && len < CAPTURE_MAX_FRAME_LEN) {
+                frame[len++] = hex_value(c[0]) << 4 | hex_value(c[1]);
+                c += 2;
+            } else {
+                valid = 0;
+            }
+        }
+
+        if (valid && len > 0 && queue_frame(cap, pending, frame, len) != 0) {
+            return -1;
+        }
+        if (!valid) {
+            cap->rejected_count++;
+        }
+        data = eol + 1;
+    }
+    return 0;
+}
+
+static int load_binary(capture *cap, pending_frames *pending, const uint8_t *data, size_t size) {
+    size_t offset = 0;
+    while (offset < size) {
+        size_t len = data[offset++];
+        if (len > size - offset) {
+            fprintf(stderr, "Truncated frame at offset %zu\n", offset - 1);
+            return -1;
+        }
+        if (queue_frame(cap, pending, data + offset, len) != 0) {
+            return -1;
+        }
+        offset += len;
+    }
+    return 0;
+}
+
+/**
+ * Load the frames of a capture file, optionally dropping the ones with a bad
+ * WMBus CRC. Returns 0 on success, -1 on error.
+ */
+int capture_load(capture *cap, const char *path, int check_crc) {
+    memset(cap, 0, sizeof(*cap));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror(path);
+        return -1;
+    }
+    posix_madvise(data, st.st_size, POSIX_MADV_SEQUENTIAL);
+
+    pending_frames *pending = malloc(sizeof(*pending));
+    int result = -1;
+    if (pending) {
+        pending->storage = malloc(CAPTURE_BATCH * CAPTURE_MAX_FRAME_LEN);
+        pending->count = 0;
+        pending->check_crc = check_crc;
+        if (!pending->storage || wmbus_fields_alloc(&pending->fields, CAPTURE_BATCH) != 0) {
+            free(pending->storage);
+            free(pending);
+            pending = NULL;
+        }
+    }
+    if (!pending) {
+        perror("capture_load");
+        munmap(data, st.st_size);
+        return -1;
+    }
+
+    const char first = *(const char *) data;
+    if (hex_value(first) >= 0 || isspace((unsigned char) first) || first == '#') {
+        result = load_text(cap, pending, data, st.st_size);
+    } else {
+        result = load_binary(cap, pending, data, st.st_size);
+    }
+    if (result == 0) {
+        result = flush_frames(cap, pending);
+    }
+
+    wmbus_fields_free(&pending->fields);
+    free(pending->storage);
+    free(pending);
+    munmap(data, st.st_size);
+    if (result != 0) {
+        capture_free(cap);
+    }
+    return result;
+}
+
+/**
+ * Get the frames of a meter, or NULL if there are none.
+ */
+const capture_group *capture_find(const capture *cap, uint32_t meter_id) {
+    if (!cap->index_size) {
+        return NULL;
+    }
+    size_t slot = index_slot(cap, meter_id);
+    return cap->index[slot] ? &cap->groups[cap->index[slot] - 1] : NULL;
+}
+
+/**
+ * Get the frames of all the meters in a single array, to be freed by the
+ * caller. Returns NULL if memory is exhausted.
+ */
+uint8_t (*capture_all_frames(const capture *cap))[FRAME_LEN] {
+    uint8_t (*frames)[FRAME_LEN] = malloc(cap->frame_count * FRAME_LEN + 1);
+    if (!frames) {
+        return NULL;
+    }
+    size_t count = 0;
+    for (size_t g=0; g<cap->group_count; g++) {
+        memcpy(frames[count], cap->groups[g].frames, cap->groups[g].count * FRAME_LEN);
+        count += cap->groups[g].count;
+    }
+    return frames;
+}
+
+void capture_free(capture *cap) {
+    for (size_t g=0; g<cap->group_count; g++) {
+        free(cap->groups[g].frames);
+    }
+    free(cap->groups);
+    free(cap->index);
+    memset(cap, 0, sizeof(*cap));
+}
@@ -0,0 +1,46 @@
+//
+// Loading of captured frames from a file, grouped by meter.
+//
+// Two formats are accepted:
+// - text: one frame per line, as hexadecimal bytes optionally separated by
+//   spaces (the debug dump of S2LP_HandleGPIOInterrupt()). Empty lines, lines
+//   starting with '#' and lines that aren't hexadecimal are skipped.
+// - binary: a sequence of frames, each one prefixed by its length on one byte.
+// A file is read as text if its first byte is a hex digit, a space or '#'.
+//
+
+#ifndef __CAPTURE_H
+#define __CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "frames.h"
+
+// The frames of a meter, identified by the id part of the A-field.
+typedef struct {
+    uint32_t meter_id;
+    uint8_t (*frames)[FRAME_LEN];
+    size_t count;
+    size_t capacity;
+} capture_group;
+
+typedef struct {
+    capture_group *groups;
+    size_t group_count;
+    size_t group_capacity;
+    // Index of each meter id in groups, plus one (0: empty slot).
+    size_t *index;
+    size_t index_size;
+
+    size_t frame_count;
+    // Frames that are too short, aren't PRIOS frames or fail the CRC check:
+    size_t rejected_count;
+} capture;
+
+int capture_load(capture *cap, const char *path, int check_crc);
+const capture_group *capture_find(const capture *cap, uint32_t meter_id);
+uint8_t (*capture_all_frames(const capture *cap))[FRAME_LEN];
+void capture_free(capture *cap);
+
+#endif
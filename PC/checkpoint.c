@@ -0,0 +1,292 @@
+//
+// Checkpoints of a key search.
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+
+#define CHECKPOINT_HEADER "# PRIOS key search checkpoint\n"
+
+static uint64_t fnv1a(uint64_t hash, uint64_t value, int bytes) {
+    for (int i=0; i<bytes; i++) {
+        hash = (hash ^ ((value >> (8 * i)) & 0xFF)) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+/**
+ * Identify what a search is about: the frames, in order, and the compiled
+ * constraints. Checkpoints of different searches can't be mixed.
+ */
+uint64_t checkpoint_fingerprint(const frame_set *set, const payload_constraints *constraints) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    hash = fnv1a(hash, set->count, 8);
+    for (size_t i=0; i<set->count; i++) {
+        hash = fnv1a(hash, set->records[i].header_key, 4);
+        for (int j=0; j<FRAME_PAYLOAD_LEN; j++) {
+            hash = fnv1a(hash, set->records[i].payload[j], 1);
+        }
+    }
+    hash = fnv1a(hash, constraints->op_count, 1);
+    for (size_t i=0; i<constraints->op_count; i++) {
+        hash = fnv1a(hash, constraints->ops[i].opcode, 1);
+        hash = fnv1a(hash, constraints->ops[i].min, 4);
+        hash = fnv1a(hash, constraints->ops[i].span, 4);
+    }
+    hash = fnv1a(hash, constraints->monotonic, 1);
+    hash = fnv1a(hash, (uint8_t) constraints->access_offset, 1);
+    return hash;
+}
+
+void checkpoint_init(checkpoint *cp, uint64_t fingerprint) {
+    cp->fingerprint = fingerprint;
+    memset(cp->done, 0, sizeof(cp->done));
+    cp->candidates = NULL;
+    cp->candidate_count = 0;
+    cp->candidate_capacity = 0;
+}
+
+/**
+ * Returns 0 on success, -1 if memory is exhausted.
+ */
+int checkpoint_add_candidate(checkpoint *cp, uint32_t prepared_key) {
+    if (cp->candidate_count == cp->candidate_capacity) {
+        size_t capacity = cp->candidate_capacity ? 2 * cp->candidate_capacity : 16;
+        uint32_t *candidates = realloc(cp->candidates, capacity * sizeof(*candidates));
+        if (!candidates) {
+            return -1;
+        }
+        cp->candidates = candidates;
+        cp->candidate_capacity = capacity;
+    }
+    cp->candidates[cp->candidate_count++] = prepared_key;
+    return 0;
+}
+
+static int compare_keys(const void *a, const void *b) {
+    uint32_t key_a = *(const uint32_t *) a;
+    uint32_t key_b = *(const uint32_t *) b;
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+// Sort the candidates and remove the duplicates.
+static void normalize_candidates(checkpoint *cp) {
+    if (cp->candidate_count < 2) {
+        return;
+    }
+    qsort(cp->candidates, cp->candidate_count, sizeof(*cp->candidates), compare_keys);
+    size_t kept = 1;
+    for (size_t i=1; i<cp->candidate_count; i++) {
+        if (cp->candidates[i] != cp->candidates[kept - 1]) {
+            cp->candidates[kept++] = cp->candidates[i];
+        }
+    }
+    cp->candidate_count = kept;
+}
+
+static int parse_hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * Load a checkpoint file.
+ * Returns 0 on success, 1 if the file doesn't exist, -1 if it can't be read.
+ */
+int checkpoint_load(checkpoint *cp, const char *path) {
+    checkpoint_init(cp, 0);
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        if (errno == ENOENT) {
+            return 1;
+        }
+        perror(path);
+        return -1;
+    }
+
+    // Long enough for the done line:
+    char line[SEARCH_KEY_CHUNKS / 4 + 64];
+    int has_fingerprint = 0;
+    int has_done = 0;
+    unsigned line_number = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        char *end;
+        if (line[0] == '#' || line[0] == '\0') {
+            continue;
+        } else if (strncmp(line, "fingerprint ", 12) == 0) {
+            cp->fingerprint = strtoull(line + 12, &end, 16);
+            has_fingerprint = *end == '\0';
+            if (has_fingerprint) {
+                continue;
+            }
+        } else if (strncmp(line, "done ", 5) == 0 && strlen(line + 5) == SEARCH_KEY_CHUNKS / 4) {
+            // Chunk c is bit c % 4 of hex digit c / 4:
+            has_done = 1;
+            for (uint64_t d=0; d<SEARCH_KEY_CHUNKS / 4 && has_done; d++) {
+                int value = parse_hex_digit(line[5 + d]);
+                has_done = value >= 0;
+                cp->done[d / 16] |= (uint64_t)(value & 0xF) << (4 * (d % 16));
+            }
+            if (has_done) {
+                continue;
+            }
+        } else if (strncmp(line, "candidate ", 10) == 0) {
+            unsigned long key = strtoul(line + 10, &end, 16);
+            if (*end == '\0' && end != line + 10 && key <= UINT32_MAX) {
+                if (checkpoint_add_candidate(cp, key) != 0) {
+                    perror("checkpoint_load");
+                    break;
+                }
+                continue;
+            }
+        }
+        fprintf(stderr, "%s:%u: invalid checkpoint line\n", path, line_number);
+        break;
+    }
+
+    int failed = ferror(file) || !feof(file);
+    fclose(file);
+    if (failed || !has_fingerprint || !has_done) {
+        if (!failed) {
+            fprintf(stderr, "%s: incomplete checkpoint\n", path);
+        }
+        checkpoint_free(cp);
+        return -1;
+    }
+    normalize_candidates(cp);
+    return 0;
+}
+
+/**
+ * Write a checkpoint file, through a temporary file renamed over it so that
+ * an interruption never leaves a truncated checkpoint.
+ * Returns 0 on success, -1 on error.
+ */
+int checkpoint_save(checkpoint *cp, const char *path) {
+    normalize_candidates(cp);
+
+    size_t path_len = strlen(path);
+    char *temporary_path = malloc(path_len + 5);
+    if (!temporary_path) {
+        perror("checkpoint_save");
+        return -1;
+    }
+    memcpy(temporary_path, path, path_len);
+    memcpy(temporary_path + path_len, ".tmp", 5);
+
+    FILE *file = fopen(temporary_path, "w");
+    if (!file) {
+        perror(temporary_path);
+        free(temporary_path);
+        return -1;
+    }
+    fputs(CHECKPOINT_HEADER, file);
+    fprintf(file, "fingerprint %.16" PRIx64 "\n", cp->fingerprint);
+    fputs("done ", file);
+    for (uint64_t d=0; d<SEARCH_KEY_CHUNKS / 4; d++) {
+        fputc("0123456789abcdef"[(cp->done[d / 16] >> (4 * (d % 16))) & 0xF], file);
+    }
+    fputc('\n', file);
+    for (size_t i=0; i<cp->candidate_count; i++) {
+        fprintf(file, "candidate %.8" PRIx32 "\n", cp->candidates[i]);
+    }
+
+    int failed = fflush(file) != 0 || fsync(fileno(file)) != 0;
+    failed |= fclose(file) != 0;
+    if (failed || rename(temporary_path, path) != 0) {
+        perror(path);
+        remove(temporary_path);
+        free(temporary_path);
+        return -1;
+    }
+    free(temporary_path);
+    return 0;
+}
+
+/**
+ * Add the chunks and candidates of from to into.
+ * Returns 0 on success, -1 if they are of different searches or memory is
+ * exhausted.
+ */
+int checkpoint_merge(checkpoint *into, const checkpoint *from) {
+    if (into->fingerprint != from->fingerprint) {
+        return -1;
+    }
+    for (size_t i=0; i<SEARCH_KEY_CHUNKS / 64; i++) {
+        into->done[i] |= from->done[i];
+    }
+    for (size_t i=0; i<from->candidate_count; i++) {
+        if (checkpoint_add_candidate(into, from->candidates[i]) != 0) {
+            return -1;
+        }
+    }
+    normalize_candidates(into);
+    return 0;
+}
+
+/**
+ * Record the progress of a running search. The done chunks are read before
+ * the candidates, which the workers publish before marking their chunk done,
+ * so every candidate of a done chunk is recorded.
+ * Returns 0 on success, -1 if memory is exhausted.
+ */
+int checkpoint_snapshot(checkpoint *cp, search_context *ctx) {
+    for (size_t i=0; i<SEARCH_KEY_CHUNKS / 64; i++) {
+        cp->done[i] = atomic_load_explicit(&ctx->done_chunks[i], memory_order_acquire);
+    }
+    cp->candidate_count = 0;
+    for (const search_candidate *c=search_peek_candidates(ctx); c; c=c->next) {
+        if (checkpoint_add_candidate(cp, c->prepared_key) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Skip the chunks a checkpoint has done in a search about to run, and start
+ * from its candidates.
+ */
+void checkpoint_restore(const checkpoint *cp, search_context *ctx) {
+    for (uint64_t chunk=0; chunk<SEARCH_KEY_CHUNKS; chunk++) {
+        if ((cp->done[chunk / 64] >> (chunk % 64)) & 1) {
+            search_mark_done(ctx, chunk);
+        }
+    }
+    for (size_t i=0; i<cp->candidate_count; i++) {
+        search_add_candidate(ctx, cp->candidates[i]);
+    }
+}
+
+uint64_t checkpoint_done_count(const checkpoint *cp) {
+    uint64_t count = 0;
+    for (size_t i=0; i<SEARCH_KEY_CHUNKS / 64; i++) {
+        count += __builtin_popcountll(cp->done[i]);
+    }
+    return count;
+}
+
+void checkpoint_free(checkpoint *cp) {
+    free(cp->candidates);
+    cp->candidates = NULL;
+    cp->candidate_count = 0;
+    cp->candidate_capacity = 0;
+}
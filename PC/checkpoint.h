@@ -0,0 +1,41 @@
+//
+// Checkpoints of a key search: the chunks of prepared keys searched so far,
+// and the candidates found in them. They let an interrupted search resume,
+// and the results of shards run as separate processes be merged.
+//
+// The file is text:
+//   # PRIOS key search checkpoint
+//   fingerprint <16 hex digits, of the frames and constraints searched>
+//   done <SEARCH_KEY_CHUNKS / 4 hex digits, bit c set if chunk c is searched>
+//   candidate <8 hex digits>
+//   ...
+//
+
+#ifndef __CHECKPOINT_H
+#define __CHECKPOINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "search.h"
+
+typedef struct {
+    uint64_t fingerprint;
+    uint64_t done[SEARCH_KEY_CHUNKS / 64];
+    uint32_t *candidates;
+    size_t candidate_count;
+    size_t candidate_capacity;
+} checkpoint;
+
+uint64_t checkpoint_fingerprint(const frame_set *set, const payload_constraints *constraints);
+void checkpoint_init(checkpoint *cp, uint64_t fingerprint);
+int checkpoint_load(checkpoint *cp, const char *path);
+int checkpoint_save(checkpoint *cp, const char *path);
+int checkpoint_add_candidate(checkpoint *cp, uint32_t prepared_key);
+int checkpoint_merge(checkpoint *into, const checkpoint *from);
+int checkpoint_snapshot(checkpoint *cp, search_context *ctx);
+void checkpoint_restore(const checkpoint *cp, search_context *ctx);
+uint64_t checkpoint_done_count(const checkpoint *cp);
+void checkpoint_free(checkpoint *cp);
+
+#endif
@@ -0,0 +1,466 @@
+//
+// Plausibility constraints on the decoded payloads.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <PRIOS.h>
+#include "constraints.h"
+
+// Declare this since it's not exported by the ST code.
+uint32_t read_uint32_le(const uint8_t *data, int offset);
+
+// Unit code of the cubic meters in the frame headers, see parsePRIOSFrame().
+#define UNIT_CUBIC_METER 0x02
+
+static const char * const field_names[FIELD_COUNT] = {
+    [FIELD_CURRENT] = "current",
+    [FIELD_H0] = "h0",
+    [FIELD_YEAR] = "year",
+    [FIELD_MONTH] = "month",
+    [FIELD_DAY] = "day",
+};
+
+static const uint8_t field_widths[FIELD_COUNT] = {
+    [FIELD_CURRENT] = 32,
+    [FIELD_H0] = 32,
+    [FIELD_YEAR] = 7,
+    [FIELD_MONTH] = 4,
+    [FIELD_DAY] = 5,
+};
+
+uint8_t payload_field_width(payload_field field) {
+    return field_widths[field];
+}
+
+static uint32_t field_max(payload_field field) {
+    return field_widths[field] == 32 ? UINT32_MAX : ((uint32_t) 1 << field_widths[field]) - 1;
+}
+
+/**
+ * Locate a bit of a field in the decoded payload.
+ */
+void payload_field_bit(payload_field field, uint8_t bit, uint8_t *byte, uint8_t *byte_bit) {
+    switch (field) {
+    case FIELD_CURRENT:
+        *byte = 1 + bit / 8;
+        *byte_bit = bit % 8;
+        break;
+    case FIELD_H0:
+        *byte = 5 + bit / 8;
+        *byte_bit = bit % 8;
+        break;
+    case FIELD_YEAR:
+        // Bits 5..7 of byte 9, then 4..7 of byte 10:
+        *byte = bit < 3 ? 9 : 10;
+        *byte_bit = bit < 3 ? 5 + bit : 1 + bit;
+        break;
+    case FIELD_MONTH:
+        *byte = 10;
+        *byte_bit = bit;
+        break;
+    default:
+        *byte = 9;
+        *byte_bit = bit;
+        break;
+    }
+}
+
+static uint32_t read_field(uint8_t field, const uint8_t *decoded_frame) {
+    switch (field) {
+    case FIELD_CURRENT:
+        return read_uint32_le(decoded_frame, 1);
+    case FIELD_H0:
+        return read_uint32_le(decoded_frame, 5);
+    case FIELD_YEAR:
+        return ((decoded_frame[10] & 0xF0) >> 1) + ((decoded_frame[9] & 0xE0) >> 5);
+    case FIELD_MONTH:
+        return decoded_frame[10] & 0xF;
+    default:
+        return decoded_frame[9] & 0x1F;
+    }
+}
+
+/**
+ * Start with no constraint but the validity of the date: year <= 99 and
+ * month <= 12.
+ */
+void constraints_init(payload_constraints *constraints) {
+    for (int f=0; f<FIELD_COUNT; f++) {
+        constraints->ranges[f].min = 0;
+        constraints->ranges[f].max = field_max(f);
+    }
+    constraints->ranges[FIELD_YEAR].max = 99;
+    constraints->ranges[FIELD_MONTH].max = 12;
+    constraints->h0_le_current = 0;
+    constraints->monotonic = 0;
+    constraints->access_offset = -1;
+    constraints->unit = CONSTRAINT_ANY_UNIT;
+    constraints->multiplier = CONSTRAINT_ANY_MULTIPLIER;
+    constraints->op_count = 0;
+}
+
+/**
+ * Restrict a field to min..max, on top of its current range.
+ */
+void constraints_add_range(payload_constraints *constraints, payload_field field, uint32_t min, uint32_t max) {
+    field_range *range = &constraints->ranges[field];
+    if (min > range->min) {
+        range->min = min;
+    }
+    if (max < range->max) {
+        range->max = max;
+    }
+}
+
+// Parse a field value, as a raw number or in cubic meters with an m3 suffix,
+// giving it rounded down and up to a raw value. Returns the end of the value,
+// or NULL if it is invalid.
+static const char *parse_value(const payload_constraints *constraints, payload_field field, const char *text, uint64_t *floor_value, uint64_t *ceil_value) {
+    uint64_t value = 0;
+    int digits = 0;
+    int decimals = -1;
+    for (; isdigit((unsigned char) *text) || (*text == '.' && decimals < 0 && isdigit((unsigned char) text[1])); text++) {
+        if (*text == '.') {
+            decimals = 0;
+            continue;
+        }
+        if (++digits > 19) {
+            return NULL;
+        }
+        value = value * 10 + (*text - '0');
+        if (decimals >= 0) {
+            decimals++;
+        }
+    }
+    if (digits == 0) {
+        return NULL;
+    }
+    if (decimals < 0) {
+        decimals = 0;
+    }
+
+    // Cubic meters: raw value * 10^multiplier = value / 10^decimals.
+    int scale = -decimals;
+    if (strncmp(text, "m3", 2) == 0) {
+        if (field != FIELD_CURRENT && field != FIELD_H0) {
+            return NULL;
+        }
+        if (constraints->multiplier == CONSTRAINT_ANY_MULTIPLIER) {
+            fprintf(stderr, "Values in m3 need a multiplier= constraint\n");
+            return NULL;
+        }
+        if (constraints->unit != CONSTRAINT_ANY_UNIT && constraints->unit != UNIT_CUBIC_METER) {
+            fprintf(stderr, "Values in m3 don't match the unit= constraint\n");
+            return NULL;
+        }
+        scale -= constraints->multiplier;
+        text += 2;
+    } else if (decimals > 0) {
+        return NULL;
+    }
+
+    for (; scale > 0; scale--) {
+        if (value > UINT64_MAX / 10) {
+            return NULL;
+        }
+        value *= 10;
+    }
+    uint64_t divisor = 1;
+    for (; scale < 0 && divisor <= UINT64_MAX / 10; scale++) {
+        divisor *= 10;
+    }
+    *floor_value = scale < 0 ? 0 : value / divisor;
+    *ceil_value = *floor_value + (scale < 0 ? value != 0 : value % divisor != 0);
+
+    // Years can be given in full, see parsePRIOSFrame():
+    if (field == FIELD_YEAR && *floor_value >= 1900) {
+        *floor_value %= 100;
+        *ceil_value = *floor_value;
+    }
+    return text;
+}
+
+// Parse one term. The unit and multiplier terms are handled by the first pass,
+// as the values of the others depend on them.
+static int parse_term(payload_constraints *constraints, const char *term, int pass) {
+    char *end;
+
+    if (strncmp(term, "unit=", 5) == 0) {
+        if (pass == 0) {
+            long unit = strcmp(term + 5, "m3") == 0 ? UNIT_CUBIC_METER : strtol(term + 5, &end, 0);
+            if (strcmp(term + 5, "m3") != 0 && (*end != '\0' || end == term + 5 || unit < 0 || unit > 0x1F)) {
+                return -1;
+            }
+            constraints->unit = unit;
+        }
+        return 0;
+    }
+    if (strncmp(term, "multiplier=", 11) == 0) {
+        if (pass == 0) {
+            long multiplier = strtol(term + 11, &end, 10);
+            if (*end != '\0' || end == term + 11 || multiplier < -6 || multiplier > 1) {
+                return -1;
+            }
+            constraints->multiplier = multiplier;
+        }
+        return 0;
+    }
+    if (pass == 0) {
+        return 0;
+    }
+
+    if (strcmp(term, "h0<=current") == 0) {
+        constraints->h0_le_current = 1;
+        return 0;
+    }
+    if (strncmp(term, "monotonic", 9) == 0) {
+        constraints->monotonic = 1;
+        if (term[9] == '@') {
+            long offset = strtol(term + 10, &end, 0);
+            if (*end != '\0' || end == term + 10 || offset < 0 || offset >= FRAME_LEN) {
+                return -1;
+            }
+            constraints->access_offset = offset;
+        } else if (term[9] != '\0') {
+            return -1;
+        }
+        return 0;
+    }
+
+    // field, comparison operator, value(s):
+    payload_field field;
+    size_t name_len = 0;
+    for (field=0; field<FIELD_COUNT; field++) {
+        name_len = strlen(field_names[field]);
+        if (strncmp(term, field_names[field], name_len) == 0 && !isalnum((unsigned char) term[name_len])) {
+            break;
+        }
+    }
+    if (field == FIELD_COUNT) {
+        return -1;
+    }
+    const char *op = term + name_len;
+    size_t op_len = (op[0] == '<' || op[0] == '>' || op[0] == '=') && op[1] == '=' ? 2 : 1;
+    uint64_t floor_value, ceil_value;
+    const char *value_end = parse_value(constraints, field, op + op_len, &floor_value, &ceil_value);
+    if (!value_end) {
+        return -1;
+    }
+
+    uint64_t min = 0;
+    uint64_t max = field_max(field);
+    if (op[0] == '<' && op_len == 2) {
+        max = floor_value;
+    } else if (op[0] == '>' && op_len == 2) {
+        min = ceil_value;
+    } else if (op[0] == '<') {
+        // Nothing is below 0:
+        min = ceil_value > 0 ? 0 : 1;
+        max = ceil_value > 0 ? ceil_value - 1 : 0;
+    } else if (op[0] == '>') {
+        min = floor_value + 1;
+    } else if (op[0] == '=') {
+        min = ceil_value;
+        max = floor_value;
+        if (strncmp(value_end, "..", 2) == 0) {
+            value_end = parse_value(constraints, field, value_end + 2, &floor_value, &ceil_value);
+            if (!value_end) {
+                return -1;
+            }
+            max = floor_value;
+        }
+    } else {
+        return -1;
+    }
+    if (*value_end != '\0') {
+        return -1;
+    }
+
+    // Out of the field: nothing can match.
+    if (min > field_max(field)) {
+        min = 1;
+        max = 0;
+    } else if (max > field_max(field)) {
+        max = field_max(field);
+    }
+    constraints_add_range(constraints, field, (uint32_t) min, (uint32_t) max);
+    return 0;
+}
+
+/**
+ * Add the terms of a constraint string.
+ * Returns 0 on success, -1 if a term is invalid.
+ */
+int constraints_parse(payload_constraints *constraints, const char *text) {
+    size_t len = strlen(text);
+    char *terms = malloc(len + 1);
+    if (!terms) {
+        perror("constraints_parse");
+        return -1;
+    }
+
+    for (int pass=0; pass<2; pass++) {
+        memcpy(terms, text, len + 1);
+        for (char *term=terms; *term; ) {
+            size_t term_len = strcspn(term, ", \t");
+            char *next = term + term_len;
+            if (*next) {
+                *next++ = '\0';
+            }
+            if (term_len > 0 && parse_term(constraints, term, pass) != 0) {
+                fprintf(stderr, "Invalid constraint: %s\n", term);
+                free(terms);
+                return -1;
+            }
+            term = next;
+        }
+    }
+
+    free(terms);
+    return 0;
+}
+
+/**
+ * Compile the constraints into the program payload_plausible() runs, keeping
+ * only the checks that can fail.
+ * Returns 0 on success, -1 if the constraints can't be satisfied.
+ */
+int constraints_compile(payload_constraints *constraints) {
+    field_range *ranges = constraints->ranges;
+
+    // H0 <= current bounds each by the other:
+    if (constraints->h0_le_current) {
+        constraints_add_range(constraints, FIELD_H0, 0, ranges[FIELD_CURRENT].max);
+        constraints_add_range(constraints, FIELD_CURRENT, ranges[FIELD_H0].min, UINT32_MAX);
+    }
+
+    constraints->op_count = 0;
+    for (int f=0; f<FIELD_COUNT; f++) {
+        if (ranges[f].min > ranges[f].max) {
+            fprintf(stderr, "The constraints on %s can't be satisfied\n", field_names[f]);
+            return -1;
+        }
+        if (ranges[f].min == 0 && ranges[f].max == field_max(f)) {
+            continue;
+        }
+        constraint_op *op = &constraints->ops[constraints->op_count++];
+        op->opcode = f;
+        op->min = ranges[f].min;
+        op->span = ranges[f].max - ranges[f].min;
+    }
+    if (constraints->h0_le_current) {
+        constraints->ops[constraints->op_count++].opcode = OP_H0_LE_CURRENT;
+    }
+    return 0;
+}
+
+void constraints_print(const payload_constraints *constraints) {
+    printf("Constraints:");
+    for (size_t i=0; i<constraints->op_count; i++) {
+        const constraint_op *op = &constraints->ops[i];
+        if (op->opcode == OP_H0_LE_CURRENT) {
+            printf(" h0<=current");
+        } else if (op->span == 0) {
+            printf(" %s=%" PRIu32, field_names[op->opcode], op->min);
+        } else {
+            printf(" %s=%" PRIu32 "..%" PRIu32, field_names[op->opcode], op->min, op->min + op->span);
+        }
+    }
+    if (constraints->monotonic) {
+        if (constraints->access_offset >= 0) {
+            printf(" monotonic@%d", constraints->access_offset);
+        } else {
+            printf(" monotonic");
+        }
+    }
+    if (constraints->unit != CONSTRAINT_ANY_UNIT) {
+        printf(" unit=%d", constraints->unit);
+    }
+    if (constraints->multiplier != CONSTRAINT_ANY_MULTIPLIER) {
+        printf(" multiplier=%d", constraints->multiplier);
+    }
+    printf("\n");
+}
+
+const char *constraint_op_name(const constraint_op *op) {
+    return op->opcode == OP_H0_LE_CURRENT ? "h0<=current" : field_names[op->opcode];
+}
+
+static uint8_t run_op(const constraint_op *op, const uint8_t *decoded_frame) {
+    if (op->opcode == OP_H0_LE_CURRENT) {
+        return read_uint32_le(decoded_frame, 5) <= read_uint32_le(decoded_frame, 1);
+    }
+    return read_field(op->opcode, decoded_frame) - op->min <= op->span;
+}
+
+/**
+ * Check that a decoded payload is coherent with the data we expect.
+ */
+uint8_t payload_plausible(const payload_constraints *constraints, const uint8_t *decoded_frame) {
+    for (size_t i=0; i<constraints->op_count; i++) {
+        if (!run_op(&constraints->ops[i], decoded_frame)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Same as payload_plausible(), running the checks in the given adaptive order
+ * and counting the rejections.
+ */
+uint8_t payload_plausible_ordered(const payload_constraints *constraints, const uint8_t *decoded_frame, adaptive_order *checks) {
+    for (size_t p=0; p<constraints->op_count; p++) {
+        if (!run_op(&constraints->ops[checks->order[p]], decoded_frame)) {
+            checks->rejects[p]++;
+            return 0;
+        }
+    }
+    checks->passes++;
+    return 1;
+}
+
+/**
+ * Check the unit and multiplier in the clear header of a frame, for
+ * frame_set_retain().
+ */
+int frame_header_plausible(const uint8_t *frame, const void *arg) {
+    const payload_constraints *constraints = arg;
+    uint8_t header = frame[16];
+    if (constraints->unit != CONSTRAINT_ANY_UNIT && header >> 3 != constraints->unit) {
+        return 0;
+    }
+    if (constraints->multiplier != CONSTRAINT_ANY_MULTIPLIER && (header & 0x07) - 6 != constraints->multiplier) {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Check the constraints between frames for a key that decodes each of them,
+ * the frames being in access order.
+ */
+uint8_t payload_sequence_plausible(const payload_constraints *constraints, const uint8_t (*frames)[FRAME_LEN], size_t frame_count, uint32_t prepared_key) {
+    if (!constraints->monotonic) {
+        return 1;
+    }
+
+    uint32_t previous = 0;
+    for (size_t i=0; i<frame_count; i++) {
+        uint8_t decoded_frame[FRAME_PAYLOAD_LEN];
+        if (!decodePRIOSPayload(frames[i], FRAME_PAYLOAD_LEN, prepared_key, decoded_frame)) {
+            return 0;
+        }
+        uint32_t current = read_uint32_le(decoded_frame, 1);
+        if (current < previous) {
+            return 0;
+        }
+        previous = current;
+    }
+    return 1;
+}
@@ -0,0 +1,86 @@
+//
+// Plausibility constraints on the decoded payloads, given on the command line
+// and compiled into a flat program for the search loops.
+//
+// The language is a list of terms separated by commas or spaces:
+//   current<=70500 h0>=69000 year=2020 month=4 day=1 day=1..15
+//   h0<=current        H0 reading lower or equal to the current one
+//   monotonic          current reading never decreasing from a frame to the
+//   monotonic@13       next, in capture order or sorted by the access number
+//                      at the given frame offset
+//   unit=m3            measurement unit and multiplier exponent of the
+//   multiplier=-3      frames, frames with other values are ignored
+// Consumption values are raw counter values, or cubic meters with an m3
+// suffix (e.g. current<=70.5m3) when the multiplier is given.
+//
+
+#ifndef __CONSTRAINTS_H
+#define __CONSTRAINTS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "frames.h"
+#include "adaptive.h"
+
+// Fields of a decoded payload, in the order of their range opcodes.
+typedef enum {
+    FIELD_CURRENT,
+    FIELD_H0,
+    FIELD_YEAR,
+    FIELD_MONTH,
+    FIELD_DAY,
+    FIELD_COUNT
+} payload_field;
+
+// Opcodes of the compiled program: a field range check, or H0 <= current.
+#define OP_H0_LE_CURRENT FIELD_COUNT
+#define CONSTRAINT_MAX_OPS (FIELD_COUNT + 1)
+
+// Values for the header constraints that aren't set.
+#define CONSTRAINT_ANY_UNIT -1
+#define CONSTRAINT_ANY_MULTIPLIER -128
+
+// Pass if value - min <= span, unsigned: min <= value <= min + span.
+typedef struct {
+    uint8_t opcode;
+    uint32_t min;
+    uint32_t span;
+} constraint_op;
+
+typedef struct {
+    uint32_t min;
+    uint32_t max;
+} field_range;
+
+typedef struct {
+    // What the terms say:
+    field_range ranges[FIELD_COUNT];
+    int h0_le_current;
+    int monotonic;
+    // Frame offset of the access number, -1 for the capture order.
+    int access_offset;
+    int unit;
+    int multiplier;
+
+    // Compiled by constraints_compile(), only the checks that can fail:
+    constraint_op ops[CONSTRAINT_MAX_OPS];
+    size_t op_count;
+} payload_constraints;
+
+void constraints_init(payload_constraints *constraints);
+void constraints_add_range(payload_constraints *constraints, payload_field field, uint32_t min, uint32_t max);
+int constraints_parse(payload_constraints *constraints, const char *text);
+int constraints_compile(payload_constraints *constraints);
+void constraints_print(const payload_constraints *constraints);
+const char *constraint_op_name(const constraint_op *op);
+
+uint8_t payload_field_width(payload_field field);
+void payload_field_bit(payload_field field, uint8_t bit, uint8_t *byte, uint8_t *byte_bit);
+
+uint8_t payload_plausible(const payload_constraints *constraints, const uint8_t *decoded_frame);
+uint8_t payload_plausible_ordered(const payload_constraints *constraints, const uint8_t *decoded_frame, adaptive_order *checks);
+int frame_header_plausible(const uint8_t *frame, const void *constraints);
+uint8_t payload_sequence_plausible(const payload_constraints *constraints, const uint8_t (*frames)[FRAME_LEN], size_t frame_count, uint32_t prepared_key);
+
+#endif
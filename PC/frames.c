@@ -0,0 +1,161 @@
+//
+// Preprocessing of the captured frames before a key search.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "frames.h"
+
+// Declare this since it's not exported by the ST code.
+uint32_t read_uint32_be(const uint8_t *data, int offset);
+
+/**
+ * Reduce a raw frame to a record.
+ */
+void frame_record_prepare(frame_record *record, const uint8_t *frame) {
+    record->header_key = read_uint32_be(frame, 2) ^ read_uint32_be(frame, 6) ^ read_uint32_be(frame, 12);
+    memcpy(record->payload, frame + FRAME_PAYLOAD_OFFSET, FRAME_PAYLOAD_LEN);
+    record->check_keystream = record->payload[0] ^ 0x4B;
+}
+
+static int same_record(const frame_record *a, const frame_record *b) {
+    return a->header_key == b->header_key && memcmp(a->payload, b->payload, FRAME_PAYLOAD_LEN) == 0;
+}
+
+/**
+ * Build the set of distinct frames.
+ * Returns 0 on success, -1 if memory is exhausted.
+ */
+int frame_set_prepare(frame_set *set, const uint8_t (*frames)[FRAME_LEN], size_t frame_count) {
+    set->frames = malloc(frame_count * FRAME_LEN + 1);
+    set->records = malloc(frame_count * sizeof(frame_record) + 1);
+    set->count = 0;
+    set->duplicate_count = 0;
+    if (!set->frames || !set->records) {
+        frame_set_free(set);
+        return -1;
+    }
+
+    // Open addressing table of the indexes of the records kept so far, plus one:
+    size_t table_size = 16;
+    while (table_size < 2 * frame_count) {
+        table_size *= 2;
+    }
+    size_t *table = calloc(table_size, sizeof(*table));
+    if (!table) {
+        frame_set_free(set);
+        return -1;
+    }
+
+    for (size_t i=0; i<frame_count; i++) {
+        frame_record record;
+        frame_record_prepare(&record, frames[i]);
+
+        uint32_t hash = record.header_key;
+        for (int j=0; j<FRAME_PAYLOAD_LEN; j++) {
+            hash = (hash ^ record.payload[j]) * 0x01000193;
+        }
+        size_t slot = hash & (table_size - 1);
+        while (table[slot] && !same_record(&set->records[table[slot] - 1], &record)) {
+            slot = (slot + 1) & (table_size - 1);
+        }
+        if (table[slot]) {
+            set->duplicate_count++;
+            continue;
+        }
+
+        table[slot] = set->count + 1;
+        memcpy(set->frames[set->count], frames[i], FRAME_LEN);
+        set->records[set->count] = record;
+        set->count++;
+    }
+
+    free(table);
+    return 0;
+}
+
+/**
+ * Only keep the frames for which keep() returns non-zero, in the same order.
+ * Returns the number of frames removed.
+ */
+size_t frame_set_retain(frame_set *set, int (*keep)(const uint8_t *frame, const void *arg), const void *arg) {
+    size_t kept = 0;
+    for (size_t i=0; i<set->count; i++) {
+        if (!keep(set->frames[i], arg)) {
+            continue;
+        }
+        memmove(set->frames[kept], set->frames[i], FRAME_LEN);
+        set->records[kept] = set->records[i];
+        kept++;
+    }
+    size_t removed = set->count - kept;
+    set->count = kept;
+    return removed;
+}
+
+typedef struct {
+    int64_t access_number;
+    size_t index;
+} access_entry;
+
+static int compare_access(const void *a, const void *b) {
+    const access_entry *entry_a = a;
+    const access_entry *entry_b = b;
+    if (entry_a->access_number != entry_b->access_number) {
+        return entry_a->access_number < entry_b->access_number ? -1 : 1;
+    }
+    return (entry_a->index > entry_b->index) - (entry_a->index < entry_b->index);
+}
+
+/**
+ * Sort the frames by the 8 bit access number at access_offset, unwrapping it
+ * in capture order so that a counter going from 0xFF to 0x00 keeps increasing:
+ * consecutive frames are assumed less than 128 accesses apart.
+ * Frames with the same access number keep their capture order.
+ * Returns 0 on success, -1 if memory is exhausted.
+ */
+int frame_set_sort_by_access(frame_set *set, int access_offset) {
+    access_entry *entries = malloc(set->count * sizeof(*entries) + 1);
+    uint8_t (*frames)[FRAME_LEN] = malloc(set->count * FRAME_LEN + 1);
+    frame_record *records = malloc(set->count * sizeof(frame_record) + 1);
+    if (!entries || !frames || !records) {
+        free(entries);
+        free(frames);
+        free(records);
+        return -1;
+    }
+
+    int64_t access_number = 0;
+    for (size_t i=0; i<set->count; i++) {
+        uint8_t value = set->frames[i][access_offset];
+        if (i > 0) {
+            // Frames captured slightly out of order step back a little:
+            access_number += (int8_t)(uint8_t)(value - set->frames[i - 1][access_offset]);
+        } else {
+            access_number = value;
+        }
+        entries[i].access_number = access_number;
+        entries[i].index = i;
+    }
+    qsort(entries, set->count, sizeof(*entries), compare_access);
+
+    for (size_t i=0; i<set->count; i++) {
+        memcpy(frames[i], set->frames[entries[i].index], FRAME_LEN);
+        records[i] = set->records[entries[i].index];
+    }
+    free(entries);
+    free(set->frames);
+    free(set->records);
+    set->frames = frames;
+    set->records = records;
+    return 0;
+}
+
+void frame_set_free(frame_set *set) {
+    free(set->frames);
+    free(set->records);
+    set->frames = NULL;
+    set->records = NULL;
+    set->count = 0;
+}
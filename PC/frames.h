@@ -0,0 +1,44 @@
+//
+// Preprocessing of the captured frames before a key search.
+//
+// Each frame is reduced to what the decryption depends on: the XOR of its
+// three header words (see decodePRIOSPayload()) and its encrypted payload.
+// Frames giving the same record constrain the key in the same way, so only
+// one of them is kept.
+//
+
+#ifndef __FRAMES_H
+#define __FRAMES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Length of the frames handled by the cracker, and of their encrypted payload.
+#define FRAME_LEN 28
+#define FRAME_PAYLOAD_LEN 11
+#define FRAME_PAYLOAD_OFFSET 17
+
+// What a key is tried against, 16 bytes so that 4 of them fit in a cache line.
+typedef struct {
+    // read_uint32_be() of bytes 2, 6 and 12 XORed together.
+    uint32_t header_key;
+    uint8_t payload[FRAME_PAYLOAD_LEN];
+    // Keystream byte that decodes the check byte: payload[0] ^ 0x4B.
+    uint8_t check_keystream;
+} frame_record;
+
+// The distinct frames, as raw frames and as records, in capture order.
+typedef struct {
+    uint8_t (*frames)[FRAME_LEN];
+    frame_record *records;
+    size_t count;
+    size_t duplicate_count;
+} frame_set;
+
+void frame_record_prepare(frame_record *record, const uint8_t *frame);
+int frame_set_prepare(frame_set *set, const uint8_t (*frames)[FRAME_LEN], size_t frame_count);
+size_t frame_set_retain(frame_set *set, int (*keep)(const uint8_t *frame, const void *arg), const void *arg);
+int frame_set_sort_by_access(frame_set *set, int access_offset);
+void frame_set_free(frame_set *set);
+
+#endif
@@ -0,0 +1,149 @@
+//
+// Key recovery from known plaintext, by solving a linear system over GF(2).
+//
+
+#include <string.h>
+
+#include "gf2_solver.h"
+
+/**
+ * Compute which bits of the seed each keystream bit is the parity of:
+ * bit k of the i-th keystream byte is gf2_parity32(seed & masks[i][k]).
+ */
+void gf2_keystream_masks(uint32_t masks[FRAME_PAYLOAD_LEN][8]) {
+    // Run the LFSR of decodePRIOSPayload() on masks instead of bits:
+    uint32_t state[32];
+    for (int k=0; k<32; k++) {
+        state[k] = (uint32_t) 1 << k;
+    }
+    for (int i=0; i<FRAME_PAYLOAD_LEN; i++) {
+        for (int j=0; j<8; j++) {
+            uint32_t bit = state[1] ^ state[2] ^ state[11] ^ state[31];
+            memmove(&state[1], &state[0], 31 * sizeof(state[0]));
+            state[0] = bit;
+        }
+        memcpy(masks[i], state, sizeof(masks[i]));
+    }
+}
+
+static size_t add_known_bits(gf2_known_bit *out, size_t count, uint8_t byte, uint8_t first_bit, uint8_t bit_count, uint32_t value) {
+    for (uint8_t b=0; b<bit_count; b++) {
+        out[count].byte = byte;
+        out[count].bit = first_bit + b;
+        out[count].value = (value >> b) & 1;
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Derive the known bits of the decoded payloads from the constraints: the
+ * check byte, and for each field the upper bits its range fixes (all of them
+ * for an equality). out must have room for 8 * FRAME_PAYLOAD_LEN bits.
+ * Returns the number of known bits.
+ */
+size_t gf2_known_bits_from_constraints(const payload_constraints *constraints, gf2_known_bit *out) {
+    size_t count = add_known_bits(out, 0, 0, 0, 8, 0x4B);
+
+    // The bits above the highest one where min and max differ are those of min:
+    for (int f=0; f<FIELD_COUNT; f++) {
+        uint32_t min = constraints->ranges[f].min;
+        uint32_t max = constraints->ranges[f].max;
+        int width = payload_field_width(f);
+        int bit = width;
+        while (bit > 0 && ((min ^ max) >> (bit - 1)) == 0) {
+            bit--;
+        }
+        for (; bit<width; bit++) {
+            uint8_t byte, byte_bit;
+            payload_field_bit(f, bit, &byte, &byte_bit);
+            count = add_known_bits(out, count, byte, byte_bit, 1, min >> bit);
+        }
+    }
+    return count;
+}
+
+/**
+ * Solve the equations given by the known bits of all the frames.
+ * Returns 0 if they are inconsistent (no prepared key decodes the frames as
+ * expected), 1 otherwise.
+ */
+int gf2_solve(const frame_record *records, size_t record_count, const gf2_known_bit *known_bits, size_t known_count, gf2_solution *solution) {
+    uint32_t masks[FRAME_PAYLOAD_LEN][8];
+    gf2_keystream_masks(masks);
+
+    // Row echelon form: rows[b] has b as its highest bit.
+    uint32_t rows[32] = {0};
+    uint8_t rhs[32] = {0};
+    solution->equation_count = 0;
+
+    for (size_t f=0; f<record_count; f++) {
+        uint32_t header_key = records[f].header_key;
+        for (size_t e=0; e<known_count; e++) {
+            const gf2_known_bit *known = &known_bits[e];
+            uint32_t mask = masks[known->byte][known->bit];
+
+            // keystream(key ^ header_key) = payload ^ plain, and the keystream is linear:
+            uint32_t row = mask;
+            uint8_t value = ((records[f].payload[known->byte] >> known->bit) & 1) ^ known->value ^ gf2_parity32(mask & header_key);
+            solution->equation_count++;
+
+            // Reduce the equation with the pivots found so far:
+            int b = 31;
+            for (; b>=0; b--) {
+                if (!((row >> b) & 1)) {
+                    continue;
+                }
+                if (!rows[b]) {
+                    break;
+                }
+                row ^= rows[b];
+                value ^= rhs[b];
+            }
+            if (b >= 0) {
+                rows[b] = row;
+                rhs[b] = value;
+            } else if (value) {
+                // 0 == 1: the known bits are wrong, or the frames use different keys.
+                return 0;
+            }
+        }
+    }
+
+    // Free variables are set to 0 for the particular solution, and to each
+    // unit vector in turn for the basis. Pivot bits only depend on lower ones.
+    solution->particular = 0;
+    solution->dimension = 0;
+    for (int b=0; b<32; b++) {
+        if (rows[b]) {
+            solution->particular |= (uint32_t) (rhs[b] ^ gf2_parity32(rows[b] & solution->particular)) << b;
+        }
+    }
+    for (int free_bit=0; free_bit<32; free_bit++) {
+        if (rows[free_bit]) {
+            continue;
+        }
+        uint32_t vector = (uint32_t) 1 << free_bit;
+        for (int b=free_bit+1; b<32; b++) {
+            if (rows[b]) {
+                vector |= (uint32_t) gf2_parity32(rows[b] & vector) << b;
+            }
+        }
+        solution->basis[solution->dimension++] = vector;
+    }
+
+    return 1;
+}
+
+/**
+ * Get the index-th key of the solution space, index < 2^dimension.
+ */
+uint32_t gf2_solution_key(const gf2_solution *solution, uint64_t index) {
+    uint32_t key = solution->particular;
+    for (unsigned d=0; d<solution->dimension; d++) {
+        if ((index >> d) & 1) {
+            key ^= solution->basis[d];
+        }
+    }
+    return key;
+}
@@ -0,0 +1,47 @@
+//
+// Key recovery from known plaintext, by solving a linear system over GF(2).
+//
+// The PRIOS keystream comes from a LFSR, so each of its bits is the parity of
+// some bits of the seed, and the seed is the prepared key ^ the header key of
+// the frame. Every known bit of a decoded payload thus gives a linear
+// equation on the 32 bits of the prepared key.
+//
+
+#ifndef __GF2_SOLVER_H
+#define __GF2_SOLVER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "search.h"
+
+// A bit of the decoded payloads that is known in advance.
+typedef struct {
+    uint8_t byte;
+    uint8_t bit;
+    uint8_t value;
+} gf2_known_bit;
+
+// The prepared keys satisfying the equations: particular ^ any combination of basis.
+typedef struct {
+    uint32_t particular;
+    uint32_t basis[32];
+    unsigned dimension;
+    unsigned equation_count;
+} gf2_solution;
+
+static inline uint8_t gf2_parity32(uint32_t x) {
+    x ^= x >> 16;
+    x ^= x >> 8;
+    x ^= x >> 4;
+    x ^= x >> 2;
+    x ^= x >> 1;
+    return x & 1;
+}
+
+void gf2_keystream_masks(uint32_t masks[FRAME_PAYLOAD_LEN][8]);
+size_t gf2_known_bits_from_constraints(const payload_constraints *constraints, gf2_known_bit *out);
+int gf2_solve(const frame_record *records, size_t record_count, const gf2_known_bit *known_bits, size_t known_count, gf2_solution *solution);
+uint32_t gf2_solution_key(const gf2_solution *solution, uint64_t index);
+
+#endif
@@ -0,0 +1,124 @@
+//
+// Enumeration of the prepared keys in Gray code order.
+//
+
+#include "gray.h"
+#include "gf2_solver.h"
+
+static void set_byte(gray_keystream *stream, int i, uint8_t value) {
+    if (i < 8) {
+        stream->low |= (uint64_t) value << (8 * i);
+    } else {
+        stream->high |= (uint32_t) value << (8 * (i - 8));
+    }
+}
+
+static uint8_t get_byte(const gray_keystream *stream, int i) {
+    return i < 8 ? stream->low >> (8 * i) : stream->high >> (8 * (i - 8));
+}
+
+/**
+ * Compute the keystream of each of the 32 seed bits alone.
+ */
+void gray_prepare_basis(gray_keystream basis[32]) {
+    uint32_t masks[FRAME_PAYLOAD_LEN][8];
+    gf2_keystream_masks(masks);
+
+    for (int b=0; b<32; b++) {
+        basis[b].low = 0;
+        basis[b].high = 0;
+        for (int i=0; i<FRAME_PAYLOAD_LEN; i++) {
+            uint8_t value = 0;
+            for (int k=0; k<8; k++) {
+                value |= ((masks[i][k] >> b) & 1) << k;
+            }
+            set_byte(&basis[b], i, value);
+        }
+    }
+}
+
+/**
+ * Compute the part of the decoded payload of a frame that doesn't depend on
+ * the key: the encrypted payload ^ keystream(header key). The decoded payload
+ * is then target ^ keystream(prepared key).
+ */
+void gray_prepare_frame(gray_keystream *target, const frame_record *record) {
+    uint32_t masks[FRAME_PAYLOAD_LEN][8];
+    gf2_keystream_masks(masks);
+
+    target->low = 0;
+    target->high = 0;
+    for (int i=0; i<FRAME_PAYLOAD_LEN; i++) {
+        uint8_t value = record->payload[i];
+        for (int k=0; k<8; k++) {
+            value ^= gf2_parity32(masks[i][k] & record->header_key) << k;
+        }
+        set_byte(target, i, value);
+    }
+}
+
+/**
+ * Try the keys gray(first) .. gray(end - 1), where gray(i) = i ^ (i >> 1),
+ * and call hit for each one that decodes all the frames. The rejections are
+ * counted in frame_order and check_order.
+ */
+void gray_search(const gray_keystream basis[32], const gray_keystream *targets, size_t frame_count, const payload_constraints *constraints, adaptive_order *frame_order, adaptive_order *check_order, uint64_t first, uint64_t end, gray_hit hit, void *arg) {
+    if (first >= end) {
+        return;
+    }
+
+    // Keystream of the first key, from scratch:
+    uint32_t prepared_key = (uint32_t)(first ^ (first >> 1));
+    gray_keystream stream = {0, 0};
+    for (int b=0; b<32; b++) {
+        if ((prepared_key >> b) & 1) {
+            stream.low ^= basis[b].low;
+            stream.high ^= basis[b].high;
+        }
+    }
+
+    // Almost all the keys die on the first frame: these rejections are
+    // deduced from the others at the end rather than counted.
+    uint64_t counted = frame_order->passes;
+    for (size_t f=1; f<frame_count; f++) {
+        counted += frame_order->rejects[f];
+    }
+    uint64_t already_counted = counted;
+    for (uint64_t i=first; ; ) {
+        size_t f;
+        for (f=0; f<frame_count; f++) {
+            // Check byte:
+            if (((stream.low ^ targets[f].low) & 0xFF) != 0x4B) {
+                break;
+            }
+            gray_keystream decoded = {stream.low ^ targets[f].low, stream.high ^ targets[f].high};
+            uint8_t decoded_frame[FRAME_PAYLOAD_LEN];
+            for (int j=0; j<FRAME_PAYLOAD_LEN; j++) {
+                decoded_frame[j] = get_byte(&decoded, j);
+            }
+            if (!payload_plausible_ordered(constraints, decoded_frame, check_order)) {
+                break;
+            }
+        }
+        if (f == frame_count) {
+            frame_order->passes++;
+            hit(arg, prepared_key);
+        } else if (f != 0) {
+            frame_order->rejects[f]++;
+        }
+
+        if (++i >= end) {
+            break;
+        }
+        // gray(i) = gray(i - 1) with the lowest set bit of i flipped:
+        int b = __builtin_ctzll(i);
+        prepared_key ^= (uint32_t) 1 << b;
+        stream.low ^= basis[b].low;
+        stream.high ^= basis[b].high;
+    }
+    counted = frame_order->passes;
+    for (size_t f=1; f<frame_count; f++) {
+        counted += frame_order->rejects[f];
+    }
+    frame_order->rejects[0] += (end - first) - (counted - already_counted);
+}
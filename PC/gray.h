@@ -0,0 +1,31 @@
+//
+// Enumeration of the prepared keys in Gray code order.
+//
+// The keystream is linear in the seed: keystream(key ^ header_key) =
+// keystream(key) ^ keystream(header_key). Consecutive keys in Gray code order
+// differ by one bit, so the keystream of the next key is the current one
+// XORed with the keystream of that bit: a trial costs a couple of XORs
+// instead of 8 LFSR steps per payload byte.
+//
+
+#ifndef __GRAY_H
+#define __GRAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "search.h"
+
+// The 11 bytes of a keystream or payload, byte i in bits 8 * i of low, then high.
+typedef struct {
+    uint64_t low;
+    uint32_t high;
+} gray_keystream;
+
+typedef void (*gray_hit)(void *arg, uint32_t prepared_key);
+
+void gray_prepare_basis(gray_keystream basis[32]);
+void gray_prepare_frame(gray_keystream *target, const frame_record *record);
+void gray_search(const gray_keystream basis[32], const gray_keystream *targets, size_t frame_count, const payload_constraints *constraints, adaptive_order *frame_order, adaptive_order *check_order, uint64_t first, uint64_t end, gray_hit hit, void *arg);
+
+#endif
@@ -0,0 +1,135 @@
+//
+// Generate the meter key table of the ST code, PRIOS_MeterKeys.h, from a list
+// of meter ids and keys, one per line:
+//   # comment
+//   <meter id> <key>
+// The meter id is in hex, of up to 8 digits, as the collector prints it. The
+// key is in hex too, either the 8 bytes of PRIOS_DEFAULT_KEY1/KEY2 (16 digits)
+// or the prepared key prios_key_cracker prints as a candidate (8 digits), with
+// or without 0x in front. The header is written to the standard output.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <ctype.h>
+
+// Use the PRIOS functions from the ST code.
+#include <PRIOS.h>
+
+uint32_t preparePRIOSKey(uint8_t *bytes);
+
+static int compare_entries(const void *a, const void *b) {
+    const prios_meter_key *x = a;
+    const prios_meter_key *y = b;
+    return (x->A_Id > y->A_Id) - (x->A_Id < y->A_Id);
+}
+
+// Parse the hex digits of text, after an optional 0x: their number, and the
+// bytes they make in bytes, if not NULL, and the value in value. -1 if there
+// are none, or more than max_digits.
+static int parse_hex(const char *text, size_t max_digits, uint8_t *bytes, uint32_t *value) {
+    if (text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+        text += 2;
+    }
+    size_t digits = strlen(text);
+    if (!digits || digits > max_digits) {
+        return -1;
+    }
+    *value = 0;
+    for (size_t i=0; i<digits; i++) {
+        if (!isxdigit((unsigned char) text[i])) {
+            return -1;
+        }
+        int digit = isdigit((unsigned char) text[i]) ? text[i] - '0' : tolower((unsigned char) text[i]) - 'a' + 10;
+        *value = *value << 4 | digit;
+        if (bytes && i % 2) {
+            bytes[i / 2] = *value;
+        }
+    }
+    return digits;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s meter_keys.txt > ../ST-STEVAL-FKI868V1/Inc/PRIOS_MeterKeys.h\n", argv[0]);
+        return 1;
+    }
+    FILE *f = fopen(argv[1], "r");
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    prios_meter_key *entries = NULL;
+    size_t count = 0;
+    char line[256];
+    for (unsigned line_number=1; fgets(line, sizeof(line), f); line_number++) {
+        char id_text[16], key_text[32] = "";
+        if (line[0] == '#' || sscanf(line, "%15s %31s", id_text, key_text) < 1) {
+            continue;
+        }
+        uint8_t key[8];
+        uint32_t id, key_value;
+        int key_digits = parse_hex(key_text, 16, key, &key_value);
+        if (parse_hex(id_text, 8, NULL, &id) < 0 || (key_digits != 8 && key_digits != 16)) {
+            fprintf(stderr, "%s:%u: expected a meter id of up to 8 hex digits, and a key of 16 or a prepared key of 8\n", argv[1], line_number);
+            return 1;
+        }
+        prios_meter_key *grown = realloc(entries, (count + 1) * sizeof(*entries));
+        if (!grown) {
+            perror("realloc");
+            return 1;
+        }
+        entries = grown;
+        entries[count].A_Id = id;
+        entries[count].prepared_key = key_digits == 16 ? preparePRIOSKey(key) : key_value;
+        count++;
+    }
+    fclose(f);
+
+    qsort(entries, count, sizeof(*entries), compare_entries);
+    for (size_t i=1; i<count; i++) {
+        if (entries[i].A_Id == entries[i - 1].A_Id) {
+            fprintf(stderr, "Meter %.8" PRIx32 " is listed more than once\n", entries[i].A_Id);
+            return 1;
+        }
+    }
+
+    printf(
+        "/**\n"
+        "  ******************************************************************************\n"
+        "  * @file           : PRIOS_MeterKeys.h\n"
+        "  * @brief          : The keys of the meters that don't use a default key\n"
+        "  ******************************************************************************\n"
+        "  * Generated by PC/meter_keys from a list of meter ids and keys: do not edit.\n"
+        "  * Only included by PRIOS.c.\n"
+        "  *\n"
+        "  * The entries are sorted by meter id, and hold the keys already prepared by\n"
+        "  * preparePRIOSKey(). The last one is a sentinel.\n"
+        "  */\n"
+        "\n"
+        "#ifndef __PRIOS_METERKEYS_H\n"
+        "#define __PRIOS_METERKEYS_H\n"
+        "\n"
+        "#include <stdint.h>\n"
+        "\n"
+        "#define PRIOS_METER_KEY_COUNT %zu\n"
+        "\n"
+        "static const prios_meter_key PRIOS_METER_KEYS[PRIOS_METER_KEY_COUNT + 1] = {\n",
+        count
+    );
+    for (size_t i=0; i<count; i++) {
+        printf("    {0x%.8" PRIx32 ", 0x%.8" PRIx32 "},\n", entries[i].A_Id, entries[i].prepared_key);
+    }
+    printf(
+        "    {0xFFFFFFFF, 0x00000000}\n"
+        "};\n"
+        "\n"
+        "#endif\n"
+    );
+    free(entries);
+    return 0;
+}
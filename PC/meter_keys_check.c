@@ -0,0 +1,167 @@
+//
+// Check of the keys getMetricsFromPRIOSWMBusFrame() decodes the frames with.
+// It is built against the meter key table meter_keys generates from
+// meter_keys_check.txt, put first on the include path.
+//
+// The prepared default keys of the ST code must be the ones preparePRIOSKey()
+// gives, and meter_keys must have generated the expected table. The meters
+// of the table must be decoded with their key only, in one attempt. The
+// other ones with PRIOS_DEFAULT_KEY1, then PRIOS_DEFAULT_KEY2: a meter of
+// the second key needs two attempts on its first frame, then one as long as
+// its key is cached. The attempts are counted with the stats of
+// the keystream cache, which count every decodePRIOSPayloadCached(). Fails on
+// the first difference.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+
+// Use the PRIOS functions from the ST code, and the generated table.
+#include <PRIOS.h>
+#include <PRIOS_MeterKeys.h>
+
+#define FRAME_LEN (17 + PRIOS_PAYLOAD_LEN)
+#define METER_COUNT 200
+
+extern uint8_t PRIOS_DEFAULT_KEY1[8];
+extern uint8_t PRIOS_DEFAULT_KEY2[8];
+extern const uint32_t PRIOS_DEFAULT_PREPARED_KEYS[2];
+uint32_t preparePRIOSKey(uint8_t *bytes);
+
+// The meters of meter_keys_check.txt, and their prepared keys, sorted.
+static const prios_meter_key table[] = {
+    {0x00001c17, 0x00112233 ^ 0x44556677},
+    {0x00d01c16, 0x01234567 ^ 0x89abcdef},
+    {0x20d01c15, 0x1234abcd},
+    {0x20d01c18, 0x89abcdef},
+};
+#define TABLE_COUNT (sizeof(table) / sizeof(table[0]))
+
+static int failures;
+
+// A frame of meter a_id, encrypted with key, and its decoded payload.
+static void make_frame(uint8_t *frame, uint8_t *payload, uint32_t a_id, uint32_t key) {
+    for (size_t i=0; i<FRAME_LEN; i++) {
+        frame[i] = rand();
+    }
+    for (size_t i=0; i<4; i++) {
+        frame[4 + i] = a_id >> (8 * i);
+    }
+    payload[0] = 0x4B;
+    for (size_t i=1; i<PRIOS_PAYLOAD_LEN; i++) {
+        payload[i] = rand();
+    }
+    // The keystream, from the check byte and a payload of zeros:
+    uint8_t keystream[PRIOS_PAYLOAD_LEN];
+    memset(frame + 17, 0, PRIOS_PAYLOAD_LEN);
+    decodePRIOSPayload(frame, 1, key, keystream);
+    frame[17] = keystream[0] ^ 0x4B;
+    decodePRIOSPayload(frame, PRIOS_PAYLOAD_LEN, key, keystream);
+    for (size_t i=1; i<PRIOS_PAYLOAD_LEN; i++) {
+        frame[17 + i] = payload[i] ^ keystream[i];
+    }
+}
+
+// Whether another key the ST code knows than key gets the check byte of its
+// frames right. The LFSR is linear, so that doesn't depend on the frame: the
+// first bytes of the keystreams of two keys always differ by the same value.
+static int other_key_check_byte(uint32_t key) {
+    uint8_t frame[FRAME_LEN] = {0};
+    uint8_t check;
+    decodePRIOSPayload(frame, 1, key, &check);
+    frame[17] = check ^ 0x4B;
+    for (size_t i=0; i<2; i++) {
+        if (PRIOS_DEFAULT_PREPARED_KEYS[i] != key && decodePRIOSPayload(frame, 1, PRIOS_DEFAULT_PREPARED_KEYS[i], &check)) {
+            return 1;
+        }
+    }
+    for (size_t i=0; i<TABLE_COUNT; i++) {
+        if (table[i].prepared_key != key && decodePRIOSPayload(frame, 1, table[i].prepared_key, &check)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Decode a frame of meter a_id encrypted with key, which must succeed or
+// not, in the given number of attempts.
+static void check_frame(const char *what, uint32_t a_id, uint32_t key, int expected_result, uint32_t expected_attempts) {
+    uint8_t frame[FRAME_LEN];
+    uint8_t payload[PRIOS_PAYLOAD_LEN];
+    make_frame(frame, payload, a_id, key);
+
+    prios_keystream_cache_stats before, after;
+    getPRIOSKeystreamCacheStats(&before);
+    izar_reading reading, expected;
+    memset(&reading, 0, sizeof(reading));
+    memset(&expected, 0, sizeof(expected));
+    int result = getMetricsFromPRIOSWMBusFrame(frame, &reading);
+    getPRIOSKeystreamCacheStats(&after);
+    uint32_t attempts = after.hits + after.misses - before.hits - before.misses;
+
+    parsePRIOSFrame(frame + 13, payload, &expected);
+    if (result != expected_result || attempts != expected_attempts || (result && memcmp(&reading, &expected, sizeof(reading)))) {
+        fprintf(stderr, "%s, meter %.8" PRIx32 ": %s in %" PRIu32 " attempts, expected %s in %" PRIu32 "\n",
+                what, a_id, result ? "decoded" : "not decoded", attempts, expected_result ? "decoded" : "not decoded", expected_attempts);
+        failures++;
+    }
+}
+
+int main(void) {
+    if (preparePRIOSKey(PRIOS_DEFAULT_KEY1) != PRIOS_DEFAULT_PREPARED_KEYS[0] || preparePRIOSKey(PRIOS_DEFAULT_KEY2) != PRIOS_DEFAULT_PREPARED_KEYS[1]) {
+        fprintf(stderr, "The prepared default keys aren't PRIOS_DEFAULT_KEY1 and PRIOS_DEFAULT_KEY2\n");
+        return 1;
+    }
+    if (PRIOS_METER_KEY_COUNT != TABLE_COUNT || memcmp(PRIOS_METER_KEYS, table, sizeof(table))) {
+        fprintf(stderr, "meter_keys didn't generate the table of meter_keys_check.txt\n");
+        return 1;
+    }
+
+    // Otherwise the frames of a key could be decoded with another one.
+    for (size_t i=0; i<TABLE_COUNT; i++) {
+        if (other_key_check_byte(table[i].prepared_key)) {
+            fprintf(stderr, "The key of meter %.8" PRIx32 " gets the check bytes of another one right\n", table[i].A_Id);
+            return 1;
+        }
+    }
+
+    srand(1);
+    uint32_t unknown_key = 0x5A5A5A5A;
+    const uint32_t key1 = PRIOS_DEFAULT_PREPARED_KEYS[0];
+    const uint32_t key2 = PRIOS_DEFAULT_PREPARED_KEYS[1];
+    for (int round=0; round<2; round++) {
+        for (size_t i=0; i<TABLE_COUNT; i++) {
+            check_frame("Table key", table[i].A_Id, table[i].prepared_key, 1, 1);
+            check_frame("Table meter with a default key", table[i].A_Id, key1, 0, 1);
+        }
+    }
+
+    for (uint32_t i=0; i<METER_COUNT; i++) {
+        uint32_t a_id = 0x20d00000 + i * 0x101;
+        if (i % 3 == 0) {
+            check_frame("Key1, first frame", a_id, key1, 1, 1);
+            check_frame("Key1, cached", a_id, key1, 1, 1);
+        } else if (i % 3 == 1) {
+            check_frame("Key2, first frame", a_id, key2, 1, 2);
+            check_frame("Key2, cached", a_id, key2, 1, 1);
+            check_frame("Key2, cached", a_id, key2, 1, 1);
+            // The meter changed keys: the cached one is tried first.
+            check_frame("Key1 after key2", a_id, key1, 1, 2);
+            check_frame("Key1 after key2, cached", a_id, key1, 1, 1);
+        } else {
+            do {
+                unknown_key += 0x01020305;
+            } while (other_key_check_byte(unknown_key));
+            check_frame("Unknown key", a_id, unknown_key, 0, 2);
+        }
+    }
+
+    if (failures) {
+        return 1;
+    }
+    fprintf(stderr, "Meter keys: %zu table meters and %d default key meters decoded as expected\n", TABLE_COUNT, METER_COUNT);
+    return 0;
+}
@@ -0,0 +1,260 @@
+//
+// Load test of the receive pipeline of the ST code: a producer thread plays
+// the radio and its interrupts: it has a fake S2-LP receive the frames, and
+// runs the receiver of the ST code against it, from the radio interrupt to
+// the completion of the last SPI transfer, at a fixed
+// interval or as fast as it can, while the main thread plays the main loop
+// and decodes them. The readings are printed to a temporary file, the
+// results to stderr.
+//
+// Every frame the consumer gets is compared with the one pushed, to catch a
+// slot read before it was complete, and so are the SPI status bytes in front
+// of it; the fake SPI must have written the slot and nothing else, and the
+// radio must be back in RX for the next frame, also after the frames it
+// discards. The receiver must not wait on any transfer, and must be idle
+// once the last one is done. The frames seen, dropped and pushed must add
+// up, and every frame seen must have been printed as the reading of its
+// meter.
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+// Use the receive pipeline from the ST code.
+#include <FramePipeline.h>
+#include <FrameReceiver.h>
+#include <PRIOS.h>
+#include <WMBus.h>
+
+#include "spi_stub.h"
+
+#define POOL_SIZE 256
+#define IZAR_FRAME_LEN 30
+
+uint32_t preparePRIOSKey(uint8_t *bytes);
+extern uint8_t PRIOS_DEFAULT_KEY1[8];
+
+static uint8_t pool[POOL_SIZE][IZAR_FRAME_LEN];
+// The CSV line of the reading of each frame of the pool.
+static char pool_lines[POOL_SIZE][PRIOS_CSV_LINE_MAX + 1];
+static uint64_t frame_count;
+static uint64_t interval_ns;
+static atomic_int producer_done;
+static uint64_t misplaced;
+static uint64_t not_rejected;
+static uint64_t stuck;
+
+// The status bytes the SPI returns with frame i.
+static uint16_t frame_status(uint32_t i) {
+    return 0xA500 | (i & 0xFF);
+}
+
+static void seal_block(uint8_t *block, size_t len) {
+    uint16_t crc = ~crcUpdate(0, block, len);
+    block[len] = crc >> 8;
+    block[len + 1] = crc;
+}
+
+// An IZAR frame from meter i, encrypted with the default key, with valid
+// CRCs.
+static void make_frame(uint8_t *frame, uint32_t i) {
+    static const uint8_t header[] = {0x19, 0x44, 0x30, 0x4C};
+    memcpy(frame, header, sizeof(header));
+    uint32_t a_id = 0x20d00000 + i;
+    for (size_t j=0; j<4; j++) {
+        frame[4 + j] = a_id >> (8 * j);
+    }
+    frame[8] = 0xD4;
+    frame[9] = 0x01;
+    frame[12] = 0xA1;
+    frame[13] = 0x13;
+    frame[14] = 0x00;
+    frame[15] = i;
+    frame[16] = 0x13;
+
+    // The keystream, from the check byte and a payload of zeros:
+    uint32_t key = preparePRIOSKey(PRIOS_DEFAULT_KEY1);
+    uint8_t keystream[11];
+    memset(frame + 17, 0, 11);
+    decodePRIOSPayload(frame, 1, key, keystream);
+    frame[17] = keystream[0] ^ 0x4B;
+    decodePRIOSPayload(frame, 11, key, keystream);
+    uint8_t payload[11] = {0x4B, i, i >> 8, 0, 0, i, i >> 8, 0, 0, 0x21, 0x14};
+    for (size_t j=1; j<11; j++) {
+        frame[17 + j] = payload[j] ^ keystream[j];
+    }
+    seal_block(frame, 10);
+    seal_block(frame + 12, 16);
+}
+
+// What the firmware does from the SPI DMA interrupt.
+void SdkEvalSpiRawTC(void) {
+    frameReceiverOnTransferComplete(&rxFrameReceiver);
+}
+
+// Count the readings printed, and the ones that aren't the reading of a
+// frame of the pool.
+static uint64_t count_readings(FILE *f, uint64_t *wrong) {
+    char line[PRIOS_CSV_LINE_MAX + 1];
+    uint64_t count = 0;
+    *wrong = 0;
+    while (fgets(line, sizeof(line), f)) {
+        uint32_t i = strtoul(line, NULL, 16) - 0x20d00000;
+        if (i >= POOL_SIZE || strcmp(line, pool_lines[i])) {
+            (*wrong)++;
+        }
+        count++;
+    }
+    return count;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void *producer(void *arg) {
+    (void) arg;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (uint64_t i=0; i<frame_count; i++) {
+        if (interval_ns) {
+            next.tv_nsec += interval_ns;
+            while (next.tv_nsec >= 1000000000) {
+                next.tv_nsec -= 1000000000;
+                next.tv_sec++;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        }
+        // Now and then a frame the radio discards, after which it must be
+        // put back in RX.
+        if (i % 16 == 0 && spi_stub_discard()) {
+            frameReceiverOnIrq(&rxFrameReceiver);
+            while (spi_stub_complete()) {
+            }
+        }
+        if (!spi_stub_receive(pool[i % POOL_SIZE], IZAR_FRAME_LEN, frame_status(i % POOL_SIZE))) {
+            continue;
+        }
+        // The radio interrupt starts the reception, and a second one can't
+        // until the radio is back in RX: it's handled then.
+        uint32_t kept = rxFrameReceiver.frames_kept;
+        frameReceiverOnIrq(&rxFrameReceiver);
+        if (frameReceiverOnIrq(&rxFrameReceiver)) {
+            not_rejected++;
+        }
+        // Then the SPI DMA interrupts run it to the end.
+        while (spi_stub_complete()) {
+            if (rxFrameReceiver.frames_kept != kept) {
+                const frame_ring_slot *slot = &rxFrameRing.slots[(rxFrameRing.head - 1) & (FRAME_RING_SLOTS - 1)];
+                const spi_stub_stats *spi = spi_stub_get_stats();
+                if (spi->buffer != slot->prefix || spi->written != FRAME_RING_PREFIX_SIZE + IZAR_FRAME_LEN) {
+                    misplaced++;
+                }
+                kept = rxFrameReceiver.frames_kept;
+            }
+        }
+        if (frameReceiverBusy(&rxFrameReceiver)) {
+            stuck++;
+        }
+    }
+    atomic_store(&producer_done, 1);
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    frame_count = argc > 1 ? strtoull(argv[1], NULL, 0) : 1000000;
+    interval_ns = argc > 2 ? strtoull(argv[2], NULL, 0) : 0;
+    for (uint32_t i=0; i<POOL_SIZE; i++) {
+        make_frame(pool[i], i);
+        izar_reading reading;
+        if (!getMetricsFromPRIOSWMBusFrame(pool[i], &reading)) {
+            fprintf(stderr, "Frame %" PRIu32 " of the pool doesn't decode\n", i);
+            return 1;
+        }
+        uint8_t len = formatIZARReadingAsCSV(pool_lines[i], 0x20d00000 + i, &reading);
+        // fgets() reads the \r\n as it is.
+        pool_lines[i][len] = 0;
+    }
+    char output_path[] = "/tmp/pipeline_bench.XXXXXX";
+    int output_fd = mkstemp(output_path);
+    if (output_fd < 0 || !freopen(output_path, "w", stdout)) {
+        perror(output_path);
+        return 1;
+    }
+    close(output_fd);
+    frameRingInit(&rxFrameRing);
+    frameReceiverInit(&rxFrameReceiver, &rxFrameRing);
+    spi_stub_init();
+
+    uint64_t start = now_ns();
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, producer, NULL)) {
+        perror("pthread_create");
+        return 1;
+    }
+    // The frames that made it into the ring are the ones not dropped, in
+    // order: the consumer can't know which, so it matches them against the
+    // pool by their meter id.
+    uint64_t seen = 0;
+    uint64_t corrupted = 0;
+    for (;;) {
+        int done = atomic_load(&producer_done);
+        const frame_ring_slot *slot;
+        while ((slot = frameRingPeek(&rxFrameRing)) != NULL) {
+            uint16_t status = frame_status(slot->data[4]);
+            if (slot->length != IZAR_FRAME_LEN || memcmp(slot->data, pool[slot->data[4]], IZAR_FRAME_LEN) || slot->prefix[0] != status >> 8 || slot->prefix[1] != (uint8_t) status) {
+                corrupted++;
+            }
+            handleReceivedFrame(slot->data, slot->length);
+            frameRingRelease(&rxFrameRing);
+            seen++;
+        }
+        if (done && !frameRingPeek(&rxFrameRing)) {
+            break;
+        }
+        // Let the producer run if it shares the CPU.
+        sched_yield();
+    }
+    pthread_join(thread, NULL);
+    double seconds = (now_ns() - start) / 1e9;
+
+    fflush(stdout);
+    FILE *output = fopen(output_path, "r");
+    if (!output) {
+        perror(output_path);
+        return 1;
+    }
+    uint64_t wrong;
+    uint64_t decoded = count_readings(output, &wrong);
+    fclose(output);
+    unlink(output_path);
+
+    prios_keystream_cache_stats cache;
+    getPRIOSKeystreamCacheStats(&cache);
+    fprintf(stderr, "%" PRIu64 " frames pushed every %" PRIu64 " ns: %" PRIu64 " seen, %" PRIu64 " decoded, %" PRIu64 " wrong readings, %" PRIu32 " dropped (ring full), %" PRIu64 " corrupted, %" PRIu64 " misplaced, %.0f frames/s, keystream cache %" PRIu32 " hits %" PRIu32 " misses\n",
+            frame_count, interval_ns, seen, decoded, wrong, rxFrameRing.dropped_full, corrupted, misplaced, frame_count / seconds, cache.hits, cache.misses);
+    const spi_stub_stats *spi = spi_stub_get_stats();
+    fprintf(stderr, "SPI: %" PRIu64 " transfers, %" PRIu64 " blocking, %" PRIu64 " overlapping, %" PRIu64 " unknown, %" PRIu64 " FIFO underruns, %" PRIu64 " RX before flush, %" PRIu64 " frames missed, %" PRIu64 " receptions started while busy, %" PRIu64 " left busy\n",
+            spi->transfers, spi->blocking, spi->overlaps, spi->unknown, spi->underruns, spi->unflushed_rx, spi->missed, not_rejected, stuck);
+    if (decoded != seen || wrong) {
+        fprintf(stderr, "The frames seen weren't all decoded\n");
+        return 1;
+    }
+    if (corrupted || misplaced || spi->blocking || stuck || spi->overlaps || spi->unknown || spi->underruns || spi->unflushed_rx || spi->missed || not_rejected || seen + rxFrameRing.dropped_full != frame_count) {
+        fprintf(stderr, "The frames don't add up\n");
+        return 1;
+    }
+    return 0;
+}
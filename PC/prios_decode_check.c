@@ -0,0 +1,127 @@
+//
+// Check of the keystream of the ST code: decodePRIOSPayload() steps the LFSR
+// a byte at a time, with a table, and decodePRIOSPayloadCached() keeps the
+// keystreams it computed. Both must decode exactly as the original loop, a
+// bit at a time, kept here as the reference.
+//
+// Most frames are given the check byte their key decodes to 0x4B, so that the
+// whole payloads are compared, and each frame is decoded several times, with
+// its payload changed in between, to go through the hits of the cache. Fails
+// on the first difference.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+
+// Use the PRIOS functions from the ST code.
+#include <PRIOS.h>
+
+#define FRAME_COUNT 300000
+#define MAX_PAYLOAD_LEN 32
+#define FRAME_LEN (17 + MAX_PAYLOAD_LEN)
+// Decodings of each frame, the first one filling the cache.
+#define REPEATS 3
+
+extern uint32_t read_uint32_be(const uint8_t * const data, int offset);
+
+// decodePRIOSPayload() as it was, one bit of the LFSR at a time.
+static uint8_t reference_decode(const uint8_t *in, uint8_t payload_len, uint32_t key, uint8_t *out) {
+    key ^= read_uint32_be(in, 2); // manufacturer + address[0-1]
+    key ^= read_uint32_be(in, 6); // address[2-3] + version + type
+    key ^= read_uint32_be(in, 12); // ci + some more bytes from the telegram...
+
+    for (int i = 0; i < payload_len; ++i) {
+        // calculate new key (LFSR)
+        for (int j = 0; j < 8; ++j) {
+            // calculate new bit value (xor of selected bits from previous key)
+            uint8_t bit = ((key & 0x2) != 0) ^ ((key & 0x4) != 0) ^ ((key & 0x800) != 0) ^ ((key & 0x80000000) != 0);
+            // shift key bits and add new one at the end
+            key = (key << 1) | bit;
+        }
+        // decode i-th content byte with fresh/last 8-bits of key
+        out[i] = in[i + 17] ^ (key & 0xFF);
+        // check-byte doesn't match?
+        if (out[0] != 0x4B) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static uint32_t random32(void) {
+    return (uint32_t) rand() << 16 ^ (uint32_t) rand();
+}
+
+// Compare a decoding with the reference, on what the reference wrote.
+static int same(const char *name, uint8_t result, const uint8_t *out, uint8_t expected_result, const uint8_t *expected, uint8_t payload_len, size_t frame) {
+    size_t compared = expected_result ? payload_len : (payload_len ? 1 : 0);
+    if (result != expected_result || memcmp(out, expected, compared)) {
+        fprintf(stderr, "%s: frame %zu, payload of %u bytes, decoded differently than the bit loop\n", name, frame, payload_len);
+        return 0;
+    }
+    return 1;
+}
+
+int main(void) {
+    uint8_t in[FRAME_LEN];
+    uint8_t expected[MAX_PAYLOAD_LEN];
+    uint8_t out[MAX_PAYLOAD_LEN];
+    size_t decoded = 0;
+
+    srand(1);
+    clearPRIOSKeystreamCache();
+    for (size_t frame=0; frame<FRAME_COUNT; frame++) {
+        // Half of them from 16 meters with the same header words, so that
+        // their seeds come back.
+        for (size_t i=0; i<FRAME_LEN; i++) {
+            in[i] = rand();
+        }
+        uint32_t key = random32();
+        if (frame % 2) {
+            in[12] = in[13] = in[14] = in[15] = 0;
+            memset(in + 2, frame % 16, 8);
+            key = (frame % 16) * 0x01010101u;
+        }
+        uint8_t payload_len = frame % (MAX_PAYLOAD_LEN + 1);
+        if (rand() % 4) {
+            // The check byte of this key.
+            reference_decode(in, 1, key, out);
+            in[17] ^= out[0] ^ 0x4B;
+        }
+
+        for (int repeat=0; repeat<REPEATS; repeat++) {
+            uint8_t expected_result = reference_decode(in, payload_len, key, expected);
+            memset(out, 0, sizeof(out));
+            if (!same("decodePRIOSPayload", decodePRIOSPayload(in, payload_len, key, out), out, expected_result, expected, payload_len, frame)) {
+                return 1;
+            }
+            memset(out, 0, sizeof(out));
+            if (!same("decodePRIOSPayloadCached", decodePRIOSPayloadCached(in, payload_len, key, out), out, expected_result, expected, payload_len, frame)) {
+                return 1;
+            }
+            decoded += expected_result;
+            // Another payload with the same seed: the cache must not keep the
+            // previous one. Keep the check byte a third of the time.
+            for (size_t i=18; i<FRAME_LEN; i++) {
+                in[i] = rand();
+            }
+            if (rand() % 3) {
+                in[17] = rand();
+            }
+        }
+    }
+
+    prios_keystream_cache_stats stats;
+    getPRIOSKeystreamCacheStats(&stats);
+    fprintf(stderr, "Keystream: same as the bit loop on %d decodings, %zu with the right check byte, cache %" PRIu32 " hits %" PRIu32 " misses\n",
+            FRAME_COUNT * REPEATS, decoded, stats.hits, stats.misses);
+    if (PRIOS_KEYSTREAM_CACHE_SETS > 0 && !stats.hits) {
+        fprintf(stderr, "The keystream cache was never hit\n");
+        return 1;
+    }
+    return 0;
+}
@@ -3,18 +3,42 @@
 // Unpolished code: do not use in production.
 //
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
 #include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <getopt.h>
 
 // Use the PRIOS functions from the ST code.
 #include <PRIOS.h>
 #include "config.h"
+#include "constraints.h"
+#include "search.h"
+#include "bitslice.h"
+#include "gf2_solver.h"
+#include "capture.h"
+#include "checkpoint.h"
+#include "stats.h"
+#include "batch.h"
+
+// Above this many free bits, the solver gives up checking the keys left.
+#define GF2_MAX_DIMENSION 24
+
+// Seconds between two checkpoint saves during a search.
+#define CHECKPOINT_INTERVAL 60
 
 // Declare those since they're not exported by the ST code.
 uint32_t read_uint32_le(uint8_t *data, int offset);
 uint32_t read_uint32_be(uint8_t *data, int offset);
 uint32_t preparePRIOSKey(uint8_t *bytes);
+extern uint8_t PRIOS_DEFAULT_KEY1[8];
+extern uint8_t PRIOS_DEFAULT_KEY2[8];
 
 // Try to decode a payload with a key:
 uint8_t try_key(uint8_t *key_bytes, uint8_t *frame, uint8_t *out) {
@@ -22,76 +46,413 @@ uint8_t try_key(uint8_t *key_bytes, uint8_t *frame, uint8_t *out) {
     return decodePRIOSPayload(frame, 11, prepared_key, out);
 }
 
+// What the decoded payloads must look like, from -C or config.h:
+payload_constraints constraints;
+
+// The constraints of config.h, when none are given on the command line:
+void default_constraints(payload_constraints *c) {
+    constraints_init(c);
+    c->h0_le_current = 1;
+#ifdef CONSUMPTION_RANGE_MIN
+    constraints_add_range(c, FIELD_CURRENT, CONSUMPTION_RANGE_MIN, UINT32_MAX);
+    constraints_add_range(c, FIELD_H0, CONSUMPTION_RANGE_MIN, UINT32_MAX);
+#endif
+#ifdef CONSUMPTION_RANGE_MAX
+    constraints_add_range(c, FIELD_CURRENT, 0, CONSUMPTION_RANGE_MAX);
+    constraints_add_range(c, FIELD_H0, 0, CONSUMPTION_RANGE_MAX);
+#endif
+#ifdef TEST_YEAR
+    constraints_add_range(c, FIELD_YEAR, TEST_YEAR, TEST_YEAR);
+#endif
+#ifdef TEST_MONTH
+    constraints_add_range(c, FIELD_MONTH, TEST_MONTH, TEST_MONTH);
+#endif
+#ifdef TEST_DAY
+    constraints_add_range(c, FIELD_DAY, TEST_DAY, TEST_DAY);
+#endif
+}
+
 // Check that a decoded payload is coherent with the data we expect:
 uint8_t check_decoded_payload(uint8_t *decoded_frame, uint32_t *total_consumption, uint32_t *last_month_total_consumption, uint8_t *year, uint8_t *month, uint8_t *day) {
-    // Check that the consumptions look correct:
     *total_consumption = read_uint32_le(decoded_frame, 1);
     *last_month_total_consumption = read_uint32_le(decoded_frame, 5);
-    if (*last_month_total_consumption > *total_consumption) {
-        return 0;
+    *year = ((decoded_frame[10] & 0xF0) >> 1) + ((decoded_frame[9] & 0xE0) >> 5);
+    *month = decoded_frame[10] & 0xF;
+    *day = decoded_frame[9] & 0x1F;
+    return payload_plausible(&constraints, decoded_frame);
+}
+
+// Print the 8 byte keys that preparePRIOSKey() reduces to a prepared key.
+// The key is split in two big-endian words, and only their XOR matters: every
+// one of the 2^32 values of the first word gives a key of the class.
+void print_key_class(uint32_t prepared_key) {
+    uint32_t default_key_high = read_uint32_be(PRIOS_DEFAULT_KEY1, 4);
+    uint32_t default_key_low = prepared_key ^ default_key_high;
+
+    printf("  Equivalent keys: {a0, a1, a2, a3, b0, b1, b2, b3} with 0xa0a1a2a3 ^ 0xb0b1b2b3 == 0x%.8" PRIx32 ", e.g.:\n", prepared_key);
+    printf(
+        "    {0x%.2x, 0x%.2x, 0x%.2x, 0x%.2x, 0x00, 0x00, 0x00, 0x00}\n",
+        (uint8_t)(prepared_key >> 24), (uint8_t)(prepared_key >> 16), (uint8_t)(prepared_key >> 8), (uint8_t)prepared_key
+    );
+    printf(
+        "    {0x%.2x, 0x%.2x, 0x%.2x, 0x%.2x, 0x%.2x, 0x%.2x, 0x%.2x, 0x%.2x} (PRIOS_DEFAULT_KEY1/KEY2 layout)\n",
+        (uint8_t)(default_key_low >> 24), (uint8_t)(default_key_low >> 16), (uint8_t)(default_key_low >> 8), (uint8_t)default_key_low,
+        PRIOS_DEFAULT_KEY1[4], PRIOS_DEFAULT_KEY1[5], PRIOS_DEFAULT_KEY1[6], PRIOS_DEFAULT_KEY1[7]
+    );
+    if (prepared_key == preparePRIOSKey(PRIOS_DEFAULT_KEY1)) {
+        printf("  This is PRIOS_DEFAULT_KEY1.\n");
     }
-#ifdef CONSUMPTION_RANGE_MIN
-    if (*total_consumption < CONSUMPTION_RANGE_MIN) {
-        return 0;
+    if (prepared_key == preparePRIOSKey(PRIOS_DEFAULT_KEY2)) {
+        printf("  This is PRIOS_DEFAULT_KEY2.\n");
     }
-    if (*last_month_total_consumption < CONSUMPTION_RANGE_MIN) {
-        return 0;
+}
+
+// Print a prepared key that decodes all the frames, with the first decoded frame:
+void print_candidate(const frame_set *set, uint32_t prepared_key) {
+	uint32_t total_consumption; uint32_t last_month_total_consumption; uint8_t year; uint8_t month; uint8_t day;
+    uint8_t decoded_frame[11];
+
+    decodePRIOSPayload(set->frames[0], 11, prepared_key, decoded_frame);
+    check_decoded_payload(decoded_frame, &total_consumption, &last_month_total_consumption, &year, &month, &day);
+    printf(
+        "Candidate prepared key: 0x%.8" PRIx32 ": First frame: current: %" PRIu32 ", H0: %" PRIu32 " H0 date: %.2d-%.2d-%.2d\n",
+        prepared_key, total_consumption, last_month_total_consumption, year, month, day
+    );
+    print_key_class(prepared_key);
+}
+
+// How a search is split and saved: this process searches shard_index of
+// shard_count shards, saving its progress in checkpoint_path if set.
+typedef struct {
+    unsigned shard_index;
+    unsigned shard_count;
+    const char *checkpoint_path;
+    int resume;
+    int json_stats;
+} search_job;
+
+typedef struct {
+    checkpoint cp;
+    const char *path;
+    time_t last_save;
+} checkpoint_writer;
+
+static search_context *running_search;
+static batch_search *running_batch;
+
+static void stop_search(int signal_number) {
+    (void) signal_number;
+    if (running_search) {
+        search_stop(running_search);
     }
-#endif
-#ifdef CONSUMPTION_RANGE_MAX
-    if (*total_consumption > CONSUMPTION_RANGE_MAX) {
-        return 0;
+    if (running_batch) {
+        batch_stop(running_batch);
     }
-    if (*last_month_total_consumption > CONSUMPTION_RANGE_MAX) {
-        return 0;
+}
+
+static void catch_stop_signals(void) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stop_search;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+}
+
+static void save_checkpoint(checkpoint_writer *writer, search_context *ctx) {
+    if (checkpoint_snapshot(&writer->cp, ctx) != 0 || checkpoint_save(&writer->cp, writer->path) != 0) {
+        fprintf(stderr, "Cannot save the checkpoint to %s\n", writer->path);
     }
-#endif
+    writer->last_save = time(NULL);
+}
 
-    // Check that the date is correct:
-    *year = ((decoded_frame[10] & 0xF0) >> 1) + ((decoded_frame[9] & 0xE0) >> 5);
-    *month = decoded_frame[10] & 0xF;
-    *day = decoded_frame[9] & 0x1F;
-    if (*year > 99 || *month > 12 || *day > 31) {
+static void checkpoint_hook(search_context *ctx, void *arg) {
+    checkpoint_writer *writer = arg;
+    if (time(NULL) - writer->last_save >= CHECKPOINT_INTERVAL) {
+        save_checkpoint(writer, ctx);
+    }
+}
+
+// Print the candidates of a checkpoint, and how much of the key space it covers:
+uint32_t print_checkpoint(const checkpoint *cp) {
+    uint64_t done_count = checkpoint_done_count(cp);
+    printf(
+        "%" PRIu64 "/%" PRIu64 " chunks of prepared keys searched (%.1f%%)\n",
+        done_count, (uint64_t) SEARCH_KEY_CHUNKS, 100.0 * done_count / SEARCH_KEY_CHUNKS
+    );
+    for (size_t i=0; i<cp->candidate_count; i++) {
+        printf("Candidate prepared key: 0x%.8" PRIx32 "\n", cp->candidates[i]);
+        print_key_class(cp->candidates[i]);
+    }
+    printf("%zu candidate prepared key(s) found\n", cp->candidate_count);
+    return cp->candidate_count;
+}
+
+// Merge the checkpoints of the shards of a search, and save the result to
+// out_path if set:
+uint32_t merge_checkpoints(char **paths, int path_count, const char *out_path) {
+    checkpoint merged, shard;
+    for (int i=0; i<path_count; i++) {
+        if (checkpoint_load(&shard, paths[i]) != 0) {
+            fprintf(stderr, "Cannot load the checkpoint %s\n", paths[i]);
+            exit(2);
+        }
+        if (i == 0) {
+            merged = shard;
+            continue;
+        }
+        if (checkpoint_merge(&merged, &shard) != 0) {
+            fprintf(stderr, "Cannot merge %s: not from the same search as %s\n", paths[i], paths[0]);
+            exit(2);
+        }
+        checkpoint_free(&shard);
+    }
+    if (out_path && checkpoint_save(&merged, out_path) != 0) {
+        exit(2);
+    }
+
+    uint32_t found_keys = print_checkpoint(&merged);
+    checkpoint_free(&merged);
+    return found_keys;
+}
+
+// Loop over all the 2^32 prepared keys. This covers every distinct decryption.
+uint32_t search_prepared_keys(const frame_set *set, unsigned thread_count, search_engine engine, const bitslice_kernel *kernel, const search_job *job) {
+    uint32_t found_keys = 0;
+    search_context ctx;
+    checkpoint_writer writer;
+
+    printf("Searching with the %s kernel\n", engine == SEARCH_BITSLICE ? kernel->name : engine == SEARCH_GRAY ? "gray" : "scalar");
+    search_init(&ctx, set, &constraints, engine, kernel, 0, 1ULL << 32);
+    ctx.json_stats = job->json_stats;
+    if (job->shard_count > 1) {
+        printf("Shard %u/%u\n", job->shard_index, job->shard_count);
+        search_set_shard(&ctx, job->shard_index, job->shard_count);
+    }
+
+    if (job->checkpoint_path) {
+        uint64_t fingerprint = checkpoint_fingerprint(set, &constraints);
+        int loaded = job->resume ? checkpoint_load(&writer.cp, job->checkpoint_path) : 1;
+        if (loaded < 0) {
+            exit(2);
+        }
+        if (loaded == 0) {
+            if (writer.cp.fingerprint != fingerprint) {
+                fprintf(stderr, "%s is the checkpoint of another search (different frames or constraints)\n", job->checkpoint_path);
+                exit(2);
+            }
+            printf(
+                "Resuming from %s: %" PRIu64 " chunks done, %zu candidate(s)\n",
+                job->checkpoint_path, checkpoint_done_count(&writer.cp), writer.cp.candidate_count
+            );
+            checkpoint_restore(&writer.cp, &ctx);
+        } else {
+            checkpoint_init(&writer.cp, fingerprint);
+        }
+        writer.path = job->checkpoint_path;
+        writer.last_save = time(NULL);
+        ctx.report_hook = checkpoint_hook;
+        ctx.report_arg = &writer;
+    }
+
+    // Stop cleanly on SIGINT/SIGTERM, so that the checkpoint is up to date:
+    running_search = &ctx;
+    catch_stop_signals();
+
+    if (search_run(&ctx, thread_count, 2) != 0) {
+        exit(2);
+    }
+    running_search = NULL;
+    if (job->checkpoint_path) {
+        save_checkpoint(&writer, &ctx);
+        checkpoint_free(&writer.cp);
+    }
+    if (atomic_load(&ctx.stop)) {
+        printf("Stopped before the end of the search");
+        if (job->checkpoint_path) {
+            printf(": resume it with --checkpoint %s --resume", job->checkpoint_path);
+        }
+        printf("\n");
+    }
+
+    search_candidate *candidates = search_take_candidates(&ctx);
+    for (search_candidate *c=candidates; c; c=c->next) {
+        print_candidate(set, c->prepared_key);
+        found_keys++;
+    }
+    search_free_candidates(candidates);
+
+    printf("Done: %" PRIu32 " candidate prepared key(s) found\n", found_keys);
+    return found_keys;
+}
+
+// Sweep the prepared keys once for all the meters of a capture, and print the
+// key of each meter and the meters sharing a key. Returns the number of meters
+// with a key.
+uint32_t search_meter_keys(const capture *cap, unsigned thread_count, int json_stats) {
+    batch_search batch;
+    if (batch_init(&batch, cap, &constraints) != 0) {
+        perror("batch_init");
+        exit(2);
+    }
+    batch.json_stats = json_stats;
+    size_t swept_count = batch.bucket_start[256];
+    printf("Searching the keys of %zu meter(s) in a single sweep", swept_count);
+    if (batch.meter_count < cap->group_count) {
+        printf(", %zu without any frame passing the header constraints", cap->group_count - batch.meter_count);
+    }
+    printf("\n");
+    if (swept_count == 0) {
+        fprintf(stderr, "No meter to work on\n");
+        exit(2);
+    }
+
+    running_batch = &batch;
+    catch_stop_signals();
+    if (batch_run(&batch, thread_count, 2) != 0) {
+        exit(2);
+    }
+    running_batch = NULL;
+    if (atomic_load(&batch.stop)) {
+        printf("Stopped before the end of the search: the keys below are the ones found so far\n");
+    }
+
+    uint32_t found_meters = 0;
+    for (size_t m=0; m<batch.meter_count; m++) {
+        const batch_meter *meter = &batch.meters[m];
+        printf("Meter %.8" PRIx32 " (%zu frames): ", meter->meter_id, meter->set.count);
+        if (!meter->consistent) {
+            printf("no key can decode the check byte of all its frames\n");
+            continue;
+        }
+        if (meter->key_count == 0) {
+            printf("no key found\n");
+            continue;
+        }
+        for (size_t k=0; k<meter->key_count; k++) {
+            printf("%s0x%.8" PRIx32, k ? ", " : "", meter->keys[k]);
+        }
+        printf("\n");
+        found_meters++;
+    }
+
+    batch_shared_key *shared;
+    size_t shared_count = batch_shared_keys(&batch, &shared);
+    if (shared_count == (size_t) -1) {
+        perror("batch_shared_keys");
+        exit(2);
+    }
+    for (size_t i=0; i<shared_count; i++) {
+        printf("Prepared key 0x%.8" PRIx32 " is shared by %zu meters:", shared[i].prepared_key, shared[i].meter_count);
+        for (size_t j=0; j<shared[i].meter_count; j++) {
+            printf(" %.8" PRIx32, shared[i].meter_ids[j]);
+        }
+        printf("\n");
+        print_key_class(shared[i].prepared_key);
+    }
+    batch_free_shared_keys(shared, shared_count);
+
+    printf("Done: keys found for %" PRIu32 " of %zu meter(s)\n", found_meters, batch.meter_count);
+    batch_free(&batch);
+    return found_meters;
+}
+
+// Solve the prepared key from the bits of the decoded payloads we know, then
+// check the few keys that satisfy them against all the frames.
+uint32_t solve_prepared_keys(const frame_set *set, const gf2_known_bit *extra_bits, size_t extra_count) {
+    gf2_known_bit known_bits[8 * FRAME_PAYLOAD_LEN * 2];
+    size_t known_count = gf2_known_bits_from_constraints(&constraints, known_bits);
+    uint32_t found_keys = 0;
+    uint8_t decoded_frame[11];
+    gf2_solution solution;
+
+    memcpy(&known_bits[known_count], extra_bits, extra_count * sizeof(extra_bits[0]));
+    known_count += extra_count;
+
+    if (!gf2_solve(set->records, set->count, known_bits, known_count, &solution)) {
+        printf("No prepared key matches the known plaintext: check the constraints, or whether all the frames use the same key\n");
         return 0;
     }
-#ifdef TEST_YEAR
-    if (*year != TEST_YEAR) {
+    printf(
+        "%u equations from %zu known bits per frame: %" PRIu64 " prepared key(s) to check\n",
+        solution.equation_count, known_count, (uint64_t) 1 << solution.dimension
+    );
+    if (solution.dimension > GF2_MAX_DIMENSION) {
+        printf("Too many keys left: add known bytes with -b, or use the brute-force search\n");
         return 0;
     }
-#endif
-#ifdef TEST_MONTH
-    if (*month != TEST_MONTH) {
+
+    for (uint64_t i=0; i<((uint64_t) 1 << solution.dimension); i++) {
+        uint32_t prepared_key = gf2_solution_key(&solution, i);
+        size_t j;
+        for (j=0; j<set->count; j++) {
+            if (!decodePRIOSPayload(set->frames[j], 11, prepared_key, decoded_frame) || !payload_plausible(&constraints, decoded_frame)) {
+                break;
+            }
+        }
+        if (j == set->count && payload_sequence_plausible(&constraints, (const uint8_t (*)[FRAME_LEN]) set->frames, set->count, prepared_key)) {
+            print_candidate(set, prepared_key);
+            found_keys++;
+        }
+    }
+
+    printf("Done: %" PRIu32 " candidate prepared key(s) found\n", found_keys);
+    return found_keys;
+}
+
+// Parse a known decoded byte, as "offset=value":
+int parse_known_byte(const char *arg, gf2_known_bit *out) {
+    char *end;
+    unsigned long offset = strtoul(arg, &end, 0);
+    if (*end != '=' || offset >= FRAME_PAYLOAD_LEN) {
         return 0;
     }
-#endif
-#ifdef TEST_DAY
-    if (*day != TEST_DAY) {
+    unsigned long value = strtoul(end + 1, &end, 0);
+    if (*end != '\0' || value > 0xFF) {
         return 0;
     }
-#endif
-
+    for (uint8_t b=0; b<8; b++) {
+        out[b].byte = offset;
+        out[b].bit = b;
+        out[b].value = (value >> b) & 1;
+    }
     return 1;
 }
 
-int main(void) {
+// Loop over the 8 byte keys, as they are written in the firmware. Never completes.
+uint32_t search_raw_keys(const frame_set *set, int json_stats) {
 	uint32_t total_consumption; uint32_t last_month_total_consumption; uint8_t year; uint8_t month; uint8_t day;
-    uint8_t found_keys = 0;
+    uint32_t found_keys = 0;
     uint8_t decoded_frame[11];
-    time_t prevtime = 0;
+
+    // The reporter thread prints the progress, the loop only counts:
+    stats_counters *stats = stats_alloc(1);
+    if (!stats) {
+        perror("stats_alloc");
+        exit(2);
+    }
+    stats_reporter reporter = {
+        .counters = stats,
+        .counter_count = 1,
+        .key_name = "raw keys",
+        .interval = 2,
+        .json = json_stats,
+    };
+    if (stats_reporter_start(&reporter) != 0) {
+        exit(2);
+    }
 
     // Loop over all the possible keys:
     for (uint64_t i=0; i<0xffffffffffffffff; i++) {
-        time_t curtime = time(NULL);
-        if (curtime > prevtime + 1) {
-            printf("%.16llx keys tried\n", i);
-            prevtime = curtime;
+        if ((i & 0xFFFF) == 0xFFFF) {
+            stats_add(&stats->keys, 0x10000);
         }
 
         // Test all frames in sequence until one fails:
         uint8_t success = 1;
-        for (uint8_t j=0, count=sizeof(frames) / sizeof(frames[0]); j<count; j++) {
+        for (size_t j=0; j<set->count; j++) {
 	        // Check if the payload can be decoded:
-	        if (!try_key((uint8_t *) &i, frames[j], decoded_frame)) {
+	        if (!try_key((uint8_t *) &i, set->frames[j], decoded_frame)) {
 	        	success = 0;
 	            break;
 	        }
@@ -103,9 +464,13 @@ int main(void) {
 	        }
         }
 
+        if (success && !payload_sequence_plausible(&constraints, (const uint8_t (*)[FRAME_LEN]) set->frames, set->count, preparePRIOSKey((uint8_t *) &i))) {
+            success = 0;
+        }
+
         if (success) {
 	        printf(
-	        	"Candidate key: {0x%.2x, 0x%.2x, 0x%.2x, 0x%.2x, 0x%.2x, 0x%.2x, 0x%.2x, 0x%.2x}: First frame: current: %d, H0: %d H0 date: %.2d-%.2d-%.2d\n",
+	        	"Candidate key: {0x%.2x, 0x%.2x, 0x%.2x, 0x%.2x, 0x%.2x, 0x%.2x, 0x%.2x, 0x%.2x}: First frame: current: %" PRIu32 ", H0: %" PRIu32 " H0 date: %.2d-%.2d-%.2d\n",
 	        	(uint8_t)(i & 0xFF), (uint8_t)((i >> 8) & 0xFF), (uint8_t)((i >> 16) & 0xFF), (uint8_t)((i >> 24) & 0xFF), (uint8_t)((i >> 32) & 0xFF), (uint8_t)((i >> 40) & 0xFF), (uint8_t)((i >> 48) & 0xFF), (uint8_t)((i >> 56) & 0xFF),
 	        	total_consumption, last_month_total_consumption, year, month, day
 	        );
@@ -113,5 +478,258 @@ int main(void) {
         }
     }
 
+    stats_reporter_stop(&reporter);
+    free(stats);
+    return found_keys;
+}
+
+void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-f capture [-c] [-m meter | -M]] [-C constraints]... [-r | -s [-b offset=value]...] [-t threads] [-k kernel]\n", name);
+    fprintf(stderr, "         [--shard i/N] [--checkpoint file [--resume]] [--json-stats]\n");
+    fprintf(stderr, "       %s --merge [--checkpoint file] checkpoint...\n", name);
+    fprintf(stderr, "  -f capture  Load the frames from a capture file (hex dump or length-prefixed binary) instead of config.h\n");
+    fprintf(stderr, "  -c          Drop the captured frames failing the WMBus CRC check\n");
+    fprintf(stderr, "  -m meter    Only use the captured frames of this meter id (hexadecimal)\n");
+    fprintf(stderr, "  -M          Search the key of every meter of the capture in a single sweep\n");
+    fprintf(stderr, "  -C terms    Constraints on the decoded payloads, replacing those of config.h, e.g.:\n");
+    fprintf(stderr, "              \"current=1..1000000 h0<=current year=2020 month=4 day=1 monotonic@13 unit=m3 multiplier=-3 current<=100m3\"\n");
+    fprintf(stderr, "              (see constraints.h)\n");
+    fprintf(stderr, "  -r          Sweep the raw 64 bit keys instead of the prepared keys (never completes)\n");
+    fprintf(stderr, "  -s          Solve the prepared key from the known plaintext instead of searching it\n");
+    fprintf(stderr, "  -b o=v      With -s, the decoded byte at offset o is known to be v in every frame\n");
+    fprintf(stderr, "  -t threads  Number of search threads (default: number of online CPUs)\n");
+    fprintf(stderr, "  -k kernel   Key trial kernel: scalar, gray, uint64, avx2 or avx512 (default: the widest supported)\n");
+    fprintf(stderr, "  --shard i/N        Only search the i-th of N shards of the prepared keys (0 <= i < N)\n");
+    fprintf(stderr, "  --checkpoint file  Save the progress and candidates of the search to file every %d seconds\n", CHECKPOINT_INTERVAL);
+    fprintf(stderr, "  --resume           Skip what the checkpoint file has already searched\n");
+    fprintf(stderr, "  --json-stats       Print the progress reports as JSON lines\n");
+    fprintf(stderr, "  --merge            Combine the checkpoints of shard runs, into the --checkpoint file if set\n");
+}
+
+// Long options, past the range of the short ones:
+enum {OPT_SHARD = 256, OPT_CHECKPOINT, OPT_RESUME, OPT_MERGE, OPT_JSON_STATS};
+
+static const struct option long_options[] = {
+    {"shard", required_argument, NULL, OPT_SHARD},
+    {"checkpoint", required_argument, NULL, OPT_CHECKPOINT},
+    {"resume", no_argument, NULL, OPT_RESUME},
+    {"merge", no_argument, NULL, OPT_MERGE},
+    {"json-stats", no_argument, NULL, OPT_JSON_STATS},
+    {NULL, 0, NULL, 0}
+};
+
+int main(int argc, char **argv) {
+    int raw_keys = 0;
+    int solve = 0;
+    gf2_known_bit known_bits[8 * FRAME_PAYLOAD_LEN];
+    size_t known_count = 0;
+    long thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *kernel_name = NULL;
+    const char *capture_path = NULL;
+    int check_crc = 0;
+    int meter_filter = 0;
+    int all_meters = 0;
+    uint32_t meter_id = 0;
+    int constraints_given = 0;
+    search_job job = {0, 1, NULL, 0, 0};
+    int merge = 0;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "f:cm:MC:rsb:t:k:", long_options, NULL)) != -1) {
+        switch (opt) {
+        case OPT_SHARD:
+            if (sscanf(optarg, "%u/%u", &job.shard_index, &job.shard_count) != 2 || job.shard_count == 0 || job.shard_index >= job.shard_count) {
+                fprintf(stderr, "Invalid shard: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case OPT_CHECKPOINT:
+            job.checkpoint_path = optarg;
+            break;
+        case OPT_RESUME:
+            job.resume = 1;
+            break;
+        case OPT_MERGE:
+            merge = 1;
+            break;
+        case OPT_JSON_STATS:
+            job.json_stats = 1;
+            break;
+        case 'f':
+            capture_path = optarg;
+            break;
+        case 'c':
+            check_crc = 1;
+            break;
+        case 'm':
+            meter_filter = 1;
+            meter_id = strtoul(optarg, NULL, 16);
+            break;
+        case 'M':
+            all_meters = 1;
+            break;
+        case 'C':
+            if (!constraints_given) {
+                constraints_init(&constraints);
+                constraints_given = 1;
+            }
+            if (constraints_parse(&constraints, optarg) != 0) {
+                return 2;
+            }
+            break;
+        case 'r':
+            raw_keys = 1;
+            break;
+        case 's':
+            solve = 1;
+            break;
+        case 'b':
+            if (known_count >= 8 * FRAME_PAYLOAD_LEN || !parse_known_byte(optarg, &known_bits[known_count])) {
+                fprintf(stderr, "Invalid known byte: %s\n", optarg);
+                return 2;
+            }
+            known_count += 8;
+            break;
+        case 't':
+            thread_count = strtol(optarg, NULL, 10);
+            break;
+        case 'k':
+            kernel_name = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (thread_count < 1) {
+        thread_count = 1;
+    }
+    if (merge) {
+        if (optind >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        return merge_checkpoints(&argv[optind], argc - optind, job.checkpoint_path) > 0;
+    }
+    if (job.resume && !job.checkpoint_path) {
+        fprintf(stderr, "--resume needs a --checkpoint file\n");
+        return 2;
+    }
+    if ((raw_keys || solve) && (job.shard_count > 1 || job.checkpoint_path)) {
+        fprintf(stderr, "--shard and --checkpoint only apply to the prepared key search\n");
+        return 2;
+    }
+    if (all_meters && (!capture_path || meter_filter || raw_keys || solve || kernel_name || job.shard_count > 1 || job.checkpoint_path)) {
+        fprintf(stderr, "-M needs a capture file, and doesn't go with -m, -r, -s, -k, --shard or --checkpoint\n");
+        return 2;
+    }
+    if (!constraints_given) {
+        default_constraints(&constraints);
+    }
+    if (constraints_compile(&constraints) != 0) {
+        return 2;
+    }
+    constraints_print(&constraints);
+
+    search_engine engine = SEARCH_BITSLICE;
+    const bitslice_kernel *kernel = NULL;
+    if (kernel_name && strcmp(kernel_name, "scalar") == 0) {
+        engine = SEARCH_SCALAR;
+    } else if (kernel_name && strcmp(kernel_name, "gray") == 0) {
+        engine = SEARCH_GRAY;
+    } else if (!raw_keys && !solve) {
+        kernel = bitslice_select(kernel_name);
+        if (!kernel) {
+            fprintf(stderr, "Unknown or unsupported kernel: %s\n", kernel_name);
+            return 2;
+        }
+    }
+
+    // Get the frames, from config.h or from a capture file:
+    const uint8_t (*input_frames)[FRAME_LEN] = (const uint8_t (*)[FRAME_LEN]) frames;
+    size_t input_count = sizeof(frames) / sizeof(frames[0]);
+    uint8_t (*captured_frames)[FRAME_LEN] = NULL;
+    capture cap;
+    if (capture_path) {
+        if (capture_load(&cap, capture_path, check_crc) != 0) {
+            return 2;
+        }
+        printf("%zu frames from %zu meter(s) loaded, %zu rejected\n", cap.frame_count, cap.group_count, cap.rejected_count);
+        if (cap.group_count <= 16) {
+            for (size_t g=0; g<cap.group_count; g++) {
+                printf("  meter %.8" PRIx32 ": %zu frames\n", cap.groups[g].meter_id, cap.groups[g].count);
+            }
+        }
+
+        if (all_meters) {
+            uint32_t found_meters = search_meter_keys(&cap, (unsigned) thread_count, job.json_stats);
+            capture_free(&cap);
+            return found_meters > 0;
+        }
+        if (meter_filter) {
+            const capture_group *group = capture_find(&cap, meter_id);
+            if (!group) {
+                fprintf(stderr, "No frame from meter %.8" PRIx32 "\n", meter_id);
+                return 2;
+            }
+            input_frames = (const uint8_t (*)[FRAME_LEN]) group->frames;
+            input_count = group->count;
+        } else {
+            captured_frames = capture_all_frames(&cap);
+            if (!captured_frames) {
+                perror("capture_all_frames");
+                return 2;
+            }
+            input_frames = (const uint8_t (*)[FRAME_LEN]) captured_frames;
+            input_count = cap.frame_count;
+        }
+    }
+    if (input_count == 0) {
+        fprintf(stderr, "No frame to work on\n");
+        return 2;
+    }
+
+    // Keep only the frames that constrain the key differently:
+    frame_set set;
+    if (frame_set_prepare(&set, input_frames, input_count) != 0) {
+        perror("frame_set_prepare");
+        return 2;
+    }
+    printf("%zu frames, %zu duplicate(s) removed\n", set.count + set.duplicate_count, set.duplicate_count);
+    free(captured_frames);
+    if (capture_path) {
+        capture_free(&cap);
+    }
+
+    // Apply the constraints on the clear headers, and put the frames in access
+    // order for the monotonic constraint:
+    size_t ignored_count = frame_set_retain(&set, frame_header_plausible, &constraints);
+    if (ignored_count > 0) {
+        printf("%zu frame(s) with another unit or multiplier ignored\n", ignored_count);
+    }
+    if (set.count == 0) {
+        fprintf(stderr, "No frame to work on\n");
+        frame_set_free(&set);
+        return 2;
+    }
+    if (constraints.monotonic && constraints.access_offset >= 0 && frame_set_sort_by_access(&set, constraints.access_offset) != 0) {
+        perror("frame_set_sort_by_access");
+        frame_set_free(&set);
+        return 2;
+    }
+
+    if (raw_keys) {
+        uint32_t found_keys = search_raw_keys(&set, job.json_stats);
+        frame_set_free(&set);
+        return found_keys > 0;
+    }
+
+    uint32_t found_keys;
+    if (solve) {
+        found_keys = solve_prepared_keys(&set, known_bits, known_count);
+    } else {
+        found_keys = search_prepared_keys(&set, (unsigned) thread_count, engine, kernel, &job);
+    }
+    frame_set_free(&set);
     return found_keys > 0;
 }
@@ -0,0 +1,124 @@
+//
+// Benchmark of the parsing and printing of the PRIOS readings, with the
+// integer readings or with the float ones (built with -DPRIOS_FLOAT_READINGS=1).
+// The lines are printed to /dev/null, the timings to stderr.
+//
+// It first checks that formatIZARReadingAsCSV() writes the same lines as the
+// printf format of the integer readings, and fails if it doesn't.
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+
+// Use the PRIOS functions from the ST code.
+#include <PRIOS.h>
+
+#define READING_COUNT 1000000
+
+static double elapsed(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+extern const char * const unit_displays[];
+
+// The CSV line of a reading, with snprintf().
+static int reference_csv(char *buffer, uint32_t a_id, const izar_reading *reading) {
+    static const uint32_t powers_of_ten[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+    char values[2][24];
+    const uint32_t raws[2] = {reading->current_reading_raw, reading->h0_reading_raw};
+    for (size_t i=0; i<2; i++) {
+        if (reading->reading_exponent >= 0) {
+            snprintf(values[i], sizeof(values[i]), "%" PRIu32 "%.*s.000000", raws[i], reading->reading_exponent, "0");
+        } else {
+            uint32_t divisor = powers_of_ten[-reading->reading_exponent];
+            snprintf(values[i], sizeof(values[i]), "%" PRIu32 ".%06" PRIu32, raws[i] / divisor, (raws[i] % divisor) * powers_of_ten[6 + reading->reading_exponent]);
+        }
+    }
+    return snprintf(buffer, PRIOS_CSV_LINE_MAX,
+        "%.6" PRIx32 ",%s,%s,%s,%.2d,%.2d,%.2d,%d.%c,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\r\n",
+        a_id, values[0], values[1], unit_displays[reading->unit_type],
+        reading->h0_year, reading->h0_month, reading->h0_day,
+        reading->remaining_battery_half_years / 2, reading->remaining_battery_half_years % 2 ? '5' : '0',
+        reading->radio_interval, reading->random_generator,
+        reading->alarms.general_alarm, reading->alarms.leakage_currently, reading->alarms.leakage_previously,
+        reading->alarms.meter_blocked, reading->alarms.back_flow, reading->alarms.underflow,
+        reading->alarms.overflow, reading->alarms.submarine, reading->alarms.sensor_fraud_currently,
+        reading->alarms.sensor_fraud_previously, reading->alarms.mechanical_fraud_currently,
+        reading->alarms.mechanical_fraud_previously);
+}
+
+int main(void) {
+    static uint8_t headers[READING_COUNT][4];
+    static uint8_t payloads[READING_COUNT][11];
+    srand(1);
+    for (size_t i=0; i<READING_COUNT; i++) {
+        for (size_t j=0; j<4; j++) {
+            headers[i][j] = rand();
+        }
+        headers[i][3] = (headers[i][3] & 0xF8) | (rand() % 8);
+        for (size_t j=0; j<11; j++) {
+            payloads[i][j] = rand();
+        }
+    }
+    if (!freopen("/dev/null", "w", stdout)) {
+        perror("freopen");
+        return 1;
+    }
+
+    izar_reading reading;
+    uint32_t checksum = 0;
+    char line[PRIOS_CSV_LINE_MAX];
+    char expected[PRIOS_CSV_LINE_MAX];
+    for (size_t i=0; i<READING_COUNT; i++) {
+        uint32_t a_id = i * 2654435761u;
+        parsePRIOSFrame(headers[i], payloads[i], &reading);
+        int len = formatIZARReadingAsCSV(line, a_id, &reading);
+        if (len != reference_csv(expected, a_id, &reading) || memcmp(line, expected, len)) {
+            fprintf(stderr, "Reading %zu: got %.*s, expected %s", i, len, line, expected);
+            return 1;
+        }
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i=0; i<READING_COUNT; i++) {
+        parsePRIOSFrame(headers[i], payloads[i], &reading);
+        checksum += reading.h0_day;
+    }
+    double parse_time = elapsed(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i=0; i<READING_COUNT; i++) {
+        parsePRIOSFrame(headers[i], payloads[i], &reading);
+        checksum += reference_csv(line, i, &reading);
+    }
+    double snprintf_time = elapsed(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i=0; i<READING_COUNT; i++) {
+        parsePRIOSFrame(headers[i], payloads[i], &reading);
+        checksum += formatIZARReadingAsCSV(line, i, &reading);
+    }
+    double format_time = elapsed(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i=0; i<READING_COUNT; i++) {
+        parsePRIOSFrame(headers[i], payloads[i], &reading);
+        printIZARReadingAsCSV(0x20d01c15 + i, &reading);
+    }
+    double print_time = elapsed(&start);
+
+    fprintf(stderr, "%s readings, per reading: parse %.1f ns, parse and snprintf %.1f ns, parse and format %.1f ns, parse and print %.1f ns (%u)\n",
+            PRIOS_FLOAT_READINGS ? "float" : "integer",
+            parse_time * 1e9 / READING_COUNT, snprintf_time * 1e9 / READING_COUNT, format_time * 1e9 / READING_COUNT,
+            print_time * 1e9 / READING_COUNT, (unsigned) checksum);
+    return 0;
+}
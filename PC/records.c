@@ -0,0 +1,78 @@
+//
+// Decoding of the binary output of the collector.
+//
+
+#include <string.h>
+
+#include "records.h"
+
+/**
+ * Decode the COBS frame of len bytes at in, without its delimiter, into out.
+ * Returns the decoded length, or (size_t) -1 if the frame isn't valid COBS or
+ * doesn't fit in out_size bytes.
+ */
+size_t records_cobs_decode(const uint8_t *in, size_t len, uint8_t *out, size_t out_size) {
+    size_t read = 0;
+    size_t written = 0;
+    while (read < len) {
+        uint8_t code = in[read++];
+        if (code == 0 || read + code - 1 > len) {
+            return (size_t) -1;
+        }
+        for (uint8_t i=1; i<code; i++) {
+            if (written == out_size || in[read] == 0) {
+                return (size_t) -1;
+            }
+            out[written++] = in[read++];
+        }
+        // A code of 0xFF is a full block, not followed by a 0x00.
+        if (code != 0xFF && read < len) {
+            if (written == out_size) {
+                return (size_t) -1;
+            }
+            out[written++] = 0;
+        }
+    }
+    return written;
+}
+
+void records_init(record_stream *stream) {
+    memset(stream, 0, sizeof(*stream));
+}
+
+/**
+ * Push the next byte of the stream.
+ * Returns 1 if it completes a record, stored into a_id and reading, 2 if it
+ * completes a drop report, stored into the stream, -1 if it completes a
+ * frame that isn't a valid record, 0 otherwise.
+ */
+int records_push(record_stream *stream, uint8_t byte, uint32_t *a_id, izar_reading *reading) {
+    if (byte != 0) {
+        if (stream->length == sizeof(stream->frame)) {
+            stream->overflow = 1;
+        } else {
+            stream->frame[stream->length++] = byte;
+        }
+        return 0;
+    }
+
+    size_t length = stream->length;
+    int overflow = stream->overflow;
+    stream->length = 0;
+    stream->overflow = 0;
+    if (length == 0) {
+        // Consecutive delimiters, as when resynchronizing.
+        return 0;
+    }
+    uint8_t record[PRIOS_RECORD_LEN];
+    size_t record_length = overflow ? (size_t) -1 : records_cobs_decode(stream->frame, length, record, sizeof(record));
+    if (record_length == PRIOS_DROP_REPORT_LEN && decodeDropReport(record, &stream->dropped)) {
+        return 2;
+    }
+    if (record_length != PRIOS_RECORD_LEN || !decodeIZARRecord(record, a_id, reading)) {
+        stream->errors++;
+        return -1;
+    }
+    stream->records++;
+    return 1;
+}
@@ -0,0 +1,37 @@
+//
+// Decoding of the binary output of the collector (PRIOS_OUTPUT_BINARY): a
+// stream of COBS encoded records, each followed by a 0x00 delimiter. The
+// layout of a record is in PRIOS.h, and decodeIZARRecord() of the ST code
+// checks its CRC and extracts the reading.
+//
+// Bytes can be pushed one at a time, as they come from the serial port. A
+// frame that is too long, badly encoded or whose CRC is wrong is counted and
+// skipped, and the stream picks up again at the next delimiter. The drop
+// reports of the collector, shorter, are kept apart.
+//
+
+#ifndef __RECORDS_H
+#define __RECORDS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <PRIOS.h>
+
+typedef struct {
+    // The bytes of the current frame, up to its delimiter.
+    uint8_t frame[PRIOS_FRAMED_RECORD_MAX];
+    size_t length;
+    int overflow;
+
+    uint64_t records;
+    uint64_t errors;
+    // The last drop report: what the collector dropped since its start.
+    prios_drop_report dropped;
+} record_stream;
+
+size_t records_cobs_decode(const uint8_t *in, size_t len, uint8_t *out, size_t out_size);
+void records_init(record_stream *stream);
+int records_push(record_stream *stream, uint8_t byte, uint32_t *a_id, izar_reading *reading);
+
+#endif
@@ -0,0 +1,117 @@
+//
+// Check of the binary output: random readings are framed as the collector
+// does with PRIOS_OUTPUT_BINARY, with a drop report from time to time, some
+// frames are damaged, and the stream is written to the file given as the
+// first argument. The CSV lines of the
+// intact readings are written to the second one, and the summary
+// records_decode must print to the standard output.
+//
+// records_decode must then print exactly these lines, the drop reports
+// included, and count every damaged frame as a bad one:
+//   ./records_check stream expected > summary
+//   ./records_decode < stream > decoded 2> decoded_summary
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+// Use the PRIOS functions from the ST code.
+#include <PRIOS.h>
+
+#define READING_COUNT 200000
+#define JUNK_MAX 8
+// One drop report every this many readings, on average.
+#define DROP_REPORT_EVERY 64
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s stream expected\n", argv[0]);
+        return 1;
+    }
+    FILE *stream = fopen(argv[1], "wb");
+    FILE *expected = fopen(argv[2], "wb");
+    if (!stream || !expected) {
+        perror("fopen");
+        return 1;
+    }
+
+    srand(1);
+    uint64_t records = 0;
+    uint64_t errors = 0;
+    prios_drop_report dropped = {0};
+    for (size_t i=0; i<READING_COUNT; i++) {
+        uint8_t header[4];
+        uint8_t payload[11];
+        for (size_t j=0; j<sizeof(header); j++) {
+            header[j] = rand();
+        }
+        header[3] = (header[3] & 0xF8) | (rand() % 8);
+        for (size_t j=0; j<sizeof(payload); j++) {
+            payload[j] = rand();
+        }
+        izar_reading reading;
+        parsePRIOSFrame(header, payload, &reading);
+        uint32_t a_id = (uint32_t) rand() << 16 ^ (uint32_t) rand();
+
+        uint8_t frame[PRIOS_FRAMED_RECORD_MAX];
+        uint8_t len = frameIZARReadingAsRecord(frame, a_id, &reading);
+        switch (rand() % 16) {
+        case 0: {
+            // A byte changed, but not into a delimiter.
+            uint8_t *byte = &frame[rand() % (len - 1)];
+            uint8_t flip;
+            do {
+                flip = 1 + rand() % 255;
+            } while ((*byte ^ flip) == 0);
+            *byte ^= flip;
+            errors++;
+            break;
+        }
+        case 1:
+            // Junk from the end of a lost frame, without its delimiter.
+            for (int j=1+rand()%JUNK_MAX; j>0; j--) {
+                fputc(1 + rand() % 255, stream);
+            }
+            errors++;
+            break;
+        case 2:
+            // Bytes lost before the delimiter.
+            len -= 1 + rand() % (len - 2);
+            frame[len - 1] = 0;
+            errors++;
+            break;
+        case 3:
+            // A delimiter doubled, as when resynchronizing.
+            fputc(0, stream);
+            // fall through
+        default: {
+            char line[PRIOS_CSV_LINE_MAX];
+            fwrite(line, 1, formatIZARReadingAsCSV(line, a_id, &reading), expected);
+            records++;
+            break;
+        }
+        }
+        fwrite(frame, 1, len, stream);
+
+        if (rand() % DROP_REPORT_EVERY == 0) {
+            dropped.records += rand() % 100;
+            dropped.bytes += rand() % 10000;
+            dropped.frames_full += rand() % 10;
+            dropped.frames_oversize += rand() % 2;
+            uint8_t report[PRIOS_DROP_REPORT_LEN + 2];
+            fwrite(report, 1, frameDropReportAsRecord(report, &dropped), stream);
+            char line[PRIOS_CSV_LINE_MAX];
+            fwrite(line, 1, formatDropReportAsCSV(line, &dropped), expected);
+        }
+    }
+
+    if (fclose(stream) || fclose(expected)) {
+        perror("fclose");
+        return 1;
+    }
+    printf("%" PRIu64 " records, %" PRIu64 " bad frames, %" PRIu32 " records and %" PRIu32 " frames dropped by the collector\n",
+           records, errors, dropped.records, dropped.frames_full + dropped.frames_oversize);
+    return 0;
+}
@@ -0,0 +1,35 @@
+//
+// Read the binary output of the collector (PRIOS_OUTPUT_BINARY) on the
+// standard input, and print the readings and the drop reports as the CSV
+// lines the collector prints otherwise.
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "records.h"
+
+int main(void) {
+    record_stream stream;
+    records_init(&stream);
+
+    uint8_t buffer[4096];
+    size_t len;
+    while ((len = fread(buffer, 1, sizeof(buffer), stdin)) > 0) {
+        for (size_t i=0; i<len; i++) {
+            uint32_t a_id;
+            izar_reading reading;
+            int result = records_push(&stream, buffer[i], &a_id, &reading);
+            char line[PRIOS_CSV_LINE_MAX];
+            if (result == 1) {
+                fwrite(line, 1, formatIZARReadingAsCSV(line, a_id, &reading), stdout);
+            } else if (result == 2) {
+                fwrite(line, 1, formatDropReportAsCSV(line, &stream.dropped), stdout);
+            }
+        }
+    }
+    fprintf(stderr, "%" PRIu64 " records, %" PRIu64 " bad frames, %" PRIu32 " records and %" PRIu32 " frames dropped by the collector\n",
+            stream.records, stream.errors, stream.dropped.records, stream.dropped.frames_full + stream.dropped.frames_oversize);
+    return 0;
+}
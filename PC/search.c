@@ -0,0 +1,426 @@
+//
+// Multi-threaded search of the prepared keys that decode a set of PRIOS frames.
+//
+// The key range is cut in chunks of SEARCH_CHUNK_SIZE keys. The workers take
+// the next chunk from an atomic cursor until there are none left, so a slow
+// thread never holds back the others. Each worker uses its own copy of the
+// frames and its own decode buffer; the only shared writes are the cursor,
+// the key counter and the done chunks (once per chunk) and the candidate list.
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#include <PRIOS.h>
+#include "search.h"
+#include "stats.h"
+#include "bitslice.h"
+#include "gray.h"
+
+typedef struct {
+    search_context *ctx;
+    uint8_t (*frames)[FRAME_LEN];
+    frame_record *records;
+    gray_keystream gray_basis[32];
+    gray_keystream *gray_targets;
+
+    // Order of the frames (the arrays above are kept in that order) and of
+    // the payload checks, adapted after each chunk.
+    adaptive_order frame_order;
+    adaptive_order check_order;
+    size_t *permutation;
+    uint8_t *scratch;
+
+    // Rejections by each instruction of the constraints in the bit-sliced
+    // kernels, and the statistics of the thread.
+    uint64_t op_rejects[CONSTRAINT_MAX_OPS];
+    stats_counters *stats;
+} search_worker;
+
+/**
+ * Add a candidate to the shared list, without locking.
+ */
+void search_add_candidate(search_context *ctx, uint32_t prepared_key) {
+    search_candidate *candidate = malloc(sizeof(*candidate));
+    if (!candidate) {
+        perror("malloc");
+        exit(2);
+    }
+    candidate->prepared_key = prepared_key;
+    candidate->next = atomic_load_explicit(&ctx->candidates, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&ctx->candidates, &candidate->next, candidate, memory_order_release, memory_order_relaxed)) {
+    }
+}
+
+// Add a key that decodes all the frames, if it also passes the constraints
+// between frames.
+static void push_candidate(search_worker *worker, uint32_t prepared_key) {
+    search_context *ctx = worker->ctx;
+    if (payload_sequence_plausible(ctx->constraints, (const uint8_t (*)[FRAME_LEN]) ctx->frames->frames, ctx->frame_count, prepared_key)) {
+        search_add_candidate(ctx, prepared_key);
+        stats_add(&worker->stats->candidates, 1);
+    } else {
+        stats_add(&worker->stats->sequence_rejects, 1);
+    }
+}
+
+// Test all the keys of [first, end) against all the frames.
+static void search_range(search_worker *worker, uint64_t first, uint64_t end) {
+    search_context *ctx = worker->ctx;
+    uint8_t decoded_frame[FRAME_PAYLOAD_LEN];
+
+    for (uint64_t i=first; i<end; i++) {
+        uint32_t prepared_key = (uint32_t) i;
+
+        // Test all frames in sequence until one fails:
+        size_t j;
+        for (j=0; j<ctx->frame_count; j++) {
+            if (!decodePRIOSPayload(worker->frames[j], FRAME_PAYLOAD_LEN, prepared_key, decoded_frame)) {
+                break;
+            }
+            if (!payload_plausible_ordered(ctx->constraints, decoded_frame, &worker->check_order)) {
+                break;
+            }
+        }
+
+        if (j == ctx->frame_count) {
+            worker->frame_order.passes++;
+            push_candidate(worker, prepared_key);
+        } else {
+            worker->frame_order.rejects[j]++;
+        }
+    }
+}
+
+// Same as search_range(), a batch of keys at a time.
+static void search_range_bitslice(search_worker *worker, uint64_t first, uint64_t end) {
+    search_context *ctx = worker->ctx;
+    const bitslice_kernel *kernel = ctx->kernel;
+    uint64_t survivors[BITSLICE_MAX_LANES / 64];
+
+    // Only whole aligned batches go to the kernel:
+    uint64_t batch_first = (first + kernel->lanes - 1) / kernel->lanes * kernel->lanes;
+    uint64_t batch_end = end / kernel->lanes * kernel->lanes;
+    if (batch_first >= batch_end) {
+        search_range(worker, first, end);
+        return;
+    }
+    search_range(worker, first, batch_first);
+
+    for (uint64_t base=batch_first; base<batch_end; base+=kernel->lanes) {
+        if (!kernel->trial(worker->records, ctx->frame_count, ctx->constraints, (uint32_t) base, survivors, worker->frame_order.rejects, worker->op_rejects)) {
+            continue;
+        }
+        worker->frame_order.passes++;
+        for (unsigned lane=0; lane<kernel->lanes; lane++) {
+            if ((survivors[lane / 64] >> (lane % 64)) & 1) {
+                push_candidate(worker, (uint32_t)(base + lane));
+            }
+        }
+    }
+
+    search_range(worker, batch_end, end);
+}
+
+static void push_gray_candidate(void *arg, uint32_t prepared_key) {
+    push_candidate(arg, prepared_key);
+}
+
+// Publish the counts of a chunk of count keys, before reorder_checks() resets
+// them.
+static void flush_stats(search_worker *worker, uint64_t count) {
+    const adaptive_order *checks = &worker->check_order;
+    for (size_t p=0; p<checks->count; p++) {
+        worker->op_rejects[checks->order[p]] += checks->rejects[p];
+    }
+    for (size_t i=0; i<checks->count; i++) {
+        if (worker->op_rejects[i]) {
+            stats_add(&worker->stats->op_rejects[i], worker->op_rejects[i]);
+            worker->op_rejects[i] = 0;
+        }
+    }
+    stats_add(&worker->stats->keys, count);
+}
+
+// Apply a permutation to an array: element i becomes element permutation[i].
+static void permute(void *array, size_t size, size_t count, const size_t *permutation, uint8_t *scratch) {
+    for (size_t i=0; i<count; i++) {
+        memcpy(scratch + i * size, (uint8_t *) array + permutation[i] * size, size);
+    }
+    memcpy(array, scratch, count * size);
+}
+
+// Put the most selective frames and checks first, from what the last chunk saw.
+static void reorder_checks(search_worker *worker) {
+    size_t count = worker->ctx->frame_count;
+
+    adaptive_order_update(&worker->frame_order, worker->permutation);
+    permute(worker->frames, FRAME_LEN, count, worker->permutation, worker->scratch);
+    permute(worker->records, sizeof(frame_record), count, worker->permutation, worker->scratch);
+    permute(worker->gray_targets, sizeof(gray_keystream), count, worker->permutation, worker->scratch);
+
+    adaptive_order_update(&worker->check_order, NULL);
+}
+
+// Chunk of prepared keys that the chunk starting at first covers. An aligned
+// block of 2^20 Gray code indexes covers the keys of one aligned block: the
+// low bits take every value, and the high ones are the Gray code of the block
+// index.
+static uint64_t key_chunk_of(const search_context *ctx, uint64_t first) {
+    uint64_t chunk = first / SEARCH_CHUNK_SIZE;
+    if (ctx->engine == SEARCH_GRAY) {
+        chunk ^= chunk >> 1;
+    }
+    return chunk % SEARCH_KEY_CHUNKS;
+}
+
+static void *search_worker_main(void *arg) {
+    search_worker *worker = arg;
+    search_context *ctx = worker->ctx;
+
+    while (!atomic_load_explicit(&ctx->stop, memory_order_relaxed)) {
+        uint64_t chunk = atomic_fetch_add_explicit(&ctx->next_chunk, 1, memory_order_relaxed);
+        if (chunk >= ctx->chunk_count) {
+            break;
+        }
+        uint64_t first = ctx->first_key + (chunk * ctx->shard_count + ctx->shard_index) * SEARCH_CHUNK_SIZE;
+        uint64_t end = first + SEARCH_CHUNK_SIZE;
+        if (end > ctx->end_key) {
+            end = ctx->end_key;
+        }
+        uint64_t key_chunk = key_chunk_of(ctx, first);
+        if (search_chunk_done(ctx, key_chunk)) {
+            continue;
+        }
+
+        switch (ctx->engine) {
+        case SEARCH_SCALAR:
+            search_range(worker, first, end);
+            break;
+        case SEARCH_BITSLICE:
+            search_range_bitslice(worker, first, end);
+            break;
+        case SEARCH_GRAY:
+            gray_search(worker->gray_basis, worker->gray_targets, ctx->frame_count, ctx->constraints, &worker->frame_order, &worker->check_order, first, end, push_gray_candidate, worker);
+            break;
+        }
+        flush_stats(worker, end - first);
+        reorder_checks(worker);
+        // After the candidates of the chunk, for the checkpoints:
+        search_mark_done(ctx, key_chunk);
+    }
+    return NULL;
+}
+
+/**
+ * Prepare a search of the prepared keys in [first_key, end_key), with the
+ * given engine. kernel is the bit-sliced kernel to use with SEARCH_BITSLICE.
+ */
+void search_init(search_context *ctx, const frame_set *frames, const payload_constraints *constraints, search_engine engine, const bitslice_kernel *kernel, uint64_t first_key, uint64_t end_key) {
+    ctx->frames = frames;
+    ctx->frame_count = frames->count;
+    ctx->constraints = constraints;
+    ctx->engine = engine;
+    ctx->kernel = kernel;
+    ctx->first_key = first_key;
+    ctx->end_key = end_key;
+    ctx->chunk_count = (end_key - first_key + SEARCH_CHUNK_SIZE - 1) / SEARCH_CHUNK_SIZE;
+    ctx->shard_index = 0;
+    ctx->shard_count = 1;
+    for (size_t i=0; i<SEARCH_KEY_CHUNKS / 64; i++) {
+        atomic_init(&ctx->done_chunks[i], 0);
+    }
+    atomic_init(&ctx->stop, 0);
+    ctx->report_hook = NULL;
+    ctx->report_arg = NULL;
+    atomic_init(&ctx->next_chunk, 0);
+    atomic_init(&ctx->candidates, NULL);
+    ctx->stats = NULL;
+    ctx->json_stats = 0;
+}
+
+/**
+ * Only search the chunks with index % shard_count == shard_index, to split a
+ * search between processes. Call before search_run().
+ */
+void search_set_shard(search_context *ctx, unsigned shard_index, unsigned shard_count) {
+    uint64_t total = (ctx->end_key - ctx->first_key + SEARCH_CHUNK_SIZE - 1) / SEARCH_CHUNK_SIZE;
+    ctx->shard_index = shard_index;
+    ctx->shard_count = shard_count;
+    ctx->chunk_count = total > shard_index ? (total - shard_index + shard_count - 1) / shard_count : 0;
+}
+
+void search_mark_done(search_context *ctx, uint64_t key_chunk) {
+    atomic_fetch_or_explicit(&ctx->done_chunks[key_chunk / 64], (uint_fast64_t) 1 << (key_chunk % 64), memory_order_release);
+}
+
+int search_chunk_done(search_context *ctx, uint64_t key_chunk) {
+    return (atomic_load_explicit(&ctx->done_chunks[key_chunk / 64], memory_order_acquire) >> (key_chunk % 64)) & 1;
+}
+
+/**
+ * Make the workers stop after their current chunk. Async-signal-safe.
+ */
+void search_stop(search_context *ctx) {
+    atomic_store_explicit(&ctx->stop, 1, memory_order_relaxed);
+}
+
+static void call_report_hook(void *arg) {
+    search_context *ctx = arg;
+    if (ctx->report_hook) {
+        ctx->report_hook(ctx, ctx->report_arg);
+    }
+}
+
+/**
+ * Run the search on thread_count threads, and report the statistics every
+ * report_interval seconds until it completes.
+ * Returns 0 on success, -1 if the threads could not be started.
+ */
+int search_run(search_context *ctx, unsigned thread_count, unsigned report_interval) {
+    search_worker *workers = calloc(thread_count, sizeof(*workers));
+    pthread_t *threads = calloc(thread_count, sizeof(*threads));
+    ctx->stats = stats_alloc(thread_count);
+    if (!workers || !threads || !ctx->stats) {
+        perror("calloc");
+        return -1;
+    }
+
+    // Give every worker its own copy of the frames:
+    for (unsigned t=0; t<thread_count; t++) {
+        workers[t].ctx = ctx;
+        workers[t].frames = malloc(ctx->frame_count * FRAME_LEN);
+        workers[t].records = malloc(ctx->frame_count * sizeof(frame_record));
+        workers[t].gray_targets = malloc(ctx->frame_count * sizeof(gray_keystream));
+        workers[t].permutation = malloc(ctx->frame_count * sizeof(size_t));
+        workers[t].scratch = malloc(ctx->frame_count * FRAME_LEN);
+        if (!workers[t].frames || !workers[t].records || !workers[t].gray_targets || !workers[t].permutation || !workers[t].scratch
+            || adaptive_order_init(&workers[t].frame_order, ctx->frame_count) != 0 || adaptive_order_init(&workers[t].check_order, ctx->constraints->op_count) != 0) {
+            perror("malloc");
+            return -1;
+        }
+        memcpy(workers[t].frames, ctx->frames->frames, ctx->frame_count * FRAME_LEN);
+        memcpy(workers[t].records, ctx->frames->records, ctx->frame_count * sizeof(frame_record));
+        for (size_t j=0; j<ctx->frame_count; j++) {
+            gray_prepare_frame(&workers[t].gray_targets[j], &workers[t].records[j]);
+        }
+        gray_prepare_basis(workers[t].gray_basis);
+        workers[t].stats = &ctx->stats[t];
+    }
+
+    // Keys left to try, without the chunks already done:
+    uint64_t pending = 0;
+    for (uint64_t chunk=0; chunk<ctx->chunk_count; chunk++) {
+        uint64_t first = ctx->first_key + (chunk * ctx->shard_count + ctx->shard_index) * SEARCH_CHUNK_SIZE;
+        uint64_t end = first + SEARCH_CHUNK_SIZE < ctx->end_key ? first + SEARCH_CHUNK_SIZE : ctx->end_key;
+        if (!search_chunk_done(ctx, key_chunk_of(ctx, first))) {
+            pending += end - first;
+        }
+    }
+
+    stats_reporter reporter = {
+        .counters = ctx->stats,
+        .counter_count = thread_count,
+        .constraints = ctx->constraints,
+        .key_name = "prepared keys",
+        .total_keys = pending,
+        .interval = report_interval,
+        .json = ctx->json_stats,
+        .hook = call_report_hook,
+        .hook_arg = ctx,
+    };
+    if (stats_reporter_start(&reporter) != 0) {
+        return -1;
+    }
+
+    unsigned started = 0;
+    for (; started<thread_count; started++) {
+        if (pthread_create(&threads[started], NULL, search_worker_main, &workers[started]) != 0) {
+            fprintf(stderr, "Cannot start search thread %u\n", started);
+            break;
+        }
+    }
+    for (unsigned t=0; t<started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    stats_reporter_stop(&reporter);
+    call_report_hook(ctx);
+    stats_sample sample;
+    stats_sample_all(ctx->stats, thread_count, &sample);
+    stats_report(&reporter, &sample, 1);
+
+    for (unsigned t=0; t<thread_count; t++) {
+        free(workers[t].frames);
+        free(workers[t].records);
+        free(workers[t].gray_targets);
+        free(workers[t].permutation);
+        free(workers[t].scratch);
+        adaptive_order_free(&workers[t].frame_order);
+        adaptive_order_free(&workers[t].check_order);
+    }
+    free(workers);
+    free(threads);
+    free(ctx->stats);
+    ctx->stats = NULL;
+    return started == thread_count ? 0 : -1;
+}
+
+static int compare_candidates(const void *a, const void *b) {
+    uint32_t key_a = (*(search_candidate * const *) a)->prepared_key;
+    uint32_t key_b = (*(search_candidate * const *) b)->prepared_key;
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+/**
+ * The candidates found so far, while the search runs. The list stays owned by
+ * the search context.
+ */
+const search_candidate *search_peek_candidates(search_context *ctx) {
+    return atomic_load_explicit(&ctx->candidates, memory_order_acquire);
+}
+
+/**
+ * Take the candidates found by the workers, sorted by prepared key.
+ */
+search_candidate *search_take_candidates(search_context *ctx) {
+    search_candidate *list = atomic_exchange(&ctx->candidates, NULL);
+
+    size_t count = 0;
+    for (search_candidate *c=list; c; c=c->next) {
+        count++;
+    }
+    if (count < 2) {
+        return list;
+    }
+
+    search_candidate **sorted = malloc(count * sizeof(*sorted));
+    if (!sorted) {
+        return list;
+    }
+    count = 0;
+    for (search_candidate *c=list; c; c=c->next) {
+        sorted[count++] = c;
+    }
+    qsort(sorted, count, sizeof(*sorted), compare_candidates);
+    for (size_t i=0; i+1<count; i++) {
+        sorted[i]->next = sorted[i + 1];
+    }
+    sorted[count - 1]->next = NULL;
+    list = sorted[0];
+    free(sorted);
+    return list;
+}
+
+void search_free_candidates(search_candidate *candidates) {
+    while (candidates) {
+        search_candidate *next = candidates->next;
+        free(candidates);
+        candidates = next;
+    }
+}
@@ -0,0 +1,89 @@
+//
+// Multi-threaded search of the prepared keys that decode a set of PRIOS frames.
+//
+
+#ifndef __SEARCH_H
+#define __SEARCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include "frames.h"
+#include "adaptive.h"
+#include "constraints.h"
+
+// Number of prepared keys a worker takes from the shared cursor at once.
+#define SEARCH_CHUNK_SIZE (1 << 20)
+// Number of chunks of the 2^32 prepared keys, the unit of sharding and
+// checkpoints.
+#define SEARCH_KEY_CHUNKS ((1ULL << 32) / SEARCH_CHUNK_SIZE)
+
+struct bitslice_kernel;
+
+// How the workers try the keys.
+typedef enum {
+    // One key at a time with decodePRIOSPayload().
+    SEARCH_SCALAR,
+    // A batch of keys at a time with a bit-sliced kernel.
+    SEARCH_BITSLICE,
+    // In Gray code order, updating the keystream incrementally.
+    SEARCH_GRAY
+} search_engine;
+
+// A prepared key that decodes all the frames.
+typedef struct search_candidate {
+    struct search_candidate *next;
+    uint32_t prepared_key;
+} search_candidate;
+
+// State shared by all the workers of a search.
+typedef struct search_context {
+    // Input:
+    const frame_set *frames;
+    size_t frame_count;
+    const payload_constraints *constraints;
+    search_engine engine;
+    const struct bitslice_kernel *kernel;
+    uint64_t first_key;
+    uint64_t end_key;
+
+    // Scheduling: index of the next chunk to hand out. With SEARCH_GRAY, the
+    // range is that of the Gray code indexes rather than the keys. With
+    // sharding, local chunk c is chunk c * shard_count + shard_index.
+    atomic_uint_fast64_t next_chunk;
+    uint64_t chunk_count;
+    unsigned shard_index;
+    unsigned shard_count;
+
+    // Chunks of prepared keys (key / SEARCH_CHUNK_SIZE) completed, by this
+    // run or a previous one: the workers skip them. Only valid for searches
+    // starting at a multiple of SEARCH_CHUNK_SIZE.
+    atomic_uint_fast64_t done_chunks[SEARCH_KEY_CHUNKS / 64];
+    // Set to make the workers stop after their current chunk.
+    atomic_int stop;
+
+    // Called from search_run() at every report and once the workers are done,
+    // e.g. to save a checkpoint.
+    void (*report_hook)(struct search_context *ctx, void *arg);
+    void *report_arg;
+
+    // Output: lock-free list of candidates, and the statistics of each
+    // thread while search_run() runs.
+    _Atomic(search_candidate *) candidates;
+    struct stats_counters *stats;
+    int json_stats;
+} search_context;
+
+void search_init(search_context *ctx, const frame_set *frames, const payload_constraints *constraints, search_engine engine, const struct bitslice_kernel *kernel, uint64_t first_key, uint64_t end_key);
+void search_set_shard(search_context *ctx, unsigned shard_index, unsigned shard_count);
+void search_mark_done(search_context *ctx, uint64_t key_chunk);
+int search_chunk_done(search_context *ctx, uint64_t key_chunk);
+void search_add_candidate(search_context *ctx, uint32_t prepared_key);
+void search_stop(search_context *ctx);
+int search_run(search_context *ctx, unsigned thread_count, unsigned report_interval);
+const search_candidate *search_peek_candidates(search_context *ctx);
+search_candidate *search_take_candidates(search_context *ctx);
+void search_free_candidates(search_candidate *candidates);
+
+#endif
@@ -0,0 +1,148 @@
+//
+// Fake SPI backend with a fake S2-LP behind it, to run the receive path of
+// the ST code on the host.
+//
+
+#include <string.h>
+
+#include "spi_stub.h"
+
+void SdkEvalSpiRawTC(void);
+
+static struct {
+    int in_rx;
+    uint8_t fifo[128];
+    uint8_t fifo_length;
+    uint16_t status;
+    // IRQ_STATUS0, the others stay clear.
+    uint8_t irq_status;
+    uint8_t smps;
+} radio;
+
+static struct {
+    int pending;
+    uint8_t length;
+    const uint8_t *in;
+    uint8_t *out;
+} transfer;
+
+static uint8_t scratch[130];
+static spi_stub_stats stats;
+
+/**
+ * Reset the radio, in RX with an empty FIFO, and the counters.
+ */
+void spi_stub_init(void) {
+    memset(&radio, 0, sizeof(radio));
+    memset(&transfer, 0, sizeof(transfer));
+    memset(&stats, 0, sizeof(stats));
+    radio.in_rx = 1;
+}
+
+/**
+ * Have the radio receive a frame, with the status its next transfers return.
+ * Returns 1 if it was in RX and got it, 0 if it missed it.
+ */
+int spi_stub_receive(const uint8_t *frame, uint8_t length, uint16_t status) {
+    if (!radio.in_rx) {
+        stats.missed++;
+        return 0;
+    }
+    if (length > sizeof(radio.fifo)) {
+        length = sizeof(radio.fifo);
+    }
+    memcpy(radio.fifo, frame, length);
+    radio.fifo_length = length;
+    radio.status = status;
+    radio.irq_status |= 0x01; // RX_DATA_READY
+    radio.in_rx = 0;
+    return 1;
+}
+
+/**
+ * Have the radio discard a frame, upon filtering.
+ * Returns 1 if it was in RX, 0 if it missed it.
+ */
+int spi_stub_discard(void) {
+    if (!radio.in_rx) {
+        stats.missed++;
+        return 0;
+    }
+    radio.irq_status |= 0x02; // RX_DATA_DISC
+    radio.in_rx = 0;
+    return 1;
+}
+
+static void run_transfer(void) {
+    const uint8_t *in = transfer.in;
+    uint8_t *out = transfer.out ? transfer.out : scratch;
+    uint8_t length = transfer.length;
+    stats.transfers++;
+    if (length < 2) {
+        stats.unknown++;
+        return;
+    }
+    // Full duplex: the status bytes come out while the header goes in.
+    out[0] = radio.status >> 8;
+    out[1] = radio.status;
+    uint8_t n_bytes = length - 2;
+    if (in[0] == 0x01 && in[1] == 0xFA && n_bytes == 4) {
+        memset(out + 2, 0, 3);
+        out[5] = radio.irq_status;
+        radio.irq_status = 0;
+    } else if (in[0] == 0x01 && in[1] == 0x90 && n_bytes == 1) {
+        out[2] = radio.fifo_length;
+    } else if (in[0] == 0x01 && in[1] == 0xFF) {
+        if (n_bytes > radio.fifo_length) {
+            stats.underruns++;
+            memset(out + 2 + radio.fifo_length, 0, n_bytes - radio.fifo_length);
+        }
+        memcpy(out + 2, radio.fifo, n_bytes < radio.fifo_length ? n_bytes : radio.fifo_length);
+        stats.buffer = out;
+        stats.written = length;
+    } else if (in[0] == 0x80 && in[1] == 0x71 && !n_bytes) {
+        radio.fifo_length = 0;
+    } else if (in[0] == 0x00 && in[1] == 0x76 && n_bytes == 1) {
+        radio.smps = in[2];
+    } else if (in[0] == 0x80 && in[1] == 0x61 && !n_bytes) {
+        if (radio.fifo_length) {
+            stats.unflushed_rx++;
+        }
+        radio.in_rx = 1;
+    } else {
+        stats.unknown++;
+    }
+}
+
+void S2LPSpiRaw(uint8_t n_bytes, uint8_t* in_buffer, uint8_t* out_buffer, uint8_t can_return_bef_tx) {
+    if (transfer.pending) {
+        stats.overlaps++;
+    }
+    transfer.length = n_bytes;
+    transfer.in = in_buffer;
+    transfer.out = out_buffer;
+    if (can_return_bef_tx) {
+        transfer.pending = 1;
+    } else {
+        stats.blocking++;
+        run_transfer();
+    }
+}
+
+/**
+ * End the transfer in progress, if any, and call SdkEvalSpiRawTC().
+ * Returns 1 if there was one.
+ */
+int spi_stub_complete(void) {
+    if (!transfer.pending) {
+        return 0;
+    }
+    run_transfer();
+    transfer.pending = 0;
+    SdkEvalSpiRawTC();
+    return 1;
+}
+
+const spi_stub_stats *spi_stub_get_stats(void) {
+    return &stats;
+}
@@ -0,0 +1,51 @@
+//
+// Fake SPI backend with a fake S2-LP behind it, to run the receive path of
+// the ST code on the host.
+//
+// S2LPSpiRaw() only records the transfer when it may return before it's
+// done, as the DMA would run it; spi_stub_complete() then plays the
+// transfer against the radio and calls SdkEvalSpiRawTC(), as the DMA
+// interrupt does. The radio understands what the receive path sends: reads
+// of the IRQ status, which clear it, of RX_FIFO_STATUS and of the FIFO, each
+// returning the 2 status bytes first, FLUSHRXFIFO, the SMPS register write
+// and RX. It only receives or discards a frame when in RX, and leaves RX
+// then, until the next RX command.
+//
+// The receive path must not wait on a transfer: the ones that don't return
+// before they are done are counted.
+//
+
+#ifndef __SPI_STUB_H
+#define __SPI_STUB_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <S2LP_CORE_SPI.h>
+
+typedef struct {
+    uint64_t transfers;
+    // Transfers started while another one was running, and the ones the
+    // radio didn't understand.
+    uint64_t overlaps;
+    uint64_t unknown;
+    // Transfers the caller waited for.
+    uint64_t blocking;
+    // Reads of more bytes than the FIFO held, and RX commands while the FIFO
+    // wasn't flushed.
+    uint64_t underruns;
+    uint64_t unflushed_rx;
+    // Frames the radio missed because it wasn't in RX.
+    uint64_t missed;
+    // Last FIFO read: the buffer and the number of bytes written to it.
+    const uint8_t *buffer;
+    size_t written;
+} spi_stub_stats;
+
+void spi_stub_init(void);
+int spi_stub_receive(const uint8_t *frame, uint8_t length, uint16_t status);
+int spi_stub_discard(void);
+int spi_stub_complete(void);
+const spi_stub_stats *spi_stub_get_stats(void);
+
+#endif
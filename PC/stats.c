@@ -0,0 +1,170 @@
+//
+// Throughput statistics of a key search.
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "stats.h"
+
+/**
+ * Allocate zeroed counters for count threads, each on its own cache lines.
+ */
+stats_counters *stats_alloc(unsigned count) {
+    stats_counters *counters = aligned_alloc(STATS_CACHE_LINE, count * sizeof(*counters));
+    if (!counters) {
+        return NULL;
+    }
+    for (unsigned t=0; t<count; t++) {
+        atomic_init(&counters[t].keys, 0);
+        atomic_init(&counters[t].candidates, 0);
+        atomic_init(&counters[t].sequence_rejects, 0);
+        for (int i=0; i<CONSTRAINT_MAX_OPS; i++) {
+            atomic_init(&counters[t].op_rejects[i], 0);
+        }
+    }
+    return counters;
+}
+
+/**
+ * Add to a counter of the calling thread. There is a single writer, so this
+ * is a plain load and store rather than a locked read-modify-write.
+ */
+void stats_add(atomic_uint_fast64_t *counter, uint64_t value) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+void stats_sample_all(const stats_counters *counters, unsigned count, stats_sample *sample) {
+    memset(sample, 0, sizeof(*sample));
+    for (unsigned t=0; t<count; t++) {
+        sample->keys += atomic_load_explicit(&counters[t].keys, memory_order_relaxed);
+        sample->candidates += atomic_load_explicit(&counters[t].candidates, memory_order_relaxed);
+        sample->sequence_rejects += atomic_load_explicit(&counters[t].sequence_rejects, memory_order_relaxed);
+        for (int i=0; i<CONSTRAINT_MAX_OPS; i++) {
+            sample->op_rejects[i] += atomic_load_explicit(&counters[t].op_rejects[i], memory_order_relaxed);
+        }
+    }
+}
+
+double stats_elapsed(const stats_reporter *reporter) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - reporter->start.tv_sec) + (now.tv_nsec - reporter->start.tv_nsec) / 1e9;
+}
+
+// The keys that no constraint rejected are rejected by the check byte:
+static uint64_t check_byte_rejects(const stats_reporter *reporter, const stats_sample *sample) {
+    uint64_t others = sample->candidates + sample->sequence_rejects;
+    for (size_t i=0; i<reporter->constraints->op_count; i++) {
+        others += sample->op_rejects[i];
+    }
+    return sample->keys > others ? sample->keys - others : 0;
+}
+
+static void report_json(const stats_reporter *reporter, const stats_sample *sample, int final, double elapsed, double speed) {
+    printf(
+        "{\"final\":%s,\"elapsed\":%.3f,\"threads\":%u,\"keys\":%" PRIu64 ",\"total\":%" PRIu64 ",\"keys_per_second\":%.0f,\"eta\":",
+        final ? "true" : "false", elapsed, reporter->counter_count, sample->keys, reporter->total_keys, speed
+    );
+    if (reporter->total_keys && speed > 0) {
+        printf("%.0f", (reporter->total_keys - sample->keys) / speed);
+    } else {
+        printf("null");
+    }
+    printf(",\"candidates\":%" PRIu64, sample->candidates);
+    if (reporter->constraints) {
+        printf(",\"rejects\":{\"check_byte\":%" PRIu64, check_byte_rejects(reporter, sample));
+        for (size_t i=0; i<reporter->constraints->op_count; i++) {
+            printf(",\"%s\":%" PRIu64, constraint_op_name(&reporter->constraints->ops[i]), sample->op_rejects[i]);
+        }
+        printf(",\"sequence\":%" PRIu64 "}", sample->sequence_rejects);
+    }
+    printf("}\n");
+}
+
+static void report_text(const stats_reporter *reporter, const stats_sample *sample, int final, double elapsed, double speed) {
+    if (final) {
+        printf(
+            "%" PRIu64 " %s tried in %.1fs on %u thread(s), %.2f Mkeys/s\n",
+            sample->keys, reporter->key_name, elapsed, reporter->counter_count, speed / 1e6
+        );
+        if (reporter->constraints && sample->keys > 0) {
+            printf("Rejected by: check byte %" PRIu64, check_byte_rejects(reporter, sample));
+            for (size_t i=0; i<reporter->constraints->op_count; i++) {
+                printf(", %s %" PRIu64, constraint_op_name(&reporter->constraints->ops[i]), sample->op_rejects[i]);
+            }
+            printf(", sequence %" PRIu64 "\n", sample->sequence_rejects);
+        }
+        return;
+    }
+
+    if (!reporter->total_keys) {
+        printf("%" PRIu64 " %s tried, %.2f Mkeys/s\n", sample->keys, reporter->key_name, speed / 1e6);
+        return;
+    }
+    printf("%" PRIu64 "/%" PRIu64 " %s tried, %.2f Mkeys/s", sample->keys, reporter->total_keys, reporter->key_name, speed / 1e6);
+    if (speed > 0) {
+        uint64_t eta = (reporter->total_keys - sample->keys) / speed;
+        printf(", ETA %" PRIu64 "h%.2" PRIu64 "m%.2" PRIu64 "s", eta / 3600, eta / 60 % 60, eta % 60);
+    }
+    printf(", %" PRIu64 " candidate(s)\n", sample->candidates);
+}
+
+/**
+ * Print a sample, as a progress report or as the final one.
+ */
+void stats_report(const stats_reporter *reporter, const stats_sample *sample, int final) {
+    double elapsed = stats_elapsed(reporter);
+    double speed = elapsed > 0 ? sample->keys / elapsed : 0;
+    if (reporter->json) {
+        report_json(reporter, sample, final, elapsed, speed);
+    } else {
+        report_text(reporter, sample, final, elapsed, speed);
+    }
+    fflush(stdout);
+}
+
+static void *reporter_main(void *arg) {
+    stats_reporter *reporter = arg;
+    struct timespec tick = {0, 100000000};
+    double last_report = 0;
+
+    while (!atomic_load_explicit(&reporter->stop, memory_order_relaxed)) {
+        nanosleep(&tick, NULL);
+        double elapsed = stats_elapsed(reporter);
+        if (elapsed - last_report < reporter->interval) {
+            continue;
+        }
+        stats_sample sample;
+        stats_sample_all(reporter->counters, reporter->counter_count, &sample);
+        stats_report(reporter, &sample, 0);
+        if (reporter->hook) {
+            reporter->hook(reporter->hook_arg);
+        }
+        last_report = elapsed;
+    }
+    return NULL;
+}
+
+/**
+ * Start the clock and the reporter thread.
+ * Returns 0 on success, -1 if the thread could not be started.
+ */
+int stats_reporter_start(stats_reporter *reporter) {
+    clock_gettime(CLOCK_MONOTONIC, &reporter->start);
+    atomic_init(&reporter->stop, 0);
+    if (pthread_create(&reporter->thread, NULL, reporter_main, reporter) != 0) {
+        fprintf(stderr, "Cannot start the reporter thread\n");
+        return -1;
+    }
+    return 0;
+}
+
+void stats_reporter_stop(stats_reporter *reporter) {
+    atomic_store_explicit(&reporter->stop, 1, memory_order_relaxed);
+    pthread_join(reporter->thread, NULL);
+}
@@ -0,0 +1,66 @@
+//
+// Throughput statistics of a key search.
+//
+// Every search thread has its own counters, alone on their cache lines, that
+// only it writes, once per chunk. A reporter thread samples them at a fixed
+// interval and prints the speed, the ETA and what rejected the keys, as text
+// or as JSON lines.
+//
+
+#ifndef __STATS_H
+#define __STATS_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "constraints.h"
+
+#define STATS_CACHE_LINE 64
+
+typedef struct stats_counters {
+    _Alignas(STATS_CACHE_LINE) atomic_uint_fast64_t keys;
+    atomic_uint_fast64_t candidates;
+    // Keys rejected by the constraints between frames, and by each
+    // instruction of the compiled constraints.
+    atomic_uint_fast64_t sequence_rejects;
+    atomic_uint_fast64_t op_rejects[CONSTRAINT_MAX_OPS];
+} stats_counters;
+
+// Sum of the counters of all the threads.
+typedef struct {
+    uint64_t keys;
+    uint64_t candidates;
+    uint64_t sequence_rejects;
+    uint64_t op_rejects[CONSTRAINT_MAX_OPS];
+} stats_sample;
+
+typedef struct {
+    // What to sample:
+    const stats_counters *counters;
+    unsigned counter_count;
+    const payload_constraints *constraints;
+    // What the keys are, and how many to try (0 if unknown).
+    const char *key_name;
+    uint64_t total_keys;
+    unsigned interval;
+    int json;
+    // Called after each report.
+    void (*hook)(void *arg);
+    void *hook_arg;
+
+    struct timespec start;
+    atomic_int stop;
+    pthread_t thread;
+} stats_reporter;
+
+stats_counters *stats_alloc(unsigned count);
+void stats_add(atomic_uint_fast64_t *counter, uint64_t value);
+void stats_sample_all(const stats_counters *counters, unsigned count, stats_sample *sample);
+double stats_elapsed(const stats_reporter *reporter);
+void stats_report(const stats_reporter *reporter, const stats_sample *sample, int final);
+int stats_reporter_start(stats_reporter *reporter);
+void stats_reporter_stop(stats_reporter *reporter);
+
+#endif
@@ -0,0 +1,315 @@
+//
+// Benchmark of the UART TX queue of the ST code, with a simulated DMA: its
+// counter goes down by a fixed number of bytes at every tick, one tick per
+// record sent and per poll of a sender waiting for room, and the transfer
+// completion hands it the next run of the queue, as the UART interrupt does.
+//
+// The CSV lines of random readings go through the reserve/commit queue and
+// the record functions the driver applies its overflow policy with, once per
+// policy, then through the previous byte per byte queue (a copy of it, with a
+// modulo of 400 and a critical section per byte). The critical sections are
+// NVIC register writes on the board: here, volatile stores, and they are
+// counted.
+//
+// What the DMA sends must be whole lines, in order, or it fails. The lines
+// it doesn't send must be the ones the queue counts as dropped, and none when
+// the policy is to wait.
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+
+// Use the PRIOS functions and the TX queue from the ST code.
+#include <PRIOS.h>
+#include <SDK_EVAL_Com_TxQueue.h>
+
+#define READING_COUNT 200000
+#define QUEUE_SIZE 512
+#define OLD_QUEUE_SIZE 400
+
+static uint32_t a_ids[READING_COUNT];
+static izar_reading readings[READING_COUNT];
+static uint8_t *expected;
+static size_t expected_length;
+
+// Bytes the DMA moves per tick.
+static uint16_t drain;
+
+// Where each line starts in the expected stream, and its end.
+static size_t line_starts[READING_COUNT + 1];
+
+// What the DMA sent so far.
+static uint8_t *output;
+static size_t sent;
+
+// The NVIC lines of UART_ENTER_CRITICAL() and UART_EXIT_CRITICAL().
+static volatile uint32_t nvic_registers[4];
+static uint64_t critical_sections;
+
+static void enter_critical(void) {
+    nvic_registers[0] = 1;
+    nvic_registers[1] = 1;
+}
+
+static void exit_critical(void) {
+    nvic_registers[2] = 1;
+    nvic_registers[3] = 1;
+    critical_sections++;
+}
+
+// The DMA channel: where it reads from, and its counter.
+typedef struct {
+    const uint8_t *source;
+    uint16_t residual;
+} dma_channel;
+
+static dma_channel dma;
+
+static void dma_start(const uint8_t *source, uint16_t length) {
+    dma.source = source;
+    dma.residual = length;
+}
+
+// Move up to drain bytes, and tell if the transfer is done.
+static int dma_tick(void) {
+    if (!dma.residual) {
+        return 0;
+    }
+    uint16_t count = dma.residual < drain ? dma.residual : drain;
+    if (sent + count > expected_length) {
+        // More than all the lines: it can't be them.
+        dma.residual = 0;
+        sent = expected_length + 1;
+        return 1;
+    }
+    memcpy(output + sent, dma.source, count);
+    sent += count;
+    dma.source += count;
+    dma.residual -= count;
+    return !dma.residual;
+}
+
+static double elapsed(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// The reserve/commit queue, and the driver around it.
+static uint8_t queue_data[QUEUE_SIZE];
+static tx_queue queue;
+static int policy;
+
+static void start_dma_tx(void) {
+    uint8_t *start;
+    uint16_t length = txQueueNextDmaRequest(&queue, &start);
+    if (length) {
+        dma_start(start, length);
+    }
+}
+
+static void tick(void) {
+    if (dma_tick()) {
+        // The completion interrupt.
+        txQueueDmaComplete(&queue);
+        start_dma_tx();
+    }
+}
+
+// updatetxQ(): a poll of the DMA counter, while time passes.
+static void poll(void) {
+    tick();
+    enter_critical();
+    txQueueDmaProgress(&queue, dma.residual);
+    exit_critical();
+}
+
+// The hooks of the driver, around the simulated DMA: the queue applies the
+// policy with them, as it does on the board.
+static const tx_queue_driver driver = {poll, enter_critical, exit_critical, start_dma_tx};
+
+// As printIZARReadingAsCSV() does it.
+static void send_reading(uint32_t a_id, const izar_reading *reading) {
+    tx_queue_span span;
+    if (txQueueTryReserveRecord(&queue, PRIOS_CSV_LINE_MAX, &span, &driver) && span.first_length >= PRIOS_CSV_LINE_MAX) {
+        txQueueCommitRecord(&queue, formatIZARReadingAsCSV((char *) span.first, a_id, reading), &driver);
+        return;
+    }
+    char line[PRIOS_CSV_LINE_MAX];
+    uint8_t len = formatIZARReadingAsCSV(line, a_id, reading);
+    txQueueSendRecord(&queue, (const uint8_t *) line, len, policy, &driver);
+}
+
+// The previous queue, as it was in SDK_EVAL_Com_DMA.c.
+static uint8_t old_q[OLD_QUEUE_SIZE];
+static uint16_t old_head;
+static uint16_t old_tail;
+static volatile uint16_t old_used;
+static volatile uint16_t old_last_request;
+static uint8_t old_transmitting;
+
+static void old_prepare_dma_tx(void) {
+    if (!old_transmitting && old_used != 0) {
+        enter_critical();
+        old_transmitting = 1;
+        if (old_tail + old_used < OLD_QUEUE_SIZE) {
+            old_last_request = old_used;
+        } else {
+            old_last_request = OLD_QUEUE_SIZE - old_tail;
+        }
+        dma_start(&old_q[old_tail], old_last_request);
+        exit_critical();
+    }
+}
+
+static void old_tick(void) {
+    if (dma_tick()) {
+        old_tail = (old_tail + old_last_request) % OLD_QUEUE_SIZE;
+        old_used -= old_last_request;
+        old_last_request = 0;
+        old_transmitting = 0;
+        old_prepare_dma_tx();
+    }
+}
+
+static void old_update_tx_q(void) {
+    old_tick();
+    enter_critical();
+    uint16_t residual = dma.residual;
+    old_tail = (old_tail + (old_last_request - residual)) % OLD_QUEUE_SIZE;
+    old_used -= old_last_request - residual;
+    old_last_request = residual;
+    exit_critical();
+}
+
+static void old_enqueue_tx_chars(const unsigned char *buffer, uint16_t size) {
+    while (size > 0) {
+        while (old_used > OLD_QUEUE_SIZE - size) {
+            old_update_tx_q();
+        }
+        old_q[old_head] = *buffer++;
+        enter_critical();
+        old_used++;
+        exit_critical();
+        old_head = (old_head + 1) % OLD_QUEUE_SIZE;
+        size--;
+    }
+    old_prepare_dma_tx();
+}
+
+static void old_send_reading(uint32_t a_id, const izar_reading *reading) {
+    char line[PRIOS_CSV_LINE_MAX];
+    uint8_t len = formatIZARReadingAsCSV(line, a_id, reading);
+    old_enqueue_tx_chars((const unsigned char *) line, len);
+}
+
+typedef struct {
+    const char *name;
+    void (*send)(uint32_t a_id, const izar_reading *reading);
+    void (*tick)(void);
+    int policy;
+} sender;
+
+// Count the lines the DMA sent, and their bytes, -1 if it didn't send whole
+// lines in order.
+static long sent_lines(size_t *length) {
+    long count = 0;
+    size_t offset = 0;
+    if (sent > expected_length) {
+        return -1;
+    }
+    for (size_t line=0; line<READING_COUNT && offset<sent; line++) {
+        size_t line_length = line_starts[line + 1] - line_starts[line];
+        if (line_length <= sent - offset && !memcmp(output + offset, expected + line_starts[line], line_length)) {
+            offset += line_length;
+            count++;
+        }
+    }
+    *length = offset;
+    return offset == sent ? count : -1;
+}
+
+static int run(const sender *s) {
+    sent = 0;
+    critical_sections = 0;
+    memset(&dma, 0, sizeof(dma));
+    txQueueInit(&queue, queue_data, QUEUE_SIZE);
+    policy = s->policy;
+    old_head = old_tail = old_used = old_last_request = old_transmitting = 0;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i=0; i<READING_COUNT; i++) {
+        s->send(a_ids[i], &readings[i]);
+        s->tick();
+    }
+    double send_time = elapsed(&start);
+    // Let the DMA send what's left.
+    while (dma.residual) {
+        s->tick();
+    }
+    size_t length = 0;
+    long lines = sent_lines(&length);
+    fprintf(stderr, "%s queue, %" PRIu16 " bytes per tick: %.1f ns and %.2f critical sections per line, %ld of %d lines sent, %" PRIu32 " dropped\n",
+            s->name, drain, send_time * 1e9 / READING_COUNT, (double) critical_sections / READING_COUNT, lines, READING_COUNT, queue.dropped_records);
+    if (lines < 0) {
+        fprintf(stderr, "The %s queue didn't send whole lines in order\n", s->name);
+        return 1;
+    }
+    if (lines + queue.dropped_records != READING_COUNT || length + queue.dropped_bytes != expected_length) {
+        fprintf(stderr, "The %s queue didn't count the lines it dropped\n", s->name);
+        return 1;
+    }
+    if (s->policy == TX_QUEUE_BLOCK && lines != READING_COUNT) {
+        fprintf(stderr, "The %s queue dropped lines\n", s->name);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    srand(1);
+    expected = malloc((size_t) READING_COUNT * PRIOS_CSV_LINE_MAX);
+    output = malloc((size_t) READING_COUNT * PRIOS_CSV_LINE_MAX);
+    if (!expected || !output) {
+        perror("malloc");
+        return 1;
+    }
+    for (size_t i=0; i<READING_COUNT; i++) {
+        uint8_t header[4];
+        uint8_t payload[11];
+        for (size_t j=0; j<4; j++) {
+            header[j] = rand();
+        }
+        header[3] = (header[3] & 0xF8) | (rand() % 8);
+        for (size_t j=0; j<11; j++) {
+            payload[j] = rand();
+        }
+        a_ids[i] = i * 2654435761u;
+        parsePRIOSFrame(header, payload, &readings[i]);
+        line_starts[i] = expected_length;
+        expected_length += formatIZARReadingAsCSV((char *) expected + expected_length, a_ids[i], &readings[i]);
+    }
+    line_starts[READING_COUNT] = expected_length;
+
+    static const sender senders[] = {
+        {"reserve/commit, blocking", send_reading, tick, TX_QUEUE_BLOCK},
+        {"reserve/commit, dropping the newest", send_reading, tick, TX_QUEUE_DROP_NEWEST},
+        {"reserve/commit, dropping the oldest", send_reading, tick, TX_QUEUE_DROP_OLDEST},
+        {"byte per byte", old_send_reading, old_tick, TX_QUEUE_BLOCK},
+    };
+    int result = 0;
+    for (int arg=1; arg<(argc > 1 ? argc : 2); arg++) {
+        drain = argc > 1 ? strtoul(argv[arg], NULL, 0) : 256;
+        for (size_t i=0; i<sizeof(senders) / sizeof(senders[0]); i++) {
+            result |= run(&senders[i]);
+        }
+    }
+    return result;
+}
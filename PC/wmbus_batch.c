@@ -0,0 +1,208 @@
+//
+// Validation of the WMBus CRCs of many frames at once, for the host tools.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "wmbus_batch.h"
+#include "WMBus.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define WMBUS_BATCH_CLMUL
+#include <immintrin.h>
+#endif
+
+// Length of the header block and of the full data blocks, without their CRC:
+#define HEADER_BLOCK_LEN 10
+#define DATA_BLOCK_LEN 16
+
+// CRC of a block of at most DATA_BLOCK_LEN bytes, from 0, before the final
+// inversion.
+typedef uint16_t (*block_crc)(const uint8_t *data, size_t len);
+
+static uint16_t block_crc_table(const uint8_t *data, size_t len) {
+    return crcUpdate(0, data, len);
+}
+
+#ifdef WMBUS_BATCH_CLMUL
+// With the CRC polynomial P = x^16 + 0x3D65: x^80 mod P, x^64 mod P, and
+// floor(x^64 / P) for the Barrett reduction.
+#define CLMUL_X80_MOD_P 0x90D0
+#define CLMUL_X64_MOD_P 0xF23F
+#define CLMUL_X64_DIV_P 0x138E2F03E28D3ULL
+#define CLMUL_P 0x13D65
+
+__attribute__((target("pclmul,sse4.1"))) static inline uint64_t clmul(uint64_t a, uint64_t b, uint64_t *high) {
+    __m128i product = _mm_clmulepi64_si128(_mm_cvtsi64_si128(a), _mm_cvtsi64_si128(b), 0);
+    *high = _mm_extract_epi64(product, 1);
+    return _mm_cvtsi128_si64(product);
+}
+
+static inline uint64_t read_be64(const uint8_t *data) {
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return __builtin_bswap64(value);
+}
+
+// The CRC from 0 of a message M is M x^16 mod P, whatever the zeros in front
+// of M: the block is read as a right-aligned 128 bit value, H x^64 + L.
+__attribute__((target("pclmul,sse4.1"))) static inline uint16_t block_crc_clmul(const uint8_t *data, size_t len) {
+    if (len < 8) {
+        return crcUpdate(0, data, len);
+    }
+    uint64_t h = 0;
+    if (len == DATA_BLOCK_LEN) {
+        h = read_be64(data);
+    } else {
+        for (size_t i=0; i<len-8; i++) {
+            h = h << 8 | data[i];
+        }
+    }
+    uint64_t l = read_be64(data + len - 8);
+    uint64_t ignored;
+
+    // M x^16 = H x^80 + L x^16 = H (x^80 mod P) + L x^16, 80 bits:
+    uint64_t t_high;
+    uint64_t t = clmul(h, CLMUL_X80_MOD_P, &t_high);
+    t ^= l << 16;
+    t_high ^= l >> 48;
+    // Fold the 16 bits above x^64 back, 64 bits:
+    t ^= clmul(t_high, CLMUL_X64_MOD_P, &ignored);
+    // Barrett: q = floor(t / P), then t - q P is the remainder:
+    uint64_t q_high;
+    uint64_t q_low = clmul(t >> 16, CLMUL_X64_DIV_P, &q_high);
+    uint64_t q = q_low >> 48 | q_high << 16;
+    return (uint16_t)(t ^ clmul(q, CLMUL_P, &ignored));
+}
+#endif
+
+static inline int block_valid(const uint8_t *block, size_t len, block_crc crc) {
+    uint16_t value = ~crc(block, len);
+    return block[len] == (uint8_t)(value >> 8) && block[len + 1] == (uint8_t) value;
+}
+
+// Same checks as CheckWMBusFrame(). The blocks are all checked, without
+// branching on each result, so that their CRCs are computed in parallel.
+static inline int frame_valid(const uint8_t *frame, size_t len, block_crc crc) {
+    if (len < 13 || len > 0xFF) {
+        return 0;
+    }
+    int valid = block_valid(frame, HEADER_BLOCK_LEN, crc);
+    size_t offset = HEADER_BLOCK_LEN + 2;
+    for (; offset + DATA_BLOCK_LEN + 2 <= len; offset += DATA_BLOCK_LEN + 2) {
+        valid &= block_valid(frame + offset, DATA_BLOCK_LEN, crc);
+    }
+    if (offset < len) {
+        valid &= len - offset >= 2 && block_valid(frame + offset, len - offset - 2, crc);
+    }
+    return valid;
+}
+
+static inline size_t check_frames(const uint8_t *const *frames, const size_t *lengths, size_t count, wmbus_frame_fields *fields, block_crc crc) {
+    size_t valid_count = 0;
+    for (size_t i=0; i<count; i++) {
+        const uint8_t *frame = frames[i];
+        if (!frame_valid(frame, lengths[i], crc)) {
+            fields->l_field[i] = 0;
+            fields->c_field[i] = 0;
+            fields->m_field[i] = 0;
+            fields->a_id[i] = 0;
+            fields->a_ver[i] = 0;
+            fields->a_type[i] = 0;
+            continue;
+        }
+        fields->valid[i / 64] |= (uint64_t) 1 << (i % 64);
+        fields->l_field[i] = frame[0];
+        fields->c_field[i] = frame[1];
+        fields->m_field[i] = frame[3] << 8 | frame[2];
+        fields->a_id[i] = frame[4] | frame[5] << 8 | frame[6] << 16 | (uint32_t) frame[7] << 24;
+        fields->a_ver[i] = frame[8];
+        fields->a_type[i] = frame[9];
+        valid_count++;
+    }
+    return valid_count;
+}
+
+static size_t check_frames_table(const uint8_t *const *frames, const size_t *lengths, size_t count, wmbus_frame_fields *fields) {
+    return check_frames(frames, lengths, count, fields, block_crc_table);
+}
+
+// Set to compute the CRCs with the tables even if the CPU has PCLMULQDQ.
+static int table_forced;
+
+#ifdef WMBUS_BATCH_CLMUL
+__attribute__((target("pclmul,sse4.1"))) static size_t check_frames_clmul(const uint8_t *const *frames, const size_t *lengths, size_t count, wmbus_frame_fields *fields) {
+    return check_frames(frames, lengths, count, fields, block_crc_clmul);
+}
+
+static int clmul_supported(void) {
+    return !table_forced && __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+}
+#endif
+
+/**
+ * Allocate the arrays for count frames.
+ * Returns 0 on success, -1 if memory is exhausted.
+ */
+int wmbus_fields_alloc(wmbus_frame_fields *fields, size_t count) {
+    fields->count = count;
+    fields->valid = calloc(count / 64 + 1, sizeof(uint64_t));
+    fields->l_field = malloc(count + 1);
+    fields->c_field = malloc(count + 1);
+    fields->m_field = malloc(count * sizeof(uint16_t) + 1);
+    fields->a_id = malloc(count * sizeof(uint32_t) + 1);
+    fields->a_ver = malloc(count + 1);
+    fields->a_type = malloc(count + 1);
+    if (!fields->valid || !fields->l_field || !fields->c_field || !fields->m_field || !fields->a_id || !fields->a_ver || !fields->a_type) {
+        wmbus_fields_free(fields);
+        return -1;
+    }
+    return 0;
+}
+
+void wmbus_fields_free(wmbus_frame_fields *fields) {
+    free(fields->valid);
+    free(fields->l_field);
+    free(fields->c_field);
+    free(fields->m_field);
+    free(fields->a_id);
+    free(fields->a_ver);
+    free(fields->a_type);
+    memset(fields, 0, sizeof(*fields));
+}
+
+/**
+ * Make wmbus_check_frames() use the tables whatever the CPU, or not, to
+ * compare both.
+ */
+void wmbus_force_table_crc(int force) {
+    table_forced = force;
+}
+
+/**
+ * How wmbus_check_frames() computes the CRCs on this CPU.
+ */
+const char *wmbus_crc_engine(void) {
+#ifdef WMBUS_BATCH_CLMUL
+    if (clmul_supported()) {
+        return "pclmul";
+    }
+#endif
+    return "table";
+}
+
+/**
+ * Check the CRCs of count frames, frame i being lengths[i] bytes at
+ * frames[i], into fields allocated for at least count frames.
+ * Returns the number of valid frames.
+ */
+size_t wmbus_check_frames(const uint8_t *const *frames, const size_t *lengths, size_t count, wmbus_frame_fields *fields) {
+    memset(fields->valid, 0, (count / 64 + 1) * sizeof(uint64_t));
+#ifdef WMBUS_BATCH_CLMUL
+    if (clmul_supported()) {
+        return check_frames_clmul(frames, lengths, count, fields);
+    }
+#endif
+    return check_frames_table(frames, lengths, count, fields);
+}
@@ -0,0 +1,43 @@
+//
+// Validation of the WMBus CRCs of many frames at once, for the host tools.
+//
+// Every block of a frame (the 10 byte header, each 16 byte data block, and
+// the last partial one) has its own CRC-16, computed from 0, so the blocks of
+// all the frames are independent. With PCLMULQDQ, the CRC of a block of up to
+// 16 bytes is a fold and a Barrett reduction, 4 carry-less multiplications
+// that pipeline across blocks; without it, crcUpdate() and its tables.
+//
+// The result is a bitmap of the valid frames and their header fields, as
+// CheckWMBusFrame() would give them, in one array per field.
+//
+
+#ifndef __WMBUS_BATCH_H
+#define __WMBUS_BATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+    size_t count;
+    // Bit i % 64 of valid[i / 64] is set if frame i passes all its CRCs.
+    uint64_t *valid;
+    // The header fields of the valid frames, 0 for the others.
+    uint8_t *l_field;
+    uint8_t *c_field;
+    uint16_t *m_field;
+    uint32_t *a_id;
+    uint8_t *a_ver;
+    uint8_t *a_type;
+} wmbus_frame_fields;
+
+int wmbus_fields_alloc(wmbus_frame_fields *fields, size_t count);
+void wmbus_fields_free(wmbus_frame_fields *fields);
+void wmbus_force_table_crc(int force);
+const char *wmbus_crc_engine(void);
+size_t wmbus_check_frames(const uint8_t *const *frames, const size_t *lengths, size_t count, wmbus_frame_fields *fields);
+
+static inline int wmbus_frame_valid(const wmbus_frame_fields *fields, size_t i) {
+    return (fields->valid[i / 64] >> (i % 64)) & 1;
+}
+
+#endif
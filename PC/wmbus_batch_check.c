@@ -0,0 +1,123 @@
+//
+// Check of wmbus_check_frames() against CheckWMBusFrame() of the ST code, with
+// PCLMULQDQ if the CPU has it and with the tables.
+//
+// The frames have every length from 0 to MAX_LENGTH, with the CRCs of all
+// their blocks right, then some of them get a bit flipped or are cut short,
+// which leaves trailing blocks of every length, 1 byte included. Both must
+// agree on which frames are valid, and on their header fields.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "wmbus_batch.h"
+#include "WMBus.h"
+
+#define FRAME_COUNT 100000
+#define MAX_LENGTH 300
+
+static uint8_t frame_data[FRAME_COUNT][MAX_LENGTH];
+static const uint8_t *frames[FRAME_COUNT];
+static size_t lengths[FRAME_COUNT];
+
+static void write_crc(uint8_t *block, size_t len) {
+    uint16_t crc = ~crcUpdate(0, block, len);
+    block[len] = crc >> 8;
+    block[len + 1] = crc;
+}
+
+// A frame of len bytes with all its CRCs right, where there is room for them.
+static void make_frame(uint8_t *frame, size_t len) {
+    for (size_t i=0; i<len; i++) {
+        frame[i] = rand();
+    }
+    if (len < 12) {
+        return;
+    }
+    write_crc(frame, 10);
+    size_t offset = 12;
+    for (; offset + 18 <= len; offset += 18) {
+        write_crc(frame + offset, 16);
+    }
+    if (len - offset >= 2) {
+        write_crc(frame + offset, len - offset - 2);
+    }
+}
+
+static int check(const char *engine, size_t expected_valid) {
+    wmbus_frame_fields fields;
+    if (wmbus_fields_alloc(&fields, FRAME_COUNT)) {
+        perror("wmbus_fields_alloc");
+        return 1;
+    }
+    size_t valid_count = wmbus_check_frames(frames, lengths, FRAME_COUNT, &fields);
+    int result = 0;
+    for (size_t i=0; i<FRAME_COUNT && !result; i++) {
+        uint8_t l_field = 0, c_field = 0, a_ver = 0, a_type = 0;
+        uint16_t m_field = 0;
+        uint32_t a_id = 0;
+        int valid = lengths[i] <= 0xFF && CheckWMBusFrame(frames[i], lengths[i], &l_field, &c_field, &m_field, &a_id, &a_ver, &a_type);
+        if (wmbus_frame_valid(&fields, i) != valid) {
+            fprintf(stderr, "%s CRC: frame %zu of %zu bytes is %s, not %s\n", engine, i, lengths[i],
+                    valid ? "invalid" : "valid", valid ? "valid" : "invalid");
+            result = 1;
+        } else if (fields.l_field[i] != l_field || fields.c_field[i] != c_field || fields.m_field[i] != m_field
+                   || fields.a_id[i] != a_id || fields.a_ver[i] != a_ver || fields.a_type[i] != a_type) {
+            fprintf(stderr, "%s CRC: wrong header fields for frame %zu of %zu bytes\n", engine, i, lengths[i]);
+            result = 1;
+        }
+    }
+    if (!result && valid_count != expected_valid) {
+        fprintf(stderr, "%s CRC: %zu valid frames counted instead of %zu\n", engine, valid_count, expected_valid);
+        result = 1;
+    }
+    if (!result) {
+        fprintf(stderr, "%s CRC: same as CheckWMBusFrame() on %d frames, %zu valid\n", engine, FRAME_COUNT, valid_count);
+    }
+    wmbus_fields_free(&fields);
+    return result;
+}
+
+int main(void) {
+    srand(1);
+    size_t expected_valid = 0;
+    for (size_t i=0; i<FRAME_COUNT; i++) {
+        uint8_t *frame = frame_data[i];
+        size_t len = i % (MAX_LENGTH + 1);
+        make_frame(frame, len);
+        switch (rand() % 4) {
+        case 1:
+            // A bit flipped.
+            if (len) {
+                frame[rand() % len] ^= 1 << (rand() % 8);
+            }
+            break;
+        case 2:
+            // Cut short.
+            len = len ? (size_t) rand() % len : 0;
+            break;
+        default:
+            break;
+        }
+        frames[i] = frame;
+        lengths[i] = len;
+        uint8_t u8;
+        uint16_t u16;
+        uint32_t u32;
+        expected_valid += len <= 0xFF && CheckWMBusFrame(frame, len, &u8, &u8, &u16, &u32, &u8, &u8);
+    }
+
+    int result = 0;
+    wmbus_force_table_crc(0);
+    if (strcmp(wmbus_crc_engine(), "table")) {
+        result |= check(wmbus_crc_engine(), expected_valid);
+    } else {
+        fprintf(stderr, "No PCLMULQDQ on this CPU, only the tables are checked\n");
+    }
+    wmbus_force_table_crc(1);
+    result |= check(wmbus_crc_engine(), expected_valid);
+    return result;
+}
@@ -94,7 +94,7 @@ extern "C" {
 
 
 #define NUCLEO_UARTx_RX_QUEUE_SIZE			(400)
-#define NUCLEO_UARTx_TX_QUEUE_SIZE			(400)
+#define NUCLEO_UARTx_TX_QUEUE_SIZE			(512)
 
 
 /*****************************************************************************/
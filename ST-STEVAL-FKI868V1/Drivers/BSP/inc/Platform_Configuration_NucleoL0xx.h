@@ -69,7 +69,7 @@ extern "C" {
 #define SDK_EVAL_UART_TX_PIN            		GPIO_PIN_3
 #define SDK_EVAL_UART_RX_PIN            		GPIO_PIN_2
 #define NUCLEO_UARTx_RX_QUEUE_SIZE      		(400)
-#define NUCLEO_UARTx_TX_QUEUE_SIZE      		(400)
+#define NUCLEO_UARTx_TX_QUEUE_SIZE      		(512)
 
 #define NUCLEO_UARTx                            USART2
 #define NUCLEO_UARTx_AF                         GPIO_AF4_USART2
@@ -100,7 +100,7 @@ extern "C" {
 #define NUCLEO_UARTx_DMA_CLK_DISABLE()		__DMA1_CLK_DISABLE()
 
 #define NUCLEO_UARTx_RX_QUEUE_SIZE			(1224)
-#define NUCLEO_UARTx_TX_QUEUE_SIZE			(3*1024)
+#define NUCLEO_UARTx_TX_QUEUE_SIZE			(4*1024)
 
 /*****************************************************************************/
 /*                               TIM and CK SECTION                          */
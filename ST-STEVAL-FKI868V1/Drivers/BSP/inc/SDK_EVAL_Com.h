@@ -28,6 +28,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "cube_hal.h"
+#include "SDK_EVAL_Com_TxQueue.h"
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -55,6 +56,22 @@ extern "C" {
 
 
 
+/** @defgroup SDK_EVAL_Com_Exported_Constants          SDK EVAL Com Exported Constants
+* @{
+*/
+
+/* What the TX queue does when it has no room for a record: TX_QUEUE_DROP_NEWEST,
+   TX_QUEUE_DROP_OLDEST or TX_QUEUE_BLOCK. Only blocking can hold the caller
+   until the UART catches up. */
+#ifndef SDK_EVAL_COM_TX_OVERFLOW_POLICY
+#define SDK_EVAL_COM_TX_OVERFLOW_POLICY TX_QUEUE_DROP_NEWEST
+#endif
+
+/**
+* @}
+*/
+
+
 /** @defgroup SDK_EVAL_Com_Exported_Functions           SDK EVAL Com Exported Functions
 * @{
 */
@@ -63,6 +80,11 @@ extern "C" {
 void SdkEvalComInit(void);
 void SdkEvalComBaudrate(uint32_t baudrate);
 void SdkEvalComTriggerTx(void);
+void enqueueTxChars(const unsigned char * buffer, uint16_t size);
+uint8_t tryReserveTxChars(uint16_t size, tx_queue_span * span);
+uint8_t reserveTxChars(uint16_t size, tx_queue_span * span);
+void commitTxChars(uint16_t size);
+void SdkEvalComGetTxDrops(uint32_t * records, uint32_t * bytes);
 unsigned char __io_getcharNonBlocking(unsigned char *data);
 void __io_putchar( char c );
 int __io_getchar(void);
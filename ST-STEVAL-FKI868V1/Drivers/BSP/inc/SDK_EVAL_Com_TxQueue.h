@@ -0,0 +1,118 @@
+/**
+* @file    SDK_EVAL_Com_TxQueue.h
+* @brief   Transmit queue of the SDK UART, without the hardware.
+* @details
+*
+* A ring of a power of two bytes between the code that sends and the DMA
+* that transmits. The sender reserves room for a whole record, writes it in
+* place, then commits it; the DMA is handed the longest contiguous run of
+* committed bytes, up to the end of the buffer, and the rest once it's done.
+*
+* head only moves on commit, tail as the DMA retires bytes: both run freely
+* and are masked on use, so the used count is head - tail, modulo 2^16.
+*
+* Each commit is a record, sent whole or not at all: when there is no room
+* for one, the overflow policy drops it, drops the oldest records the DMA
+* hasn't been handed yet to make room, or waits. The queue keeps where the
+* records start for that, and counts what it drops. The record functions
+* apply the policy, with the hardware left to the driver's hooks.
+*/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SDK_EVAL_COM_TXQUEUE_H
+#define __SDK_EVAL_COM_TXQUEUE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#if defined(__ICCARM__)
+#include <intrinsics.h>
+#define TX_QUEUE_BARRIER() __DMB()
+#else
+#define TX_QUEUE_BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+/* What to do with a record the queue has no room for */
+#define TX_QUEUE_DROP_NEWEST    0
+#define TX_QUEUE_DROP_OLDEST    1
+#define TX_QUEUE_BLOCK          2
+
+/* Records a queue keeps track of: with more, it's full */
+#ifndef TX_QUEUE_RECORDS
+#define TX_QUEUE_RECORDS 32
+#endif
+
+/** Room reserved in a queue: first, then second if it wraps around its end */
+typedef struct _tx_queue_span {
+    uint8_t *first;
+    uint16_t first_length;
+    uint8_t *second;
+    uint16_t second_length;
+} tx_queue_span;
+
+/** What the record functions need from the driver */
+typedef struct _tx_queue_driver {
+    /* Retire the bytes the DMA has transmitted, with txQueueDmaProgress() */
+    void (*poll)(void);
+    /* Keep the DMA interrupts out, then let them in again */
+    void (*enter_critical)(void);
+    void (*exit_critical)(void);
+    /* Hand the DMA its next request if it's idle, in a critical section */
+    void (*start_dma)(void);
+} tx_queue_driver;
+
+typedef struct _tx_queue {
+    uint8_t *data;
+    /* Size - 1, the size being a power of two, 32768 at most */
+    uint16_t mask;
+    /* Bytes committed, only written by the sender */
+    volatile uint16_t head;
+    /* Bytes transmitted */
+    volatile uint16_t tail;
+    /* Bytes handed to the DMA, transmitted or not */
+    volatile uint16_t dispatch;
+    /* Bytes handed to the DMA and not retired yet, and whether it runs */
+    volatile uint16_t dma_pending;
+    volatile uint8_t dma_running;
+    /* Where the records not handed to the DMA entirely start, oldest first,
+       only used by the sender */
+    uint16_t record_starts[TX_QUEUE_RECORDS];
+    uint8_t record_count;
+    /* Records dropped, and their bytes */
+    volatile uint32_t dropped_records;
+    volatile uint32_t dropped_bytes;
+} tx_queue;
+
+/**
+* @brief  Bytes waiting to be transmitted, or being so.
+* @param  queue The queue.
+* @retval uint16_t
+*/
+static inline uint16_t txQueueUsed(const tx_queue * const queue) {
+    return (uint16_t) (queue->head - queue->tail);
+}
+
+/**
+* @brief  Bytes that can be reserved.
+* @param  queue The queue.
+* @retval uint16_t
+*/
+static inline uint16_t txQueueFree(const tx_queue * const queue) {
+    return (uint16_t) (queue->mask + 1 - txQueueUsed(queue));
+}
+
+void txQueueInit(tx_queue * const queue, uint8_t * const data, const uint16_t size);
+uint8_t txQueueReserve(tx_queue * const queue, const uint16_t size, tx_queue_span * const span);
+void txQueueCommit(tx_queue * const queue, const uint16_t size);
+uint16_t txQueueDropOldest(tx_queue * const queue);
+void txQueueCountDrop(tx_queue * const queue, const uint16_t size);
+void txQueueSpanWrite(const tx_queue_span * const span, const uint8_t * const data, const uint16_t size);
+uint16_t txQueueNextDmaRequest(tx_queue * const queue, uint8_t ** const start);
+void txQueueDmaProgress(tx_queue * const queue, const uint16_t residual);
+void txQueueDmaComplete(tx_queue * const queue);
+uint8_t txQueueTryReserveRecord(tx_queue * const queue, const uint16_t size, tx_queue_span * const span, const tx_queue_driver * const driver);
+uint8_t txQueueReserveRecord(tx_queue * const queue, const uint16_t size, tx_queue_span * const span, const uint8_t policy, const tx_queue_driver * const driver);
+void txQueueCommitRecord(tx_queue * const queue, const uint16_t size, const tx_queue_driver * const driver);
+void txQueueSendRecord(tx_queue * const queue, const uint8_t * data, uint16_t size, const uint8_t policy, const tx_queue_driver * const driver);
+
+#endif
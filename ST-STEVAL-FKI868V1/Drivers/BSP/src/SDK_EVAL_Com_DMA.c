@@ -23,6 +23,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "SDK_EVAL_Com.h"
+#include "SDK_EVAL_Com_TxQueue.h"
 #include "SDK_EVAL_Config.h"
 
 #ifdef __ICCARM__
@@ -65,6 +66,7 @@
 
 #define RECEIVE_QUEUE_SIZE                      NUCLEO_UARTx_RX_QUEUE_SIZE
 #define TRANSMIT_QUEUE_SIZE                     NUCLEO_UARTx_TX_QUEUE_SIZE
+#define STDOUT_LINE_SIZE                        128
 
 #define UART_ENTER_CRITICAL()          {NVIC_DisableIRQ(NUCLEO_UARTx_IRQn); HAL_NVIC_DisableIRQ(NUCLEO_UARTx_TX_DMA_CHANNEL_IRQn);} //  __disable_irq()
 #define UART_EXIT_CRITICAL()           {NVIC_EnableIRQ(NUCLEO_UARTx_IRQn); HAL_NVIC_EnableIRQ(NUCLEO_UARTx_TX_DMA_CHANNEL_IRQn);} // __enable_irq()
@@ -76,11 +78,11 @@ volatile uint16_t rxUsed = 0;
 UART_HandleTypeDef huart;
 DMA_HandleTypeDef dma_handle_rx,dma_handle_tx;
 
+/* The TX queue is masked, not wrapped with a modulo */
+_Static_assert((TRANSMIT_QUEUE_SIZE & (TRANSMIT_QUEUE_SIZE - 1)) == 0 && TRANSMIT_QUEUE_SIZE <= 32768, "the UART TX queue size must be a power of two");
+
 uint8_t txQ[TRANSMIT_QUEUE_SIZE];
-uint16_t txHead = 0;
-uint16_t txTail = 0;
-volatile uint16_t txUsed = 0,txLastRequest=0;
-uint8_t dmaTransmitting = 0;
+static tx_queue txQueue;
 
 
 /**
@@ -94,7 +96,14 @@ uint8_t dmaTransmitting = 0;
 * @{
 */
 
+static void startDmaTx(void);
 static void prepareDmaTx(void);
+static void enterTxCritical(void);
+static void exitTxCritical(void);
+void updatetxQ(void);
+
+/* The hooks the TX queue applies its overflow policy with */
+static const tx_queue_driver txQueueDriver = {updatetxQ, enterTxCritical, exitTxCritical, startDmaTx};
 
 /**
 * @brief  Configures UART port in DMA mode for both RX and TX.
@@ -105,6 +114,8 @@ void SdkEvalComInit(void)
 {
   GPIO_InitTypeDef GPIO_InitStructure;
 
+  txQueueInit(&txQueue, txQ, TRANSMIT_QUEUE_SIZE);
+
   NUCLEO_UARTx_GPIO_CLK_ENABLE();
   NUCLEO_UARTx_CLK_ENABLE();
   NUCLEO_UARTx_DMA_CLK_ENABLE();
@@ -188,39 +199,85 @@ void SdkEvalComTriggerTx(void)
   prepareDmaTx();
 }
 
+static void enterTxCritical(void)
+{
+  UART_ENTER_CRITICAL();
+}
+
+static void exitTxCritical(void)
+{
+  UART_EXIT_CRITICAL();
+}
+
 void updatetxQ(void)
 {
   UART_ENTER_CRITICAL();
-  uint16_t  _temp;
 #ifdef USE_STM32F4XX_NUCLEO
   uint16_t dmaResidual=huart.hdmatx->Instance->NDTR;
 #else
   uint16_t dmaResidual=huart.hdmatx->Instance->CNDTR;
 #endif
-  txTail=(txTail+(txLastRequest-dmaResidual))%TRANSMIT_QUEUE_SIZE;
-  _temp = txLastRequest-dmaResidual;
-  txUsed-=_temp;
-  txLastRequest=dmaResidual;
+  txQueueDmaProgress(&txQueue, dmaResidual);
   UART_EXIT_CRITICAL();
 }
 
-void enqueueTxChars(const unsigned char * buffer, uint16_t size)
+/**
+* @brief  Get room for size bytes in the TX queue if there is some, without
+*         waiting nor dropping anything. Write them there, then send them
+*         with commitTxChars(); not committing leaves the queue as it was.
+* @param  size How many bytes.
+* @param  span Where to write them, in 2 parts if they wrap around the end of
+*         the queue.
+* @retval uint8_t 1 if there was room, 0 otherwise.
+*/
+uint8_t tryReserveTxChars(uint16_t size, tx_queue_span * span)
 {
-  while ( size > 0 ) {
+  return txQueueTryReserveRecord(&txQueue, size, span, &txQueueDriver);
+}
 
-    while(txUsed>TRANSMIT_QUEUE_SIZE-size)
-    {
-      updatetxQ();
-    }
+/**
+* @brief  Get room for a record of size bytes in the TX queue, as
+*         tryReserveTxChars() does, applying SDK_EVAL_COM_TX_OVERFLOW_POLICY
+*         if there is none: the record is dropped, or the oldest ones the DMA
+*         hasn't started sending, or it waits for the DMA. A dropped record is
+*         counted, see SdkEvalComGetTxDrops().
+* @param  size How many bytes, TRANSMIT_QUEUE_SIZE at most.
+* @param  span Where to write them.
+* @retval uint8_t 1 if there is room, 0 if the record is dropped.
+*/
+uint8_t reserveTxChars(uint16_t size, tx_queue_span * span)
+{
+  return txQueueReserveRecord(&txQueue, size, span, SDK_EVAL_COM_TX_OVERFLOW_POLICY, &txQueueDriver);
+}
 
-    txQ[txHead] = *buffer++;
-    UART_ENTER_CRITICAL();
-    txUsed++;
-    UART_EXIT_CRITICAL();
-    txHead = (txHead+1) % TRANSMIT_QUEUE_SIZE;
-    size--;
-  }
-  prepareDmaTx();
+/**
+* @brief  Send the first size bytes of the room reserved with
+*         reserveTxChars(), as a record, starting the DMA if it's idle.
+* @param  size How many bytes.
+* @retval None.
+*/
+void commitTxChars(uint16_t size)
+{
+  txQueueCommitRecord(&txQueue, size, &txQueueDriver);
+}
+
+/**
+* @brief  Records dropped by the TX queue since the start, and their bytes.
+* @param  records Where to store the number of records.
+* @param  bytes Where to store the number of bytes.
+* @retval None.
+*/
+void SdkEvalComGetTxDrops(uint32_t * records, uint32_t * bytes)
+{
+  *records = txQueue.dropped_records;
+  *bytes = txQueue.dropped_bytes;
+}
+
+/* Send a record, whole or not at all, or in pieces when it's longer than the
+   queue and the policy is to wait */
+void enqueueTxChars(const unsigned char * buffer, uint16_t size)
+{
+  txQueueSendRecord(&txQueue, buffer, size, SDK_EVAL_COM_TX_OVERFLOW_POLICY, &txQueueDriver);
 }
 
 void SdkEvalComBaudrate(uint32_t baudrate)
@@ -231,31 +288,61 @@ void SdkEvalComBaudrate(uint32_t baudrate)
   __HAL_UART_ENABLE(&huart);
 }
 
-static void prepareDmaTx(void)
+/* Hand the DMA the committed bytes up to the end of the queue, if it's idle;
+   the ones after the wrap go once it's done. With the UART IRQs masked. */
+static void startDmaTx(void)
 {
-  if(!dmaTransmitting && txUsed!=0)
-  {
-    UART_ENTER_CRITICAL();
-    dmaTransmitting=1;
+  uint8_t *start;
+  uint16_t length = txQueueNextDmaRequest(&txQueue, &start);
 
-    if(txTail+txUsed<TRANSMIT_QUEUE_SIZE)
-    {
-      txLastRequest=txUsed;
-    }
-    else
+  if(length)
+  {
+    if(HAL_UART_Transmit_DMA(&huart,start,length)==HAL_OK)
     {
-      txLastRequest=(TRANSMIT_QUEUE_SIZE-txTail);
+
     }
+  }
+}
 
-    if(HAL_UART_Transmit_DMA(&huart,&txQ[txTail],txLastRequest)==HAL_OK)
-    {
+static void prepareDmaTx(void)
+{
+  UART_ENTER_CRITICAL();
+  startDmaTx();
+  UART_EXIT_CRITICAL();
+}
 
-    }
+#if defined(__ICCARM__) || defined(__CC_ARM)
+/* printf() output, gathered until the end of its line */
+static unsigned char stdoutLine[STDOUT_LINE_SIZE];
+static uint16_t stdoutLineLength = 0;
 
-    UART_EXIT_CRITICAL();
+/* Send the printf() output gathered so far, as one record */
+static void flushStdoutLine(void)
+{
+  if(stdoutLineLength)
+  {
+    enqueueTxChars(stdoutLine, stdoutLineLength);
+    stdoutLineLength = 0;
   }
 }
 
+/* The standard library hands printf() output over in pieces, down to a
+   character at a time: send it a line at a time, so that the overflow policy
+   keeps or drops whole lines. A longer line than the buffer goes in pieces. */
+static void writeStdoutChars(const unsigned char * buffer, size_t size)
+{
+  while(size--)
+  {
+    const unsigned char c = *buffer++;
+    stdoutLine[stdoutLineLength++] = c;
+    if(c == '\n' || stdoutLineLength == STDOUT_LINE_SIZE)
+    {
+      flushStdoutLine();
+    }
+  }
+}
+#endif
+
 #ifdef __ICCARM__
   // IAR Standard library hook for serial output
   size_t __write(int handle, const unsigned char * buffer, size_t size)
@@ -265,7 +352,13 @@ static void prepareDmaTx(void)
     if (handle != _LLIO_STDOUT && handle != _LLIO_STDERR) {
       return _LLIO_ERROR;
     }
-    enqueueTxChars(buffer,size);
+    if(buffer == NULL)
+    {
+      /* A flush */
+      flushStdoutLine();
+      return 0;
+    }
+    writeStdoutChars(buffer,size);
 
     return size;
   }
@@ -274,9 +367,8 @@ static void prepareDmaTx(void)
   /* KEIL fputc implementation template allowing to redirect printf output towards serial port (UART/USB) */
   int fputc(int c, FILE *f)
   {
-    updatetxQ();
     const unsigned char c1 = c;
-    enqueueTxChars(&c1,1);
+    writeStdoutChars(&c1,1);
 
     return 1;
   }
@@ -330,6 +422,7 @@ static void prepareDmaTx(void)
   void __io_flush( void )
   {
     fputc(0, &__stdout);
+    flushStdoutLine();
   }
 
   void __io_putchar( char c )
@@ -342,17 +435,10 @@ static void prepareDmaTx(void)
 
 void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
 {
-  uint16_t  _temp;
+  /* From the UART IRQ, already out of the way of the sender */
+  txQueueDmaComplete(&txQueue);
 
-  txTail=(txTail+txLastRequest)%TRANSMIT_QUEUE_SIZE;
-
-  _temp = txLastRequest;
-  txUsed-=_temp;
-
-  txLastRequest=0;
-  dmaTransmitting=0;
-
-  prepareDmaTx();
+  startDmaTx();
 }
 
 
@@ -0,0 +1,329 @@
+/**
+* @file    SDK_EVAL_Com_TxQueue.c
+* @brief   Transmit queue of the SDK UART, without the hardware: the driver
+*          wraps the calls that need a critical section, or hands its hooks
+*          to the record functions.
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "SDK_EVAL_Com_TxQueue.h"
+
+/**
+* @brief  Set up an empty queue.
+* @param  queue The queue.
+* @param  data Its buffer.
+* @param  size The size of the buffer, a power of two.
+* @retval None.
+*/
+void txQueueInit(tx_queue * const queue, uint8_t * const data, const uint16_t size)
+{
+  memset(queue, 0, sizeof(*queue));
+  queue->data = data;
+  queue->mask = size - 1;
+}
+
+/**
+* @brief  Forget the records the DMA has been handed entirely.
+* @param  queue The queue.
+* @retval None.
+*/
+static void retireRecords(tx_queue * const queue)
+{
+  const uint16_t dispatch = queue->dispatch;
+  uint8_t retired = 0;
+
+  /* A record is handed entirely once the next one starts before dispatch */
+  while(retired + 1 < queue->record_count && (int16_t) (queue->record_starts[retired + 1] - dispatch) <= 0)
+  {
+    retired++;
+  }
+  if(queue->record_count && queue->head == dispatch)
+  {
+    retired = queue->record_count;
+  }
+  if(retired)
+  {
+    queue->record_count -= retired;
+    memmove(queue->record_starts, queue->record_starts + retired, queue->record_count * sizeof(queue->record_starts[0]));
+  }
+}
+
+/**
+* @brief  Sender side: get room for size bytes, after the ones committed. It
+*         is only handed to the DMA by txQueueCommit(); until then, the next
+*         reservation returns the same room.
+* @param  queue The queue.
+* @param  size How many bytes, the size of the queue at most.
+* @param  span Where the room is, in 2 parts if it wraps around.
+* @retval uint8_t 1 if there was room, 0 if there isn't yet.
+*/
+uint8_t txQueueReserve(tx_queue * const queue, const uint16_t size, tx_queue_span * const span)
+{
+  if(txQueueFree(queue) < size)
+  {
+    return 0;
+  }
+  if(queue->record_count == TX_QUEUE_RECORDS)
+  {
+    retireRecords(queue);
+    if(queue->record_count == TX_QUEUE_RECORDS)
+    {
+      return 0;
+    }
+  }
+  const uint16_t start = queue->head & queue->mask;
+  const uint16_t to_end = queue->mask + 1 - start;
+  span->first = &queue->data[start];
+  span->first_length = size < to_end ? size : to_end;
+  span->second = queue->data;
+  span->second_length = size - span->first_length;
+  return 1;
+}
+
+/**
+* @brief  Sender side: hand the first size bytes of the room reserved to the
+*         DMA, as a record. The driver then starts it if it's idle.
+* @param  queue The queue.
+* @param  size How many bytes, the size reserved at most.
+* @retval None.
+*/
+void txQueueCommit(tx_queue * const queue, const uint16_t size)
+{
+  if(!size)
+  {
+    return;
+  }
+  queue->record_starts[queue->record_count++] = queue->head;
+  /* The bytes must be in the buffer before the DMA can see them */
+  TX_QUEUE_BARRIER();
+  queue->head += size;
+}
+
+/**
+* @brief  Sender side: drop the oldest record the DMA hasn't been handed any
+*         byte of, and move the ones after it back in its place. The DMA
+*         must not be started meanwhile.
+* @param  queue The queue.
+* @retval uint16_t The length of the record, 0 if there was none to drop.
+*/
+uint16_t txQueueDropOldest(tx_queue * const queue)
+{
+  retireRecords(queue);
+
+  /* Only the first record can have been handed in part */
+  uint8_t index = 0;
+  if(queue->record_count && (int16_t) (queue->record_starts[0] - queue->dispatch) < 0)
+  {
+    index = 1;
+  }
+  if(index >= queue->record_count)
+  {
+    return 0;
+  }
+
+  const uint16_t start = queue->record_starts[index];
+  const uint16_t end = index + 1 < queue->record_count ? queue->record_starts[index + 1] : queue->head;
+  const uint16_t length = end - start;
+  const uint16_t after = queue->head - end;
+  for(uint16_t i = 0; i < after; i++)
+  {
+    queue->data[(start + i) & queue->mask] = queue->data[(end + i) & queue->mask];
+  }
+  queue->head -= length;
+
+  queue->record_count--;
+  for(uint8_t i = index; i < queue->record_count; i++)
+  {
+    queue->record_starts[i] = queue->record_starts[i + 1] - length;
+  }
+  txQueueCountDrop(queue, length);
+  return length;
+}
+
+/**
+* @brief  Count a record as dropped.
+* @param  queue The queue.
+* @param  size Its length.
+* @retval None.
+*/
+void txQueueCountDrop(tx_queue * const queue, const uint16_t size)
+{
+  queue->dropped_records++;
+  queue->dropped_bytes += size;
+}
+
+/**
+* @brief  Copy bytes into reserved room, across the end of the buffer.
+* @param  span The room.
+* @param  data The bytes.
+* @param  size How many, the size reserved at most.
+* @retval None.
+*/
+void txQueueSpanWrite(const tx_queue_span * const span, const uint8_t * const data, const uint16_t size)
+{
+  const uint16_t first = size < span->first_length ? size : span->first_length;
+  memcpy(span->first, data, first);
+  memcpy(span->second, data + first, size - first);
+}
+
+/**
+* @brief  DMA side: what to transmit next, if the DMA is idle: the committed
+*         bytes it hasn't been handed, up to the end of the buffer. The DMA is then
+*         running until txQueueDmaComplete().
+* @param  queue The queue.
+* @param  start Where the bytes are.
+* @retval uint16_t How many, 0 if there is nothing to do.
+*/
+uint16_t txQueueNextDmaRequest(tx_queue * const queue, uint8_t ** const start)
+{
+  const uint16_t waiting = queue->head - queue->dispatch;
+  if(queue->dma_running || waiting == 0)
+  {
+    return 0;
+  }
+  const uint16_t offset = queue->dispatch & queue->mask;
+  const uint16_t to_end = queue->mask + 1 - offset;
+  const uint16_t length = waiting < to_end ? waiting : to_end;
+  *start = &queue->data[offset];
+  queue->dispatch += length;
+  queue->dma_pending = length;
+  queue->dma_running = 1;
+  return length;
+}
+
+/**
+* @brief  DMA side: retire the bytes the running transfer has sent so far.
+* @param  queue The queue.
+* @param  residual The bytes it has left to send, from its counter.
+* @retval None.
+*/
+void txQueueDmaProgress(tx_queue * const queue, const uint16_t residual)
+{
+  if(residual > queue->dma_pending)
+  {
+    return;
+  }
+  queue->tail += queue->dma_pending - residual;
+  queue->dma_pending = residual;
+}
+
+/**
+* @brief  DMA side: the running transfer is done.
+* @param  queue The queue.
+* @retval None.
+*/
+void txQueueDmaComplete(tx_queue * const queue)
+{
+  queue->tail += queue->dma_pending;
+  queue->dma_pending = 0;
+  queue->dma_running = 0;
+}
+
+/**
+* @brief  Sender side: get room for a record of size bytes if there is some,
+*         retiring what the DMA transmitted if needed, without waiting nor
+*         dropping anything.
+* @param  queue The queue.
+* @param  size How many bytes.
+* @param  span Where to write them.
+* @param  driver The hooks of the driver.
+* @retval uint8_t 1 if there was room, 0 otherwise.
+*/
+uint8_t txQueueTryReserveRecord(tx_queue * const queue, const uint16_t size, tx_queue_span * const span, const tx_queue_driver * const driver)
+{
+  if(txQueueReserve(queue, size, span))
+  {
+    return 1;
+  }
+  driver->poll();
+  return txQueueReserve(queue, size, span);
+}
+
+/**
+* @brief  Sender side: get room for a record of size bytes, applying policy
+*         if there is none: the record is dropped, or the oldest ones the DMA
+*         hasn't been handed, or it waits for the DMA. A dropped record is
+*         counted.
+* @param  queue The queue.
+* @param  size How many bytes.
+* @param  span Where to write them.
+* @param  policy TX_QUEUE_DROP_NEWEST, TX_QUEUE_DROP_OLDEST or TX_QUEUE_BLOCK.
+* @param  driver The hooks of the driver.
+* @retval uint8_t 1 if there is room, 0 if the record is dropped.
+*/
+uint8_t txQueueReserveRecord(tx_queue * const queue, const uint16_t size, tx_queue_span * const span, const uint8_t policy, const tx_queue_driver * const driver)
+{
+  while(size <= queue->mask + 1)
+  {
+    if(txQueueTryReserveRecord(queue, size, span, driver))
+    {
+      return 1;
+    }
+    if(policy == TX_QUEUE_BLOCK)
+    {
+      continue;
+    }
+    if(policy == TX_QUEUE_DROP_OLDEST)
+    {
+      driver->enter_critical();
+      const uint16_t dropped = txQueueDropOldest(queue);
+      driver->exit_critical();
+      if(dropped)
+      {
+        continue;
+      }
+    }
+    break;
+  }
+  txQueueCountDrop(queue, size);
+  return 0;
+}
+
+/**
+* @brief  Sender side: commit a record written in the room reserved, and
+*         start the DMA if it's idle.
+* @param  queue The queue.
+* @param  size How many bytes.
+* @param  driver The hooks of the driver.
+* @retval None.
+*/
+void txQueueCommitRecord(tx_queue * const queue, const uint16_t size, const tx_queue_driver * const driver)
+{
+  driver->enter_critical();
+  txQueueCommit(queue, size);
+  driver->start_dma();
+  driver->exit_critical();
+}
+
+/**
+* @brief  Sender side: send a record, whole or not at all, applying policy.
+*         A record longer than the queue is sent in pieces if the policy is
+*         to wait, dropped otherwise.
+* @param  queue The queue.
+* @param  data The record.
+* @param  size Its length.
+* @param  policy TX_QUEUE_DROP_NEWEST, TX_QUEUE_DROP_OLDEST or TX_QUEUE_BLOCK.
+* @param  driver The hooks of the driver.
+* @retval None.
+*/
+void txQueueSendRecord(tx_queue * const queue, const uint8_t * data, uint16_t size, const uint8_t policy, const tx_queue_driver * const driver)
+{
+  const uint16_t queue_size = queue->mask + 1;
+  tx_queue_span span;
+
+  while(policy == TX_QUEUE_BLOCK && size > queue_size)
+  {
+    txQueueReserveRecord(queue, queue_size, &span, policy, driver);
+    txQueueSpanWrite(&span, data, queue_size);
+    txQueueCommitRecord(queue, queue_size, driver);
+    data += queue_size;
+    size -= queue_size;
+  }
+  if(size && txQueueReserveRecord(queue, size, &span, policy, driver))
+  {
+    txQueueSpanWrite(&span, data, size);
+    txQueueCommitRecord(queue, size, driver);
+  }
+}
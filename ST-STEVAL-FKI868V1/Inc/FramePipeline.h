@@ -0,0 +1,24 @@
+#ifndef __FRAME_PIPELINE_H
+#define __FRAME_PIPELINE_H
+
+#include <stdint.h>
+
+#include "FrameRing.h"
+
+/* The frames received by the radio interrupt, for the main loop */
+extern frame_ring rxFrameRing;
+
+/**
+  * @brief  Whether a frame starts like the ones of IZAR meters: L-field 0x19,
+  *         C-field 0x44, manufacturer SAP. Cheap enough for the interrupt.
+  * @param  uint8_t *frame The frame, 4 bytes at least.
+  * @retval uint8_t
+  */
+static inline uint8_t isIZARFramePrefix(const uint8_t * const frame) {
+    return frame[0] == 0x19 && frame[1] == 0x44 && frame[2] == 0x30 && frame[3] == 0x4C;
+}
+
+void handleReceivedFrame(const uint8_t * const frame, const uint8_t len);
+uint16_t processPendingFrames(frame_ring * const ring);
+
+#endif
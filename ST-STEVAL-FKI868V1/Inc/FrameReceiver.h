@@ -0,0 +1,72 @@
+#ifndef __FRAME_RECEIVER_H
+#define __FRAME_RECEIVER_H
+
+#include <stdint.h>
+
+#include "FrameRing.h"
+
+/*
+ * Reception of a frame without waiting for the SPI: the radio interrupt
+ * starts the DMA read of the IRQ status of the S2-LP and returns, and each
+ * transfer completion starts the next step: the number of bytes in the RX
+ * FIFO, the FIFO into a slot of the ring, until the radio is back in RX.
+ * Nothing waits on a transfer, so the CPU is free while they run.
+ *
+ * The transfers go through S2LPSpiRaw(), which the completion interrupt of
+ * the SPI DMA ends by calling SdkEvalSpiRawTC(): the application forwards
+ * that to frameReceiverOnTransferComplete(). The radio interrupt must not
+ * preempt the SPI DMA one: an IRQ that comes while the receiver is busy is
+ * left for it to handle once the radio is back in RX.
+ */
+
+/** The transfer in progress */
+typedef enum {
+    FRAME_RECEIVER_IDLE = 0,
+    /* IRQ_STATUS3 to IRQ_STATUS0, which clears them */
+    FRAME_RECEIVER_READING_IRQ_STATUS,
+    /* RX_FIFO_STATUS, the number of bytes in the FIFO */
+    FRAME_RECEIVER_READING_FIFO_LENGTH,
+    /* Status bytes and FIFO into the slot */
+    FRAME_RECEIVER_READING_FIFO,
+    /* FLUSHRXFIFO command */
+    FRAME_RECEIVER_FLUSHING_FIFO,
+    /* SMPS frequency for RX, as S2LPCmdStrobeRx() sets it */
+    FRAME_RECEIVER_SETTING_SMPS,
+    /* RX command */
+    FRAME_RECEIVER_STARTING_RX
+} frame_receiver_state;
+
+typedef struct _frame_receiver {
+    frame_ring *ring;
+    volatile frame_receiver_state state;
+    /* Set when an IRQ came while busy */
+    volatile uint8_t irq_pending;
+    /* The SPI status bytes then the registers read */
+    uint8_t registers[2 + 4];
+    /* The frame being read, and where to, NULL if it's not kept */
+    uint8_t length;
+    uint8_t *data;
+    /* What is sent during the FIFO read: the header, then don't care bytes */
+    uint8_t fifo_header[FRAME_RING_PREFIX_SIZE + FRAME_RING_SLOT_SIZE];
+    /* Frames read from the FIFO, and the ones handed to the ring */
+    volatile uint32_t frames_read;
+    volatile uint32_t frames_kept;
+} frame_receiver;
+
+/* The receiver of rxFrameRing */
+extern frame_receiver rxFrameReceiver;
+
+/**
+  * @brief  Whether the receiver is using the SPI.
+  * @param  frame_receiver *receiver The receiver.
+  * @retval uint8_t
+  */
+static inline uint8_t frameReceiverBusy(const frame_receiver * const receiver) {
+    return receiver->state != FRAME_RECEIVER_IDLE;
+}
+
+void frameReceiverInit(frame_receiver * const receiver, frame_ring * const ring);
+uint8_t frameReceiverOnIrq(frame_receiver * const receiver);
+uint8_t frameReceiverOnTransferComplete(frame_receiver * const receiver);
+
+#endif
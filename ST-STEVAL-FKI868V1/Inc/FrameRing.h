@@ -0,0 +1,64 @@
+#ifndef __FRAME_RING_H
+#define __FRAME_RING_H
+
+#include <stdint.h>
+
+/*
+ * Single producer, single consumer ring of received frames: the radio
+ * interrupt fills the slots, the main loop empties them. Each side only
+ * writes its own counter, so no lock is needed, only barriers so that a slot
+ * is complete before the other side sees it.
+ */
+
+/* Number of slots, a power of two */
+#ifndef FRAME_RING_SLOTS
+#if defined(__arm__) || defined(__ICCARM__)
+#define FRAME_RING_SLOTS 8
+#else
+#define FRAME_RING_SLOTS 64
+#endif
+#endif
+
+/* Longest frame a slot can hold */
+#ifndef FRAME_RING_SLOT_SIZE
+#define FRAME_RING_SLOT_SIZE 64
+#endif
+
+#if defined(__ICCARM__)
+#include <intrinsics.h>
+#define FRAME_RING_BARRIER() __DMB()
+#else
+#define FRAME_RING_BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+/* Bytes in front of the data of a slot, for the 2 status bytes the S2-LP
+   sends before its FIFO, so that the FIFO is read in place */
+#define FRAME_RING_PREFIX_SIZE 2
+
+/** A received frame */
+typedef struct _frame_ring_slot {
+    uint8_t length;
+    uint8_t prefix[FRAME_RING_PREFIX_SIZE];
+    uint8_t data[FRAME_RING_SLOT_SIZE];
+} frame_ring_slot;
+
+/** The ring, and what it had to drop */
+typedef struct _frame_ring {
+    frame_ring_slot slots[FRAME_RING_SLOTS];
+    /* Frames committed, only written by the producer */
+    volatile uint32_t head;
+    /* Frames released, only written by the consumer */
+    volatile uint32_t tail;
+    /* Frames dropped because the ring was full, or because they were too long
+       for a slot, only written by the producer */
+    volatile uint32_t dropped_full;
+    volatile uint32_t dropped_oversize;
+} frame_ring;
+
+void frameRingInit(frame_ring * const ring);
+uint8_t *frameRingReserve(frame_ring * const ring, const uint8_t length);
+void frameRingCommit(frame_ring * const ring, const uint8_t length);
+const frame_ring_slot *frameRingPeek(frame_ring * const ring);
+void frameRingRelease(frame_ring * const ring);
+
+#endif
@@ -4,6 +4,100 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/* Length of the encrypted payload of a PRIOS frame, check byte included */
+#define PRIOS_PAYLOAD_LEN 11
+
+/*
+ * Cache of the keystreams of the last meters heard, for
+ * decodePRIOSPayloadCached(). It has PRIOS_KEYSTREAM_CACHE_SETS sets (a power
+ * of two) of PRIOS_KEYSTREAM_CACHE_WAYS entries each, 16 bytes per entry.
+ * 0 sets disables it.
+ */
+#ifndef PRIOS_KEYSTREAM_CACHE_SETS
+#if defined(__arm__) || defined(__ICCARM__)
+#define PRIOS_KEYSTREAM_CACHE_SETS 1
+#else
+#define PRIOS_KEYSTREAM_CACHE_SETS 256
+#endif
+#endif
+
+#ifndef PRIOS_KEYSTREAM_CACHE_WAYS
+#define PRIOS_KEYSTREAM_CACHE_WAYS 4
+#endif
+
+/*
+ * The readings are kept as the raw counters of the meter and a decimal
+ * exponent, and printed with integer arithmetic only. Set
+ * PRIOS_FLOAT_READINGS to 1 to also get them as floats, as before, at the
+ * cost of soft-float and libm on the Cortex-M0; the CSV output is then the
+ * former one too.
+ */
+#ifndef PRIOS_FLOAT_READINGS
+#define PRIOS_FLOAT_READINGS 0
+#endif
+
+/* Longest line formatIZARReadingAsCSV() writes, with some margin */
+#define PRIOS_CSV_LINE_MAX 128
+
+/*
+ * Binary output mode: instead of a CSV line, each reading is sent as a
+ * PRIOS_RECORD_LEN byte record, COBS encoded and followed by a 0x00 delimiter.
+ * The record, little-endian:
+ *   0  A_Id                          u32
+ *   4  current_reading_raw           u32
+ *   8  h0_reading_raw                u32
+ *   12 h0_day                        bits 0-4
+ *      h0_month                      bits 5-8
+ *      h0_year - 1900                bits 9-16
+ *      remaining_battery_half_years  bits 17-21
+ *      random_generator              bits 22-23
+ *      reading_exponent + 6          bits 24-26
+ *      unit_type                     bits 27-31
+ *   16 radio_interval                u8
+ *   17 the alarms, in the CSV order  bits 0-11 of a u16
+ *   19 the WMBus CRC of bytes 0-18, big-endian
+ */
+#ifndef PRIOS_OUTPUT_BINARY
+#define PRIOS_OUTPUT_BINARY 0
+#endif
+#define PRIOS_RECORD_LEN 21
+/* COBS adds a byte every 254 and the delimiter */
+#define PRIOS_FRAMED_RECORD_MAX (PRIOS_RECORD_LEN + 2)
+
+/*
+ * Report of what the collector dropped, sent from time to time: the output
+ * the serial link couldn't keep up with, and the received frames the frame
+ * ring had no room or no slot long enough for. A
+ * "#dropped,<records>,<bytes>,<frames ring full>,<frames too long>" line in
+ * CSV mode, a PRIOS_DROP_REPORT_LEN byte record in binary mode, told apart
+ * from the readings by its length. The record, little-endian:
+ *   0  records dropped since the start  u32
+ *   4  their bytes                      u32
+ *   8  frames dropped, ring full        u32
+ *   12 frames dropped, too long         u32
+ *   16 the WMBus CRC of bytes 0-15, big-endian
+ */
+#define PRIOS_DROP_REPORT_LEN 18
+
+/*
+ * Cache of the default key that decodes each meter without an entry in the
+ * meter key table, for getMetricsFromPRIOSWMBusFrame(): a power of two
+ * entries of 8 bytes, 0 disables it.
+ */
+#ifndef PRIOS_KEY_FALLBACK_CACHE_SIZE
+#if defined(__arm__) || defined(__ICCARM__)
+#define PRIOS_KEY_FALLBACK_CACHE_SIZE 16
+#else
+#define PRIOS_KEY_FALLBACK_CACHE_SIZE 1024
+#endif
+#endif
+
+/** An entry of the meter key table: a meter id and its prepared key */
+typedef struct _prios_meter_key {
+    uint32_t A_Id;
+    uint32_t prepared_key;
+} prios_meter_key;
+
 /** Contains all the booleans required to store the alarms of a PRIOS device. */
 typedef struct _izar_alarms {
     bool general_alarm;
@@ -28,17 +122,55 @@ typedef struct _izar_reading {
     izar_alarms alarms;
     uint8_t random_generator;
     uint8_t radio_interval;
-    float remaining_battery_life;
+    /* Remaining battery life, in half years */
+    uint8_t remaining_battery_half_years;
     unit_type_t unit_type;
+    /* The readings are current_reading_raw * 10^reading_exponent units */
+    uint32_t current_reading_raw;
+    uint32_t h0_reading_raw;
+    int8_t reading_exponent;
+#if PRIOS_FLOAT_READINGS
+    float remaining_battery_life;
     float current_reading;
     float h0_reading;
+#endif
     uint16_t h0_year;
     uint8_t h0_month;
     uint8_t h0_day;
 } izar_reading;
 
+/** What the collector dropped since its start, as a drop report tells it */
+typedef struct _prios_drop_report {
+    /* Output records the serial link couldn't keep up with, and their bytes */
+    uint32_t records;
+    uint32_t bytes;
+    /* Received frames the frame ring was full for, or too long for its slots */
+    uint32_t frames_full;
+    uint32_t frames_oversize;
+} prios_drop_report;
+
+/** Hit and miss counters of the keystream cache */
+typedef struct _prios_keystream_cache_stats {
+    uint32_t hits;
+    uint32_t misses;
+} prios_keystream_cache_stats;
+
+void parsePRIOSFrame(const uint8_t * const header_data, const uint8_t * const decoded_data, izar_reading * const reading);
+uint8_t formatIZARReadingAsCSV(char * const buffer, const uint32_t A_Id, const izar_reading * const reading);
+uint8_t encodeIZARReadingAsRecord(uint8_t * const record, const uint32_t A_Id, const izar_reading * const reading);
+uint8_t decodeIZARRecord(const uint8_t * const record, uint32_t * const A_Id, izar_reading * const reading);
+uint8_t frameIZARReadingAsRecord(uint8_t * const buffer, const uint32_t A_Id, const izar_reading * const reading);
+void printIZARReadingAsRecord(const uint32_t A_Id, const izar_reading * const reading);
+void printIZARReading(const uint32_t A_Id, const izar_reading * const reading);
 void printIZARReadingAsCSV(const uint32_t A_Id, const izar_reading * const reading);
+uint8_t formatDropReportAsCSV(char * const buffer, const prios_drop_report * const report);
+uint8_t frameDropReportAsRecord(uint8_t * const buffer, const prios_drop_report * const report);
+uint8_t decodeDropReport(const uint8_t * const record, prios_drop_report * const report);
+void printDropReport(const prios_drop_report * const report);
 uint8_t decodePRIOSPayload(const uint8_t * const in, const uint8_t payload_len, const uint32_t key, uint8_t *out);
+uint8_t decodePRIOSPayloadCached(const uint8_t * const in, const uint8_t payload_len, const uint32_t key, uint8_t *out);
+void getPRIOSKeystreamCacheStats(prios_keystream_cache_stats * const stats);
+void clearPRIOSKeystreamCache(void);
 uint8_t getMetricsFromPRIOSWMBusFrame(const uint8_t * const frame, izar_reading * const reading);
 
 #endif
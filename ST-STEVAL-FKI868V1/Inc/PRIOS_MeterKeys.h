@@ -0,0 +1,24 @@
+/**
+  ******************************************************************************
+  * @file           : PRIOS_MeterKeys.h
+  * @brief          : The keys of the meters that don't use a default key
+  ******************************************************************************
+  * Generated by PC/meter_keys from a list of meter ids and keys: do not edit.
+  * Only included by PRIOS.c.
+  *
+  * The entries are sorted by meter id, and hold the keys already prepared by
+  * preparePRIOSKey(). The last one is a sentinel.
+  */
+
+#ifndef __PRIOS_METERKEYS_H
+#define __PRIOS_METERKEYS_H
+
+#include <stdint.h>
+
+#define PRIOS_METER_KEY_COUNT 0
+
+static const prios_meter_key PRIOS_METER_KEYS[PRIOS_METER_KEY_COUNT + 1] = {
+    {0xFFFFFFFF, 0x00000000}
+};
+
+#endif
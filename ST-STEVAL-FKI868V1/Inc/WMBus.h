@@ -1,6 +1,34 @@
 #ifndef __WMBUS_H
 #define __WMBUS_H
 
+#include <stdint.h>
+
+/* Implementations of the CRC, to select with WMBUS_CRC_IMPL at build time */
+#define WMBUS_CRC_BITWISE 0  /* Reference: one bit at a time, no table */
+#define WMBUS_CRC_NIBBLE  1  /* A nibble at a time: 32 bytes of tables */
+#define WMBUS_CRC_TABLE   2  /* A byte at a time: 512 bytes of tables */
+#define WMBUS_CRC_SLICE4  3  /* Slicing-by-4: 2 KiB of tables */
+#define WMBUS_CRC_SLICE8  4  /* Slicing-by-8: 4 KiB of tables */
+
+#ifndef WMBUS_CRC_IMPL
+#if defined(__arm__) || defined(__ICCARM__)
+#define WMBUS_CRC_IMPL WMBUS_CRC_NIBBLE
+#else
+#define WMBUS_CRC_IMPL WMBUS_CRC_SLICE8
+#endif
+#endif
+
+#if WMBUS_CRC_IMPL == WMBUS_CRC_SLICE8
+#define WMBUS_CRC_TABLE_COUNT 8
+#elif WMBUS_CRC_IMPL == WMBUS_CRC_SLICE4
+#define WMBUS_CRC_TABLE_COUNT 4
+#else
+#define WMBUS_CRC_TABLE_COUNT 1
+#endif
+
+uint16_t crcCalc(uint16_t crcReg, uint8_t crcData);
+uint16_t crcUpdate(uint16_t crcReg, const uint8_t *data, uint16_t len);
+
 uint8_t CheckWMBusFrame(const uint8_t * const frame, const uint8_t len, uint8_t * const LField, uint8_t * const CField, uint16_t * const Manufacturer, uint32_t * const A_Id, uint8_t * const A_Ver, uint8_t * const A_Type);
 
 #endif
\ No newline at end of file
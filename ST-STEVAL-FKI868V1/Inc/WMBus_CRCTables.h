@@ -0,0 +1,307 @@
+/**
+  ******************************************************************************
+  * @file           : WMBus_CRCTables.h
+  * @brief          : Lookup tables of the WMBus CRC-16 (polynomial 0x3D65)
+  ******************************************************************************
+  * Only included by WMBus.c, which defines WMBUS_CRC_IMPL first: only the
+  * tables of the selected implementation end up in flash.
+  *
+  * crcTable[k][v] is the CRC register after feeding the byte v followed by k
+  * zero bytes to a register at 0: crcTable[0] is the usual byte-at-a-time
+  * table, and the others let slicing-by-4/8 fold 4 or 8 bytes at once.
+  */
+
+#ifndef __WMBUS_CRCTABLES_H
+#define __WMBUS_CRCTABLES_H
+
+#include <stdint.h>
+
+#if WMBUS_CRC_IMPL == WMBUS_CRC_NIBBLE
+/** Register update for a 4-bit value: 32 bytes of flash. */
+static const uint16_t crcNibbleTable[16] = {
+    0x0000, 0x3D65, 0x7ACA, 0x47AF, 0xF594, 0xC8F1, 0x8F5E, 0xB23B,
+    0xD64D, 0xEB28, 0xAC87, 0x91E2, 0x23D9, 0x1EBC, 0x5913, 0x6476
+};
+#elif WMBUS_CRC_IMPL != WMBUS_CRC_BITWISE
+/** 512 bytes of flash per table. */
+static const uint16_t crcTable[WMBUS_CRC_TABLE_COUNT][256] = {
+    {
+        0x0000, 0x3D65, 0x7ACA, 0x47AF, 0xF594, 0xC8F1, 0x8F5E, 0xB23B,
+        0xD64D, 0xEB28, 0xAC87, 0x91E2, 0x23D9, 0x1EBC, 0x5913, 0x6476,
+        0x91FF, 0xAC9A, 0xEB35, 0xD650, 0x646B, 0x590E, 0x1EA1, 0x23C4,
+        0x47B2, 0x7AD7, 0x3D78, 0x001D, 0xB226, 0x8F43, 0xC8EC, 0xF589,
+        0x1E9B, 0x23FE, 0x6451, 0x5934, 0xEB0F, 0xD66A, 0x91C5, 0xACA0,
+        0xC8D6, 0xF5B3, 0xB21C, 0x8F79, 0x3D42, 0x0027, 0x4788, 0x7AED,
+        0x8F64, 0xB201, 0xF5AE, 0xC8CB, 0x7AF0, 0x4795, 0x003A, 0x3D5F,
+        0x5929, 0x644C, 0x23E3, 0x1E86, 0xACBD, 0x91D8, 0xD677, 0xEB12,
+        0x3D36, 0x0053, 0x47FC, 0x7A99, 0xC8A2, 0xF5C7, 0xB268, 0x8F0D,
+        0xEB7B, 0xD61E, 0x91B1, 0xACD4, 0x1EEF, 0x238A, 0x6425, 0x5940,
+        0xACC9, 0x91AC, 0xD603, 0xEB66, 0x595D, 0x6438, 0x2397, 0x1EF2,
+        0x7A84, 0x47E1, 0x004E, 0x3D2B, 0x8F10, 0xB275, 0xF5DA, 0xC8BF,
+        0x23AD, 0x1EC8, 0x5967, 0x6402, 0xD639, 0xEB5C, 0xACF3, 0x9196,
+        0xF5E0, 0xC885, 0x8F2A, 0xB24F, 0x0074, 0x3D11, 0x7ABE, 0x47DB,
+        0xB252, 0x8F37, 0xC898, 0xF5FD, 0x47C6, 0x7AA3, 0x3D0C, 0x0069,
+        0x641F, 0x597A, 0x1ED5, 0x23B0, 0x918B, 0xACEE, 0xEB41, 0xD624,
+        0x7A6C, 0x4709, 0x00A6, 0x3DC3, 0x8FF8, 0xB29D, 0xF532, 0xC857,
+        0xAC21, 0x9144, 0xD6EB, 0xEB8E, 0x59B5, 0x64D0, 0x237F, 0x1E1A,
+        0xEB93, 0xD6F6, 0x9159, 0xAC3C, 0x1E07, 0x2362, 0x64CD, 0x59A8,
+        0x3DDE, 0x00BB, 0x4714, 0x7A71, 0xC84A, 0xF52F, 0xB280, 0x8FE5,
+        0x64F7, 0x5992, 0x1E3D, 0x2358, 0x9163, 0xAC06, 0xEBA9, 0xD6CC,
+        0xB2BA, 0x8FDF, 0xC870, 0xF515, 0x472E, 0x7A4B, 0x3DE4, 0x0081,
+        0xF508, 0xC86D, 0x8FC2, 0xB2A7, 0x009C, 0x3DF9, 0x7A56, 0x4733,
+        0x2345, 0x1E20, 0x598F, 0x64EA, 0xD6D1, 0xEBB4, 0xAC1B, 0x917E,
+        0x475A, 0x7A3F, 0x3D90, 0x00F5, 0xB2CE, 0x8FAB, 0xC804, 0xF561,
+        0x9117, 0xAC72, 0xEBDD, 0xD6B8, 0x6483, 0x59E6, 0x1E49, 0x232C,
+        0xD6A5, 0xEBC0, 0xAC6F, 0x910A, 0x2331, 0x1E54, 0x59FB, 0x649E,
+        0x00E8, 0x3D8D, 0x7A22, 0x4747, 0xF57C, 0xC819, 0x8FB6, 0xB2D3,
+        0x59C1, 0x64A4, 0x230B, 0x1E6E, 0xAC55, 0x9130, 0xD69F, 0xEBFA,
+        0x8F8C, 0xB2E9, 0xF546, 0xC823, 0x7A18, 0x477D, 0x00D2, 0x3DB7,
+        0xC83E, 0xF55B, 0xB2F4, 0x8F91, 0x3DAA, 0x00CF, 0x4760, 0x7A05,
+        0x1E73, 0x2316, 0x64B9, 0x59DC, 0xEBE7, 0xD682, 0x912D, 0xAC48
+    }
+#if WMBUS_CRC_TABLE_COUNT >= 4
+    , {
+        0x0000, 0xF4D8, 0xD4D5, 0x200D, 0x94CF, 0x6017, 0x401A, 0xB4C2,
+        0x14FB, 0xE023, 0xC02E, 0x34F6, 0x8034, 0x74EC, 0x54E1, 0xA039,
+        0x29F6, 0xDD2E, 0xFD23, 0x09FB, 0xBD39, 0x49E1, 0x69EC, 0x9D34,
+        0x3D0D, 0xC9D5, 0xE9D8, 0x1D00, 0xA9C2, 0x5D1A, 0x7D17, 0x89CF,
+        0x53EC, 0xA734, 0x8739, 0x73E1, 0xC723, 0x33FB, 0x13F6, 0xE72E,
+        0x4717, 0xB3CF, 0x93C2, 0x671A, 0xD3D8, 0x2700, 0x070D, 0xF3D5,
+        0x7A1A, 0x8EC2, 0xAECF, 0x5A17, 0xEED5, 0x1A0D, 0x3A00, 0xCED8,
+        0x6EE1, 0x9A39, 0xBA34, 0x4EEC, 0xFA2E, 0x0EF6, 0x2EFB, 0xDA23,
+        0xA7D8, 0x5300, 0x730D, 0x87D5, 0x3317, 0xC7CF, 0xE7C2, 0x131A,
+        0xB323, 0x47FB, 0x67F6, 0x932E, 0x27EC, 0xD334, 0xF339, 0x07E1,
+        0x8E2E, 0x7AF6, 0x5AFB, 0xAE23, 0x1AE1, 0xEE39, 0xCE34, 0x3AEC,
+        0x9AD5, 0x6E0D, 0x4E00, 0xBAD8, 0x0E1A, 0xFAC2, 0xDACF, 0x2E17,
+        0xF434, 0x00EC, 0x20E1, 0xD439, 0x60FB, 0x9423, 0xB42E, 0x40F6,
+        0xE0CF, 0x1417, 0x341A, 0xC0C2, 0x7400, 0x80D8, 0xA0D5, 0x540D,
+        0xDDC2, 0x291A, 0x0917, 0xFDCF, 0x490D, 0xBDD5, 0x9DD8, 0x6900,
+        0xC939, 0x3DE1, 0x1DEC, 0xE934, 0x5DF6, 0xA92E, 0x8923, 0x7DFB,
+        0x72D5, 0x860D, 0xA600, 0x52D8, 0xE61A, 0x12C2, 0x32CF, 0xC617,
+        0x662E, 0x92F6, 0xB2FB, 0x4623, 0xF2E1, 0x0639, 0x2634, 0xD2EC,
+        0x5B23, 0xAFFB, 0x8FF6, 0x7B2E, 0xCFEC, 0x3B34, 0x1B39, 0xEFE1,
+        0x4FD8, 0xBB00, 0x9B0D, 0x6FD5, 0xDB17, 0x2FCF, 0x0FC2, 0xFB1A,
+        0x2139, 0xD5E1, 0xF5EC, 0x0134, 0xB5F6, 0x412E, 0x6123, 0x95FB,
+        0x35C2, 0xC11A, 0xE117, 0x15CF, 0xA10D, 0x55D5, 0x75D8, 0x8100,
+        0x08CF, 0xFC17, 0xDC1A, 0x28C2, 0x9C00, 0x68D8, 0x48D5, 0xBC0D,
+        0x1C34, 0xE8EC, 0xC8E1, 0x3C39, 0x88FB, 0x7C23, 0x5C2E, 0xA8F6,
+        0xD50D, 0x21D5, 0x01D8, 0xF500, 0x41C2, 0xB51A, 0x9517, 0x61CF,
+        0xC1F6, 0x352E, 0x1523, 0xE1FB, 0x5539, 0xA1E1, 0x81EC, 0x7534,
+        0xFCFB, 0x0823, 0x282E, 0xDCF6, 0x6834, 0x9CEC, 0xBCE1, 0x4839,
+        0xE800, 0x1CD8, 0x3CD5, 0xC80D, 0x7CCF, 0x8817, 0xA81A, 0x5CC2,
+        0x86E1, 0x7239, 0x5234, 0xA6EC, 0x122E, 0xE6F6, 0xC6FB, 0x3223,
+        0x921A, 0x66C2, 0x46CF, 0xB217, 0x06D5, 0xF20D, 0xD200, 0x26D8,
+        0xAF17, 0x5BCF, 0x7BC2, 0x8F1A, 0x3BD8, 0xCF00, 0xEF0D, 0x1BD5,
+        0xBBEC, 0x4F34, 0x6F39, 0x9BE1, 0x2F23, 0xDBFB, 0xFBF6, 0x0F2E
+    },
+    {
+        0x0000, 0xE5AA, 0xF631, 0x139B, 0xD107, 0x34AD, 0x2736, 0xC29C,
+        0x9F6B, 0x7AC1, 0x695A, 0x8CF0, 0x4E6C, 0xABC6, 0xB85D, 0x5DF7,
+        0x03B3, 0xE619, 0xF582, 0x1028, 0xD2B4, 0x371E, 0x2485, 0xC12F,
+        0x9CD8, 0x7972, 0x6AE9, 0x8F43, 0x4DDF, 0xA875, 0xBBEE, 0x5E44,
+        0x0766, 0xE2CC, 0xF157, 0x14FD, 0xD661, 0x33CB, 0x2050, 0xC5FA,
+        0x980D, 0x7DA7, 0x6E3C, 0x8B96, 0x490A, 0xACA0, 0xBF3B, 0x5A91,
+        0x04D5, 0xE17F, 0xF2E4, 0x174E, 0xD5D2, 0x3078, 0x23E3, 0xC649,
+        0x9BBE, 0x7E14, 0x6D8F, 0x8825, 0x4AB9, 0xAF13, 0xBC88, 0x5922,
+        0x0ECC, 0xEB66, 0xF8FD, 0x1D57, 0xDFCB, 0x3A61, 0x29FA, 0xCC50,
+        0x91A7, 0x740D, 0x6796, 0x823C, 0x40A0, 0xA50A, 0xB691, 0x533B,
+        0x0D7F, 0xE8D5, 0xFB4E, 0x1EE4, 0xDC78, 0x39D2, 0x2A49, 0xCFE3,
+        0x9214, 0x77BE, 0x6425, 0x818F, 0x4313, 0xA6B9, 0xB522, 0x5088,
+        0x09AA, 0xEC00, 0xFF9B, 0x1A31, 0xD8AD, 0x3D07, 0x2E9C, 0xCB36,
+        0x96C1, 0x736B, 0x60F0, 0x855A, 0x47C6, 0xA26C, 0xB1F7, 0x545D,
+        0x0A19, 0xEFB3, 0xFC28, 0x1982, 0xDB1E, 0x3EB4, 0x2D2F, 0xC885,
+        0x9572, 0x70D8, 0x6343, 0x86E9, 0x4475, 0xA1DF, 0xB244, 0x57EE,
+        0x1D98, 0xF832, 0xEBA9, 0x0E03, 0xCC9F, 0x2935, 0x3AAE, 0xDF04,
+        0x82F3, 0x6759, 0x74C2, 0x9168, 0x53F4, 0xB65E, 0xA5C5, 0x406F,
+        0x1E2B, 0xFB81, 0xE81A, 0x0DB0, 0xCF2C, 0x2A86, 0x391D, 0xDCB7,
+        0x8140, 0x64EA, 0x7771, 0x92DB, 0x5047, 0xB5ED, 0xA676, 0x43DC,
+        0x1AFE, 0xFF54, 0xECCF, 0x0965, 0xCBF9, 0x2E53, 0x3DC8, 0xD862,
+        0x8595, 0x603F, 0x73A4, 0x960E, 0x5492, 0xB138, 0xA2A3, 0x4709,
+        0x194D, 0xFCE7, 0xEF7C, 0x0AD6, 0xC84A, 0x2DE0, 0x3E7B, 0xDBD1,
+        0x8626, 0x638C, 0x7017, 0x95BD, 0x5721, 0xB28B, 0xA110, 0x44BA,
+        0x1354, 0xF6FE, 0xE565, 0x00CF, 0xC253, 0x27F9, 0x3462, 0xD1C8,
+        0x8C3F, 0x6995, 0x7A0E, 0x9FA4, 0x5D38, 0xB892, 0xAB09, 0x4EA3,
+        0x10E7, 0xF54D, 0xE6D6, 0x037C, 0xC1E0, 0x244A, 0x37D1, 0xD27B,
+        0x8F8C, 0x6A26, 0x79BD, 0x9C17, 0x5E8B, 0xBB21, 0xA8BA, 0x4D10,
+        0x1432, 0xF198, 0xE203, 0x07A9, 0xC535, 0x209F, 0x3304, 0xD6AE,
+        0x8B59, 0x6EF3, 0x7D68, 0x98C2, 0x5A5E, 0xBFF4, 0xAC6F, 0x49C5,
+        0x1781, 0xF22B, 0xE1B0, 0x041A, 0xC686, 0x232C, 0x30B7, 0xD51D,
+        0x88EA, 0x6D40, 0x7EDB, 0x9B71, 0x59ED, 0xBC47, 0xAFDC, 0x4A76
+    },
+    {
+        0x0000, 0x3B30, 0x7660, 0x4D50, 0xECC0, 0xD7F0, 0x9AA0, 0xA190,
+        0xE4E5, 0xDFD5, 0x9285, 0xA9B5, 0x0825, 0x3315, 0x7E45, 0x4575,
+        0xF4AF, 0xCF9F, 0x82CF, 0xB9FF, 0x186F, 0x235F, 0x6E0F, 0x553F,
+        0x104A, 0x2B7A, 0x662A, 0x5D1A, 0xFC8A, 0xC7BA, 0x8AEA, 0xB1DA,
+        0xD43B, 0xEF0B, 0xA25B, 0x996B, 0x38FB, 0x03CB, 0x4E9B, 0x75AB,
+        0x30DE, 0x0BEE, 0x46BE, 0x7D8E, 0xDC1E, 0xE72E, 0xAA7E, 0x914E,
+        0x2094, 0x1BA4, 0x56F4, 0x6DC4, 0xCC54, 0xF764, 0xBA34, 0x8104,
+        0xC471, 0xFF41, 0xB211, 0x8921, 0x28B1, 0x1381, 0x5ED1, 0x65E1,
+        0x9513, 0xAE23, 0xE373, 0xD843, 0x79D3, 0x42E3, 0x0FB3, 0x3483,
+        0x71F6, 0x4AC6, 0x0796, 0x3CA6, 0x9D36, 0xA606, 0xEB56, 0xD066,
+        0x61BC, 0x5A8C, 0x17DC, 0x2CEC, 0x8D7C, 0xB64C, 0xFB1C, 0xC02C,
+        0x8559, 0xBE69, 0xF339, 0xC809, 0x6999, 0x52A9, 0x1FF9, 0x24C9,
+        0x4128, 0x7A18, 0x3748, 0x0C78, 0xADE8, 0x96D8, 0xDB88, 0xE0B8,
+        0xA5CD, 0x9EFD, 0xD3AD, 0xE89D, 0x490D, 0x723D, 0x3F6D, 0x045D,
+        0xB587, 0x8EB7, 0xC3E7, 0xF8D7, 0x5947, 0x6277, 0x2F27, 0x1417,
+        0x5162, 0x6A52, 0x2702, 0x1C32, 0xBDA2, 0x8692, 0xCBC2, 0xF0F2,
+        0x1743, 0x2C73, 0x6123, 0x5A13, 0xFB83, 0xC0B3, 0x8DE3, 0xB6D3,
+        0xF3A6, 0xC896, 0x85C6, 0xBEF6, 0x1F66, 0x2456, 0x6906, 0x5236,
+        0xE3EC, 0xD8DC, 0x958C, 0xAEBC, 0x0F2C, 0x341C, 0x794C, 0x427C,
+        0x0709, 0x3C39, 0x7169, 0x4A59, 0xEBC9, 0xD0F9, 0x9DA9, 0xA699,
+        0xC378, 0xF848, 0xB518, 0x8E28, 0x2FB8, 0x1488, 0x59D8, 0x62E8,
+        0x279D, 0x1CAD, 0x51FD, 0x6ACD, 0xCB5D, 0xF06D, 0xBD3D, 0x860D,
+        0x37D7, 0x0CE7, 0x41B7, 0x7A87, 0xDB17, 0xE027, 0xAD77, 0x9647,
+        0xD332, 0xE802, 0xA552, 0x9E62, 0x3FF2, 0x04C2, 0x4992, 0x72A2,
+        0x8250, 0xB960, 0xF430, 0xCF00, 0x6E90, 0x55A0, 0x18F0, 0x23C0,
+        0x66B5, 0x5D85, 0x10D5, 0x2BE5, 0x8A75, 0xB145, 0xFC15, 0xC725,
+        0x76FF, 0x4DCF, 0x009F, 0x3BAF, 0x9A3F, 0xA10F, 0xEC5F, 0xD76F,
+        0x921A, 0xA92A, 0xE47A, 0xDF4A, 0x7EDA, 0x45EA, 0x08BA, 0x338A,
+        0x566B, 0x6D5B, 0x200B, 0x1B3B, 0xBAAB, 0x819B, 0xCCCB, 0xF7FB,
+        0xB28E, 0x89BE, 0xC4EE, 0xFFDE, 0x5E4E, 0x657E, 0x282E, 0x131E,
+        0xA2C4, 0x99F4, 0xD4A4, 0xEF94, 0x4E04, 0x7534, 0x3864, 0x0354,
+        0x4621, 0x7D11, 0x3041, 0x0B71, 0xAAE1, 0x91D1, 0xDC81, 0xE7B1
+    }
+#endif
+#if WMBUS_CRC_TABLE_COUNT >= 8
+    , {
+        0x0000, 0x2E86, 0x5D0C, 0x738A, 0xBA18, 0x949E, 0xE714, 0xC992,
+        0x4955, 0x67D3, 0x1459, 0x3ADF, 0xF34D, 0xDDCB, 0xAE41, 0x80C7,
+        0x92AA, 0xBC2C, 0xCFA6, 0xE120, 0x28B2, 0x0634, 0x75BE, 0x5B38,
+        0xDBFF, 0xF579, 0x86F3, 0xA875, 0x61E7, 0x4F61, 0x3CEB, 0x126D,
+        0x1831, 0x36B7, 0x453D, 0x6BBB, 0xA229, 0x8CAF, 0xFF25, 0xD1A3,
+        0x5164, 0x7FE2, 0x0C68, 0x22EE, 0xEB7C, 0xC5FA, 0xB670, 0x98F6,
+        0x8A9B, 0xA41D, 0xD797, 0xF911, 0x3083, 0x1E05, 0x6D8F, 0x4309,
+        0xC3CE, 0xED48, 0x9EC2, 0xB044, 0x79D6, 0x5750, 0x24DA, 0x0A5C,
+        0x3062, 0x1EE4, 0x6D6E, 0x43E8, 0x8A7A, 0xA4FC, 0xD776, 0xF9F0,
+        0x7937, 0x57B1, 0x243B, 0x0ABD, 0xC32F, 0xEDA9, 0x9E23, 0xB0A5,
+        0xA2C8, 0x8C4E, 0xFFC4, 0xD142, 0x18D0, 0x3656, 0x45DC, 0x6B5A,
+        0xEB9D, 0xC51B, 0xB691, 0x9817, 0x5185, 0x7F03, 0x0C89, 0x220F,
+        0x2853, 0x06D5, 0x755F, 0x5BD9, 0x924B, 0xBCCD, 0xCF47, 0xE1C1,
+        0x6106, 0x4F80, 0x3C0A, 0x128C, 0xDB1E, 0xF598, 0x8612, 0xA894,
+        0xBAF9, 0x947F, 0xE7F5, 0xC973, 0x00E1, 0x2E67, 0x5DED, 0x736B,
+        0xF3AC, 0xDD2A, 0xAEA0, 0x8026, 0x49B4, 0x6732, 0x14B8, 0x3A3E,
+        0x60C4, 0x4E42, 0x3DC8, 0x134E, 0xDADC, 0xF45A, 0x87D0, 0xA956,
+        0x2991, 0x0717, 0x749D, 0x5A1B, 0x9389, 0xBD0F, 0xCE85, 0xE003,
+        0xF26E, 0xDCE8, 0xAF62, 0x81E4, 0x4876, 0x66F0, 0x157A, 0x3BFC,
+        0xBB3B, 0x95BD, 0xE637, 0xC8B1, 0x0123, 0x2FA5, 0x5C2F, 0x72A9,
+        0x78F5, 0x5673, 0x25F9, 0x0B7F, 0xC2ED, 0xEC6B, 0x9FE1, 0xB167,
+        0x31A0, 0x1F26, 0x6CAC, 0x422A, 0x8BB8, 0xA53E, 0xD6B4, 0xF832,
+        0xEA5F, 0xC4D9, 0xB753, 0x99D5, 0x5047, 0x7EC1, 0x0D4B, 0x23CD,
+        0xA30A, 0x8D8C, 0xFE06, 0xD080, 0x1912, 0x3794, 0x441E, 0x6A98,
+        0x50A6, 0x7E20, 0x0DAA, 0x232C, 0xEABE, 0xC438, 0xB7B2, 0x9934,
+        0x19F3, 0x3775, 0x44FF, 0x6A79, 0xA3EB, 0x8D6D, 0xFEE7, 0xD061,
+        0xC20C, 0xEC8A, 0x9F00, 0xB186, 0x7814, 0x5692, 0x2518, 0x0B9E,
+        0x8B59, 0xA5DF, 0xD655, 0xF8D3, 0x3141, 0x1FC7, 0x6C4D, 0x42CB,
+        0x4897, 0x6611, 0x159B, 0x3B1D, 0xF28F, 0xDC09, 0xAF83, 0x8105,
+        0x01C2, 0x2F44, 0x5CCE, 0x7248, 0xBBDA, 0x955C, 0xE6D6, 0xC850,
+        0xDA3D, 0xF4BB, 0x8731, 0xA9B7, 0x6025, 0x4EA3, 0x3D29, 0x13AF,
+        0x9368, 0xBDEE, 0xCE64, 0xE0E2, 0x2970, 0x07F6, 0x747C, 0x5AFA
+    },
+    {
+        0x0000, 0xC188, 0xBE75, 0x7FFD, 0x418F, 0x8007, 0xFFFA, 0x3E72,
+        0x831E, 0x4296, 0x3D6B, 0xFCE3, 0xC291, 0x0319, 0x7CE4, 0xBD6C,
+        0x3B59, 0xFAD1, 0x852C, 0x44A4, 0x7AD6, 0xBB5E, 0xC4A3, 0x052B,
+        0xB847, 0x79CF, 0x0632, 0xC7BA, 0xF9C8, 0x3840, 0x47BD, 0x8635,
+        0x76B2, 0xB73A, 0xC8C7, 0x094F, 0x373D, 0xF6B5, 0x8948, 0x48C0,
+        0xF5AC, 0x3424, 0x4BD9, 0x8A51, 0xB423, 0x75AB, 0x0A56, 0xCBDE,
+        0x4DEB, 0x8C63, 0xF39E, 0x3216, 0x0C64, 0xCDEC, 0xB211, 0x7399,
+        0xCEF5, 0x0F7D, 0x7080, 0xB108, 0x8F7A, 0x4EF2, 0x310F, 0xF087,
+        0xED64, 0x2CEC, 0x5311, 0x9299, 0xACEB, 0x6D63, 0x129E, 0xD316,
+        0x6E7A, 0xAFF2, 0xD00F, 0x1187, 0x2FF5, 0xEE7D, 0x9180, 0x5008,
+        0xD63D, 0x17B5, 0x6848, 0xA9C0, 0x97B2, 0x563A, 0x29C7, 0xE84F,
+        0x5523, 0x94AB, 0xEB56, 0x2ADE, 0x14AC, 0xD524, 0xAAD9, 0x6B51,
+        0x9BD6, 0x5A5E, 0x25A3, 0xE42B, 0xDA59, 0x1BD1, 0x642C, 0xA5A4,
+        0x18C8, 0xD940, 0xA6BD, 0x6735, 0x5947, 0x98CF, 0xE732, 0x26BA,
+        0xA08F, 0x6107, 0x1EFA, 0xDF72, 0xE100, 0x2088, 0x5F75, 0x9EFD,
+        0x2391, 0xE219, 0x9DE4, 0x5C6C, 0x621E, 0xA396, 0xDC6B, 0x1DE3,
+        0xE7AD, 0x2625, 0x59D8, 0x9850, 0xA622, 0x67AA, 0x1857, 0xD9DF,
+        0x64B3, 0xA53B, 0xDAC6, 0x1B4E, 0x253C, 0xE4B4, 0x9B49, 0x5AC1,
+        0xDCF4, 0x1D7C, 0x6281, 0xA309, 0x9D7B, 0x5CF3, 0x230E, 0xE286,
+        0x5FEA, 0x9E62, 0xE19F, 0x2017, 0x1E65, 0xDFED, 0xA010, 0x6198,
+        0x911F, 0x5097, 0x2F6A, 0xEEE2, 0xD090, 0x1118, 0x6EE5, 0xAF6D,
+        0x1201, 0xD389, 0xAC74, 0x6DFC, 0x538E, 0x9206, 0xEDFB, 0x2C73,
+        0xAA46, 0x6BCE, 0x1433, 0xD5BB, 0xEBC9, 0x2A41, 0x55BC, 0x9434,
+        0x2958, 0xE8D0, 0x972D, 0x56A5, 0x68D7, 0xA95F, 0xD6A2, 0x172A,
+        0x0AC9, 0xCB41, 0xB4BC, 0x7534, 0x4B46, 0x8ACE, 0xF533, 0x34BB,
+        0x89D7, 0x485F, 0x37A2, 0xF62A, 0xC858, 0x09D0, 0x762D, 0xB7A5,
+        0x3190, 0xF018, 0x8FE5, 0x4E6D, 0x701F, 0xB197, 0xCE6A, 0x0FE2,
+        0xB28E, 0x7306, 0x0CFB, 0xCD73, 0xF301, 0x3289, 0x4D74, 0x8CFC,
+        0x7C7B, 0xBDF3, 0xC20E, 0x0386, 0x3DF4, 0xFC7C, 0x8381, 0x4209,
+        0xFF65, 0x3EED, 0x4110, 0x8098, 0xBEEA, 0x7F62, 0x009F, 0xC117,
+        0x4722, 0x86AA, 0xF957, 0x38DF, 0x06AD, 0xC725, 0xB8D8, 0x7950,
+        0xC43C, 0x05B4, 0x7A49, 0xBBC1, 0x85B3, 0x443B, 0x3BC6, 0xFA4E
+    },
+    {
+        0x0000, 0xF23F, 0xD91B, 0x2B24, 0x8F53, 0x7D6C, 0x5648, 0xA477,
+        0x23C3, 0xD1FC, 0xFAD8, 0x08E7, 0xAC90, 0x5EAF, 0x758B, 0x87B4,
+        0x4786, 0xB5B9, 0x9E9D, 0x6CA2, 0xC8D5, 0x3AEA, 0x11CE, 0xE3F1,
+        0x6445, 0x967A, 0xBD5E, 0x4F61, 0xEB16, 0x1929, 0x320D, 0xC032,
+        0x8F0C, 0x7D33, 0x5617, 0xA428, 0x005F, 0xF260, 0xD944, 0x2B7B,
+        0xACCF, 0x5EF0, 0x75D4, 0x87EB, 0x239C, 0xD1A3, 0xFA87, 0x08B8,
+        0xC88A, 0x3AB5, 0x1191, 0xE3AE, 0x47D9, 0xB5E6, 0x9EC2, 0x6CFD,
+        0xEB49, 0x1976, 0x3252, 0xC06D, 0x641A, 0x9625, 0xBD01, 0x4F3E,
+        0x237D, 0xD142, 0xFA66, 0x0859, 0xAC2E, 0x5E11, 0x7535, 0x870A,
+        0x00BE, 0xF281, 0xD9A5, 0x2B9A, 0x8FED, 0x7DD2, 0x56F6, 0xA4C9,
+        0x64FB, 0x96C4, 0xBDE0, 0x4FDF, 0xEBA8, 0x1997, 0x32B3, 0xC08C,
+        0x4738, 0xB507, 0x9E23, 0x6C1C, 0xC86B, 0x3A54, 0x1170, 0xE34F,
+        0xAC71, 0x5E4E, 0x756A, 0x8755, 0x2322, 0xD11D, 0xFA39, 0x0806,
+        0x8FB2, 0x7D8D, 0x56A9, 0xA496, 0x00E1, 0xF2DE, 0xD9FA, 0x2BC5,
+        0xEBF7, 0x19C8, 0x32EC, 0xC0D3, 0x64A4, 0x969B, 0xBDBF, 0x4F80,
+        0xC834, 0x3A0B, 0x112F, 0xE310, 0x4767, 0xB558, 0x9E7C, 0x6C43,
+        0x46FA, 0xB4C5, 0x9FE1, 0x6DDE, 0xC9A9, 0x3B96, 0x10B2, 0xE28D,
+        0x6539, 0x9706, 0xBC22, 0x4E1D, 0xEA6A, 0x1855, 0x3371, 0xC14E,
+        0x017C, 0xF343, 0xD867, 0x2A58, 0x8E2F, 0x7C10, 0x5734, 0xA50B,
+        0x22BF, 0xD080, 0xFBA4, 0x099B, 0xADEC, 0x5FD3, 0x74F7, 0x86C8,
+        0xC9F6, 0x3BC9, 0x10ED, 0xE2D2, 0x46A5, 0xB49A, 0x9FBE, 0x6D81,
+        0xEA35, 0x180A, 0x332E, 0xC111, 0x6566, 0x9759, 0xBC7D, 0x4E42,
+        0x8E70, 0x7C4F, 0x576B, 0xA554, 0x0123, 0xF31C, 0xD838, 0x2A07,
+        0xADB3, 0x5F8C, 0x74A8, 0x8697, 0x22E0, 0xD0DF, 0xFBFB, 0x09C4,
+        0x6587, 0x97B8, 0xBC9C, 0x4EA3, 0xEAD4, 0x18EB, 0x33CF, 0xC1F0,
+        0x4644, 0xB47B, 0x9F5F, 0x6D60, 0xC917, 0x3B28, 0x100C, 0xE233,
+        0x2201, 0xD03E, 0xFB1A, 0x0925, 0xAD52, 0x5F6D, 0x7449, 0x8676,
+        0x01C2, 0xF3FD, 0xD8D9, 0x2AE6, 0x8E91, 0x7CAE, 0x578A, 0xA5B5,
+        0xEA8B, 0x18B4, 0x3390, 0xC1AF, 0x65D8, 0x97E7, 0xBCC3, 0x4EFC,
+        0xC948, 0x3B77, 0x1053, 0xE26C, 0x461B, 0xB424, 0x9F00, 0x6D3F,
+        0xAD0D, 0x5F32, 0x7416, 0x8629, 0x225E, 0xD061, 0xFB45, 0x097A,
+        0x8ECE, 0x7CF1, 0x57D5, 0xA5EA, 0x019D, 0xF3A2, 0xD886, 0x2AB9
+    },
+    {
+        0x0000, 0x8DF4, 0x268D, 0xAB79, 0x4D1A, 0xC0EE, 0x6B97, 0xE663,
+        0x9A34, 0x17C0, 0xBCB9, 0x314D, 0xD72E, 0x5ADA, 0xF1A3, 0x7C57,
+        0x090D, 0x84F9, 0x2F80, 0xA274, 0x4417, 0xC9E3, 0x629A, 0xEF6E,
+        0x9339, 0x1ECD, 0xB5B4, 0x3840, 0xDE23, 0x53D7, 0xF8AE, 0x755A,
+        0x121A, 0x9FEE, 0x3497, 0xB963, 0x5F00, 0xD2F4, 0x798D, 0xF479,
+        0x882E, 0x05DA, 0xAEA3, 0x2357, 0xC534, 0x48C0, 0xE3B9, 0x6E4D,
+        0x1B17, 0x96E3, 0x3D9A, 0xB06E, 0x560D, 0xDBF9, 0x7080, 0xFD74,
+        0x8123, 0x0CD7, 0xA7AE, 0x2A5A, 0xCC39, 0x41CD, 0xEAB4, 0x6740,
+        0x2434, 0xA9C0, 0x02B9, 0x8F4D, 0x692E, 0xE4DA, 0x4FA3, 0xC257,
+        0xBE00, 0x33F4, 0x988D, 0x1579, 0xF31A, 0x7EEE, 0xD597, 0x5863,
+        0x2D39, 0xA0CD, 0x0BB4, 0x8640, 0x6023, 0xEDD7, 0x46AE, 0xCB5A,
+        0xB70D, 0x3AF9, 0x9180, 0x1C74, 0xFA17, 0x77E3, 0xDC9A, 0x516E,
+        0x362E, 0xBBDA, 0x10A3, 0x9D57, 0x7B34, 0xF6C0, 0x5DB9, 0xD04D,
+        0xAC1A, 0x21EE, 0x8A97, 0x0763, 0xE100, 0x6CF4, 0xC78D, 0x4A79,
+        0x3F23, 0xB2D7, 0x19AE, 0x945A, 0x7239, 0xFFCD, 0x54B4, 0xD940,
+        0xA517, 0x28E3, 0x839A, 0x0E6E, 0xE80D, 0x65F9, 0xCE80, 0x4374,
+        0x4868, 0xC59C, 0x6EE5, 0xE311, 0x0572, 0x8886, 0x23FF, 0xAE0B,
+        0xD25C, 0x5FA8, 0xF4D1, 0x7925, 0x9F46, 0x12B2, 0xB9CB, 0x343F,
+        0x4165, 0xCC91, 0x67E8, 0xEA1C, 0x0C7F, 0x818B, 0x2AF2, 0xA706,
+        0xDB51, 0x56A5, 0xFDDC, 0x7028, 0x964B, 0x1BBF, 0xB0C6, 0x3D32,
+        0x5A72, 0xD786, 0x7CFF, 0xF10B, 0x1768, 0x9A9C, 0x31E5, 0xBC11,
+        0xC046, 0x4DB2, 0xE6CB, 0x6B3F, 0x8D5C, 0x00A8, 0xABD1, 0x2625,
+        0x537F, 0xDE8B, 0x75F2, 0xF806, 0x1E65, 0x9391, 0x38E8, 0xB51C,
+        0xC94B, 0x44BF, 0xEFC6, 0x6232, 0x8451, 0x09A5, 0xA2DC, 0x2F28,
+        0x6C5C, 0xE1A8, 0x4AD1, 0xC725, 0x2146, 0xACB2, 0x07CB, 0x8A3F,
+        0xF668, 0x7B9C, 0xD0E5, 0x5D11, 0xBB72, 0x3686, 0x9DFF, 0x100B,
+        0x6551, 0xE8A5, 0x43DC, 0xCE28, 0x284B, 0xA5BF, 0x0EC6, 0x8332,
+        0xFF65, 0x7291, 0xD9E8, 0x541C, 0xB27F, 0x3F8B, 0x94F2, 0x1906,
+        0x7E46, 0xF3B2, 0x58CB, 0xD53F, 0x335C, 0xBEA8, 0x15D1, 0x9825,
+        0xE472, 0x6986, 0xC2FF, 0x4F0B, 0xA968, 0x249C, 0x8FE5, 0x0211,
+        0x774B, 0xFABF, 0x51C6, 0xDC32, 0x3A51, 0xB7A5, 0x1CDC, 0x9128,
+        0xED7F, 0x608B, 0xCBF2, 0x4606, 0xA065, 0x2D91, 0x86E8, 0x0B1C
+    }
+#endif
+};
+#endif
+
+#endif
@@ -0,0 +1,73 @@
+/**
+  ******************************************************************************
+  * @file           : FramePipeline.c
+  * @brief          : Validation, decoding and output of the received frames,
+                      from the main loop.
+  * @author         : Erwan Martin <public@fzwte.net>
+  ******************************************************************************
+  */
+#include <stddef.h>
+
+#include "FramePipeline.h"
+#include "WMBus.h"
+#include "PRIOS.h"
+
+frame_ring rxFrameRing;
+
+/**
+  * @brief  Check a received frame, and output the reading it holds if it's
+  *         from an IZAR meter.
+  * @param  uint8_t *frame The frame.
+  * @param  uint8_t len Its length.
+  */
+void handleReceivedFrame(const uint8_t * const frame, const uint8_t len) {
+    if (len < 4 || !isIZARFramePrefix(frame)) {
+        /* Let's not waste time checking the whole frame or calculting CRCs if the 1st 4 bytes are not the ones we're looking for */
+        return;
+    }
+
+    /* Uncomment this for debugging purposes */
+    /*for (uint8_t i = 0; i<len; i++) {
+        printf("%.2X ", frame[i]);
+    }
+    printf("\r\n");*/
+
+    /* Let's see if we're dealing with a correct WMBus frame */
+    uint8_t LField;
+    uint8_t CField;
+    uint16_t MField;
+    uint32_t A_Id;
+    uint8_t A_Ver;
+    uint8_t A_Type;
+    uint8_t isMBusFrame = CheckWMBusFrame(frame, len, &LField, &CField, &MField, &A_Id, &A_Ver, &A_Type);
+    if (!isMBusFrame) {
+        return;
+    }
+
+    /* The frame is an IZAR meter reporting data, let's handle it */
+    if (LField == 0x19 && CField == 0x44 && MField == 0x4C30 && A_Ver == 0xD4 && A_Type == 0x01) {
+        izar_reading reading;
+        if (!getMetricsFromPRIOSWMBusFrame(frame, &reading)) {
+            return;
+        }
+
+        /* Output the data on the COM port */
+        printIZARReading(A_Id, &reading);
+    }
+}
+
+/**
+  * @brief  Handle all the frames waiting in a ring.
+  * @param  frame_ring *ring The ring.
+  * @retval uint16_t How many there were.
+  */
+uint16_t processPendingFrames(frame_ring * const ring) {
+    uint16_t count = 0;
+    const frame_ring_slot *slot;
+    while ((slot = frameRingPeek(ring)) != NULL) {
+        handleReceivedFrame(slot->data, slot->length);
+        frameRingRelease(ring);
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,168 @@
+/**
+  ******************************************************************************
+  * @file           : FrameReceiver.c
+  * @brief          : Completion driven reading of the RX FIFO of the S2-LP
+                      into the frame ring, and return to RX.
+  ******************************************************************************
+  */
+#include <stddef.h>
+#include <string.h>
+
+#include "FrameReceiver.h"
+#include "FramePipeline.h"
+#include "S2LP_CORE_SPI.h"
+
+/* SPI headers and values, from S2LP_CORE_SPI.c, S2LP_Commands.h, S2LP_Regs.h and S2LP_Gpio.h */
+#define SPI_READ_HEADER         0x01
+#define SPI_WRITE_HEADER        0x00
+#define SPI_COMMAND_HEADER      0x80
+#define LINEAR_FIFO_ADDRESS     0xFF
+#define IRQ_STATUS3_ADDRESS     0xFA
+#define RX_FIFO_STATUS_ADDRESS  0x90
+#define CMD_FLUSHRXFIFO         0x71
+#define CMD_RX                  0x61
+#define SMPS_REGISTER_ADDRESS   0x76
+#define SMPS_RX_VALUE           0x90
+/* In IRQ_STATUS0, the last register read */
+#define IRQ_RX_DATA_READY       0x01
+#define IRQ_RX_DATA_DISC        0x02
+
+/* The transfers other than the FIFO read, sent as they are */
+static uint8_t irqStatusRead[] = {SPI_READ_HEADER, IRQ_STATUS3_ADDRESS, 0, 0, 0, 0};
+static uint8_t rxFifoStatusRead[] = {SPI_READ_HEADER, RX_FIFO_STATUS_ADDRESS, 0};
+static uint8_t flushRxFifoCommand[] = {SPI_COMMAND_HEADER, CMD_FLUSHRXFIFO};
+static uint8_t smpsRxWrite[] = {SPI_WRITE_HEADER, SMPS_REGISTER_ADDRESS, SMPS_RX_VALUE};
+static uint8_t rxCommand[] = {SPI_COMMAND_HEADER, CMD_RX};
+
+frame_receiver rxFrameReceiver;
+
+/**
+  * @brief  Set up a receiver, idle.
+  * @param  frame_receiver *receiver The receiver.
+  * @param  frame_ring *ring Where it stores the frames.
+  */
+void frameReceiverInit(frame_receiver * const receiver, frame_ring * const ring) {
+    memset(receiver, 0, sizeof(*receiver));
+    receiver->ring = ring;
+    receiver->fifo_header[0] = SPI_READ_HEADER;
+    receiver->fifo_header[1] = LINEAR_FIFO_ADDRESS;
+}
+
+/**
+  * @brief  Start the transfer of a step, without waiting for it.
+  * @param  frame_receiver *receiver The receiver.
+  * @param  frame_receiver_state state The step.
+  */
+static void startStep(frame_receiver * const receiver, const frame_receiver_state state) {
+    receiver->state = state;
+    switch (state) {
+    case FRAME_RECEIVER_READING_IRQ_STATUS:
+        S2LPSpiRaw(sizeof(irqStatusRead), irqStatusRead, receiver->registers, 1);
+        break;
+    case FRAME_RECEIVER_READING_FIFO_LENGTH:
+        S2LPSpiRaw(sizeof(rxFifoStatusRead), rxFifoStatusRead, receiver->registers, 1);
+        break;
+    case FRAME_RECEIVER_READING_FIFO:
+        /* The SPI status bytes go into the prefix of the slot, the frame right after them */
+        S2LPSpiRaw(FRAME_RING_PREFIX_SIZE + receiver->length, receiver->fifo_header, receiver->data - FRAME_RING_PREFIX_SIZE, 1);
+        break;
+    case FRAME_RECEIVER_FLUSHING_FIFO:
+        S2LPSpiRaw(sizeof(flushRxFifoCommand), flushRxFifoCommand, NULL, 1);
+        break;
+    case FRAME_RECEIVER_SETTING_SMPS:
+        S2LPSpiRaw(sizeof(smpsRxWrite), smpsRxWrite, NULL, 1);
+        break;
+    case FRAME_RECEIVER_STARTING_RX:
+        S2LPSpiRaw(sizeof(rxCommand), rxCommand, NULL, 1);
+        break;
+    case FRAME_RECEIVER_IDLE:
+        break;
+    }
+}
+
+/**
+  * @brief  Handle an IRQ of the radio: read its IRQ status, then, for a frame
+  *         waiting in the RX FIFO, read it into the next free slot of the
+  *         ring, if any, flush the FIFO and put the radio back in RX. Called
+  *         by the radio interrupt, it returns as soon as the first transfer
+  *         is started.
+  * @param  frame_receiver *receiver The receiver.
+  * @retval uint8_t 1 if started, 0 if the receiver is still busy with the
+  *         previous IRQ: this one is handled once it's done.
+  */
+uint8_t frameReceiverOnIrq(frame_receiver * const receiver) {
+    /* Flagged first, so that a transfer completion in between can't miss it */
+    receiver->irq_pending = 1;
+    if (frameReceiverBusy(receiver)) {
+        return 0;
+    }
+    receiver->irq_pending = 0;
+    startStep(receiver, FRAME_RECEIVER_READING_IRQ_STATUS);
+    return 1;
+}
+
+/**
+  * @brief  The last step is done: handle the IRQ that came meanwhile, if
+  *         any, or be idle.
+  * @param  frame_receiver *receiver The receiver.
+  * @retval uint8_t 1 if idle, 0 otherwise.
+  */
+static uint8_t finish(frame_receiver * const receiver) {
+    if (receiver->irq_pending) {
+        receiver->irq_pending = 0;
+        startStep(receiver, FRAME_RECEIVER_READING_IRQ_STATUS);
+        return 0;
+    }
+    receiver->state = FRAME_RECEIVER_IDLE;
+    return 1;
+}
+
+/**
+  * @brief  End of the transfer in progress: start the next one. Called from
+  *         the completion interrupt of the SPI.
+  * @param  frame_receiver *receiver The receiver.
+  * @retval uint8_t 1 if the receiver is idle, 0 otherwise.
+  */
+uint8_t frameReceiverOnTransferComplete(frame_receiver * const receiver) {
+    switch (receiver->state) {
+    case FRAME_RECEIVER_READING_IRQ_STATUS:
+        if (receiver->registers[5] & IRQ_RX_DATA_READY) {
+            startStep(receiver, FRAME_RECEIVER_READING_FIFO_LENGTH);
+            return 0;
+        }
+        if (receiver->registers[5] & IRQ_RX_DATA_DISC) {
+            /* Ensure the radio will be ready for the next reception */
+            startStep(receiver, FRAME_RECEIVER_SETTING_SMPS);
+            return 0;
+        }
+        return finish(receiver);
+    case FRAME_RECEIVER_READING_FIFO_LENGTH:
+        receiver->length = receiver->registers[2];
+        receiver->data = frameRingReserve(receiver->ring, receiver->length);
+        /* Without a slot, there is nothing to read, only to get ready for the next frame */
+        startStep(receiver, receiver->data ? FRAME_RECEIVER_READING_FIFO : FRAME_RECEIVER_FLUSHING_FIFO);
+        return 0;
+    case FRAME_RECEIVER_READING_FIFO:
+        receiver->frames_read++;
+        /* Leave the rest to the main loop, for the frames that may be from IZAR meters */
+        if (receiver->length >= 4 && isIZARFramePrefix(receiver->data)) {
+            frameRingCommit(receiver->ring, receiver->length);
+            receiver->frames_kept++;
+        }
+        receiver->data = NULL;
+        startStep(receiver, FRAME_RECEIVER_FLUSHING_FIFO);
+        return 0;
+    case FRAME_RECEIVER_FLUSHING_FIFO:
+        startStep(receiver, FRAME_RECEIVER_SETTING_SMPS);
+        return 0;
+    case FRAME_RECEIVER_SETTING_SMPS:
+        startStep(receiver, FRAME_RECEIVER_STARTING_RX);
+        return 0;
+    case FRAME_RECEIVER_STARTING_RX:
+        return finish(receiver);
+    case FRAME_RECEIVER_IDLE:
+        break;
+    }
+    /* Not one of ours */
+    return 0;
+}
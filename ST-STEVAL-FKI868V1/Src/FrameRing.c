@@ -0,0 +1,88 @@
+/**
+  ******************************************************************************
+  * @file           : FrameRing.c
+  * @brief          : Lock-free ring of received frames, between the radio
+                      interrupt and the main loop.
+  ******************************************************************************
+  */
+#include <stddef.h>
+#include <string.h>
+
+#include "FrameRing.h"
+
+/* The prefix must be right in front of the data, for the in place reads */
+_Static_assert(offsetof(frame_ring_slot, data) == offsetof(frame_ring_slot, prefix) + FRAME_RING_PREFIX_SIZE, "padding between the prefix and the data of a slot");
+
+/**
+  * @brief  Empty a ring and reset its counters.
+  * @param  frame_ring *ring The ring.
+  */
+void frameRingInit(frame_ring * const ring) {
+    memset(ring, 0, sizeof(*ring));
+}
+
+/**
+  * @brief  Producer side: get the slot to store the next frame into. It only
+  *         becomes visible to the consumer with frameRingCommit(); until then,
+  *         the next reservation returns the same slot.
+  * @param  frame_ring *ring The ring.
+  * @param  uint8_t length The length of the frame.
+  * @retval uint8_t * Where to store the frame, or NULL if it was dropped
+  *         because the ring is full or it is too long. The
+  *         FRAME_RING_PREFIX_SIZE bytes in front of it can be written too.
+  */
+uint8_t *frameRingReserve(frame_ring * const ring, const uint8_t length) {
+    if (length > FRAME_RING_SLOT_SIZE) {
+        ring->dropped_oversize++;
+        return NULL;
+    }
+    const uint32_t head = ring->head;
+    if (head - ring->tail == FRAME_RING_SLOTS) {
+        ring->dropped_full++;
+        return NULL;
+    }
+    /* Don't touch the slot before the consumer is done with it */
+    FRAME_RING_BARRIER();
+    return ring->slots[head & (FRAME_RING_SLOTS - 1)].data;
+}
+
+/**
+  * @brief  Producer side: hand the frame stored in the reserved slot to the
+  *         consumer.
+  * @param  frame_ring *ring The ring.
+  * @param  uint8_t length The length of the frame.
+  */
+void frameRingCommit(frame_ring * const ring, const uint8_t length) {
+    const uint32_t head = ring->head;
+    ring->slots[head & (FRAME_RING_SLOTS - 1)].length = length;
+    /* The slot must be complete before the consumer sees it */
+    FRAME_RING_BARRIER();
+    ring->head = head + 1;
+}
+
+/**
+  * @brief  Consumer side: get the oldest frame of the ring, without removing
+  *         it.
+  * @param  frame_ring *ring The ring.
+  * @retval frame_ring_slot * The frame, or NULL if the ring is empty.
+  */
+const frame_ring_slot *frameRingPeek(frame_ring * const ring) {
+    const uint32_t tail = ring->tail;
+    if (ring->head == tail) {
+        return NULL;
+    }
+    /* Don't read the slot before the producer is done with it */
+    FRAME_RING_BARRIER();
+    return &ring->slots[tail & (FRAME_RING_SLOTS - 1)];
+}
+
+/**
+  * @brief  Consumer side: remove the oldest frame of the ring, once done
+  *         with it.
+  * @param  frame_ring *ring The ring.
+  */
+void frameRingRelease(frame_ring * const ring) {
+    /* The slot must be done with before the producer reuses it */
+    FRAME_RING_BARRIER();
+    ring->tail = ring->tail + 1;
+}
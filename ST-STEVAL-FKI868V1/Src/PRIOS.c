@@ -5,10 +5,19 @@
   * @author         : Erwan Martin <public@fzwte.net>
   ******************************************************************************
   */
-#include <math.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "PRIOS.h"
+#include "PRIOS_MeterKeys.h"
+#include "WMBus.h"
+#if defined(__arm__) || defined(__ICCARM__)
+#include "SDK_EVAL_Com.h"
+#endif
+
+#if PRIOS_FLOAT_READINGS
+#include <math.h>
+#endif
 
 const char * const unit_displays[] = {
     [UNKNOWN_UNIT] = "banana",
@@ -19,6 +28,16 @@ const char * const unit_displays[] = {
 uint8_t PRIOS_DEFAULT_KEY1[8] = {0x39, 0xBC, 0x8A, 0x10, 0xE6, 0x6D, 0x83, 0xF8};
 uint8_t PRIOS_DEFAULT_KEY2[8] = {0x51, 0x72, 0x89, 0x10, 0xE6, 0x6D, 0x83, 0xF8};
 
+/*
+ * The same keys, as preparePRIOSKey() prepares them, in the order to try them
+ * (make -C PC check compares them)
+ */
+const uint32_t PRIOS_DEFAULT_PREPARED_KEYS[2] = {
+    0x39BC8A10 ^ 0xE66D83F8,
+    0x51728910 ^ 0xE66D83F8,
+};
+#define PRIOS_DEFAULT_KEY_COUNT (sizeof(PRIOS_DEFAULT_PREPARED_KEYS) / sizeof(PRIOS_DEFAULT_PREPARED_KEYS[0]))
+
 /**
   * @brief  Extract a 32 bit unsigned integer encoded into a stream of data in 
   *         little-endian format.
@@ -62,6 +81,59 @@ uint32_t preparePRIOSKey(const uint8_t * const bytes) {
     return key;
 }
 
+/*
+ * The LFSR of decodePRIOSPayload() shifts in 8 bits per payload byte, each the
+ * XOR of bits 1, 2, 11 and 31 of the key. Numbering the 8 new bits from the
+ * MSB of the new byte (n = 7..0), the taps at bits 11 and 31 only ever reach
+ * old bits (n + 4 and n + 24), and the taps at bits 1 and 2 reach the previous
+ * two new bits, or bits 0..2 of the old key for the first three. So:
+ *   seed = (key >> 4) ^ (key >> 24) ^ (key << 5) ^ (key << 6), low 8 bits
+ * and the new byte is the solution of new[n] = seed[n] ^ new[n + 2] ^
+ * new[n + 3], which this table gives for every seed.
+ */
+static const uint8_t PRIOS_LFSR_BYTE_TABLE[256] = {
+    0x00, 0x01, 0x02, 0x03, 0x05, 0x04, 0x07, 0x06, 0x0B, 0x0A, 0x09, 0x08, 0x0E, 0x0F, 0x0C, 0x0D,
+    0x17, 0x16, 0x15, 0x14, 0x12, 0x13, 0x10, 0x11, 0x1C, 0x1D, 0x1E, 0x1F, 0x19, 0x18, 0x1B, 0x1A,
+    0x2E, 0x2F, 0x2C, 0x2D, 0x2B, 0x2A, 0x29, 0x28, 0x25, 0x24, 0x27, 0x26, 0x20, 0x21, 0x22, 0x23,
+    0x39, 0x38, 0x3B, 0x3A, 0x3C, 0x3D, 0x3E, 0x3F, 0x32, 0x33, 0x30, 0x31, 0x37, 0x36, 0x35, 0x34,
+    0x5C, 0x5D, 0x5E, 0x5F, 0x59, 0x58, 0x5B, 0x5A, 0x57, 0x56, 0x55, 0x54, 0x52, 0x53, 0x50, 0x51,
+    0x4B, 0x4A, 0x49, 0x48, 0x4E, 0x4F, 0x4C, 0x4D, 0x40, 0x41, 0x42, 0x43, 0x45, 0x44, 0x47, 0x46,
+    0x72, 0x73, 0x70, 0x71, 0x77, 0x76, 0x75, 0x74, 0x79, 0x78, 0x7B, 0x7A, 0x7C, 0x7D, 0x7E, 0x7F,
+    0x65, 0x64, 0x67, 0x66, 0x60, 0x61, 0x62, 0x63, 0x6E, 0x6F, 0x6C, 0x6D, 0x6B, 0x6A, 0x69, 0x68,
+    0xB9, 0xB8, 0xBB, 0xBA, 0xBC, 0xBD, 0xBE, 0xBF, 0xB2, 0xB3, 0xB0, 0xB1, 0xB7, 0xB6, 0xB5, 0xB4,
+    0xAE, 0xAF, 0xAC, 0xAD, 0xAB, 0xAA, 0xA9, 0xA8, 0xA5, 0xA4, 0xA7, 0xA6, 0xA0, 0xA1, 0xA2, 0xA3,
+    0x97, 0x96, 0x95, 0x94, 0x92, 0x93, 0x90, 0x91, 0x9C, 0x9D, 0x9E, 0x9F, 0x99, 0x98, 0x9B, 0x9A,
+    0x80, 0x81, 0x82, 0x83, 0x85, 0x84, 0x87, 0x86, 0x8B, 0x8A, 0x89, 0x88, 0x8E, 0x8F, 0x8C, 0x8D,
+    0xE5, 0xE4, 0xE7, 0xE6, 0xE0, 0xE1, 0xE2, 0xE3, 0xEE, 0xEF, 0xEC, 0xED, 0xEB, 0xEA, 0xE9, 0xE8,
+    0xF2, 0xF3, 0xF0, 0xF1, 0xF7, 0xF6, 0xF5, 0xF4, 0xF9, 0xF8, 0xFB, 0xFA, 0xFC, 0xFD, 0xFE, 0xFF,
+    0xCB, 0xCA, 0xC9, 0xC8, 0xCE, 0xCF, 0xCC, 0xCD, 0xC0, 0xC1, 0xC2, 0xC3, 0xC5, 0xC4, 0xC7, 0xC6,
+    0xDC, 0xDD, 0xDE, 0xDF, 0xD9, 0xD8, 0xDB, 0xDA, 0xD7, 0xD6, 0xD5, 0xD4, 0xD2, 0xD3, 0xD0, 0xD1,
+};
+
+/**
+  * @brief  Step the LFSR of a Prios key by 8 bits at once.
+  * @param  uint32_t key The current state of the LFSR.
+  * @retval uint32_t The state 8 steps later, with the new bits in its low byte.
+  */
+static inline uint32_t stepPRIOSKeyByte(const uint32_t key) {
+    uint8_t seed = (key >> 4) ^ (key >> 24) ^ (key << 5) ^ (key << 6);
+    return (key << 8) | PRIOS_LFSR_BYTE_TABLE[seed];
+}
+
+/**
+  * @brief  Modify the prepared key with the header values of a frame, to get
+  *         the initial state of the LFSR.
+  * @param  uint8_t *in The location of the WMBus frame
+  * @param  uint32_t key The prepared key
+  * @retval uint32_t
+  */
+static inline uint32_t seedPRIOSKey(const uint8_t * const in, uint32_t key) {
+    key ^= read_uint32_be(in, 2); // manufacturer + address[0-1]
+    key ^= read_uint32_be(in, 6); // address[2-3] + version + type
+    key ^= read_uint32_be(in, 12); // ci + some more bytes from the telegram...
+    return key;
+}
+
 /**
   * Decode a Prios payload with a key.
   * Original author: Jacek Tomasiak
@@ -77,20 +149,12 @@ uint32_t preparePRIOSKey(const uint8_t * const bytes) {
   * @retval uint8_t
   */
 uint8_t decodePRIOSPayload(const uint8_t * const in, const uint8_t payload_len, uint32_t key, uint8_t *out) {
-    // modify seed key with header values
-    key ^= read_uint32_be(in, 2); // manufacturer + address[0-1]
-    key ^= read_uint32_be(in, 6); // address[2-3] + version + type
-    key ^= read_uint32_be(in, 12); // ci + some more bytes from the telegram...
+    key = seedPRIOSKey(in, key);
 
     for (int i = 0; i < payload_len; ++i) {
-        // calculate new key (LFSR)
+        // calculate new key (LFSR), 8 bits at once
         // https://en.wikipedia.org/wiki/Linear-feedback_shift_register
-        for (int j = 0; j < 8; ++j) {
-            // calculate new bit value (xor of selected bits from previous key)
-            uint8_t bit = ((key & 0x2) != 0) ^ ((key & 0x4) != 0) ^ ((key & 0x800) != 0) ^ ((key & 0x80000000) != 0);
-            // shift key bits and add new one at the end
-            key = (key << 1) | bit;
-        }
+        key = stepPRIOSKeyByte(key);
         // decode i-th content byte with fresh/last 8-bits of key
         out[i] = in[i + 17] ^ (key & 0xFF);
         // check-byte doesn't match?
@@ -102,6 +166,99 @@ uint8_t decodePRIOSPayload(const uint8_t * const in, const uint8_t payload_len,
     return 1;
 }
 
+/*
+ * The keystream only depends on the seed of the LFSR, so the cache is indexed
+ * by it: a meter repeats its header words from frame to frame, and they only
+ * change with its access number. An entry is 16 bytes.
+ */
+typedef struct _prios_keystream_entry {
+    uint32_t seed;
+    uint8_t keystream[PRIOS_PAYLOAD_LEN];
+    uint8_t valid;
+} prios_keystream_entry;
+
+#if PRIOS_KEYSTREAM_CACHE_SETS > 0
+static prios_keystream_entry keystreamCache[PRIOS_KEYSTREAM_CACHE_SETS][PRIOS_KEYSTREAM_CACHE_WAYS];
+/* The way of each set to replace next */
+static uint8_t keystreamCacheNext[PRIOS_KEYSTREAM_CACHE_SETS];
+#endif
+static prios_keystream_cache_stats keystreamCacheStats;
+
+/**
+  * @brief  Decode a Prios payload with a key, like decodePRIOSPayload(), but
+  *         with the keystream from the cache when the same meter sent a frame
+  *         with the same header words before. Not reentrant.
+  * @param  uint8_t *in The location of the WMBus frame
+  * @param  uint8_t payload_len The length of the payload to decode
+  * @param  uint32_t key The key to use to decode
+  * @param  uint8_t *out Buffer to store the decoded data
+  * @retval uint8_t
+  */
+uint8_t decodePRIOSPayloadCached(const uint8_t * const in, const uint8_t payload_len, uint32_t key, uint8_t *out) {
+#if PRIOS_KEYSTREAM_CACHE_SETS > 0
+    if (payload_len == 0 || payload_len > PRIOS_PAYLOAD_LEN) {
+        return decodePRIOSPayload(in, payload_len, key, out);
+    }
+    const uint32_t seed = seedPRIOSKey(in, key);
+    const uint32_t set = ((seed * 2654435761u) >> 16) & (PRIOS_KEYSTREAM_CACHE_SETS - 1);
+    prios_keystream_entry *entries = keystreamCache[set];
+
+    /* Hit: the payload is just XORed with the keystream */
+    for (int way = 0; way < PRIOS_KEYSTREAM_CACHE_WAYS; ++way) {
+        if (entries[way].valid && entries[way].seed == seed) {
+            keystreamCacheStats.hits++;
+            for (int i = 0; i < payload_len; ++i) {
+                out[i] = in[i + 17] ^ entries[way].keystream[i];
+            }
+            return out[0] == 0x4B;
+        }
+    }
+
+    /* Miss: run the LFSR, and only keep the keystreams of the right keys */
+    keystreamCacheStats.misses++;
+    key = stepPRIOSKeyByte(seed);
+    out[0] = in[17] ^ (key & 0xFF);
+    if (out[0] != 0x4B) {
+        return 0;
+    }
+    prios_keystream_entry *entry = &entries[keystreamCacheNext[set]];
+    keystreamCacheNext[set] = (keystreamCacheNext[set] + 1) % PRIOS_KEYSTREAM_CACHE_WAYS;
+    entry->seed = seed;
+    entry->valid = 1;
+    entry->keystream[0] = key & 0xFF;
+    for (int i = 1; i < PRIOS_PAYLOAD_LEN; ++i) {
+        key = stepPRIOSKeyByte(key);
+        entry->keystream[i] = key & 0xFF;
+    }
+    for (int i = 1; i < payload_len; ++i) {
+        out[i] = in[i + 17] ^ entry->keystream[i];
+    }
+    return 1;
+#else
+    keystreamCacheStats.misses++;
+    return decodePRIOSPayload(in, payload_len, key, out);
+#endif
+}
+
+/**
+  * @brief  Get the hit and miss counters of the keystream cache.
+  * @param  prios_keystream_cache_stats *stats Where to store them.
+  */
+void getPRIOSKeystreamCacheStats(prios_keystream_cache_stats * const stats) {
+    *stats = keystreamCacheStats;
+}
+
+/**
+  * @brief  Empty the keystream cache and reset its counters.
+  */
+void clearPRIOSKeystreamCache(void) {
+#if PRIOS_KEYSTREAM_CACHE_SETS > 0
+    memset(keystreamCache, 0, sizeof(keystreamCache));
+    memset(keystreamCacheNext, 0, sizeof(keystreamCacheNext));
+#endif
+    memset(&keystreamCacheStats, 0, sizeof(keystreamCacheStats));
+}
+
 /**
  * @brief Extract the data from a PRIOS frame.
  * @param uint8_t *header_data The start of the wmbus frame application data.
@@ -114,7 +271,7 @@ void parsePRIOSFrame(const uint8_t * const header_data, const uint8_t * const de
     reading->random_generator = (header_data[0] >> 4) & 0x3;
 
     // Extract the battery remaining life:
-    reading->remaining_battery_life = (header_data[1] & 0x1F) / 2.0;
+    reading->remaining_battery_half_years = header_data[1] & 0x1F;
 
     // Read the alarms:
     reading->alarms.general_alarm = header_data[0] >> 7;
@@ -130,12 +287,16 @@ void parsePRIOSFrame(const uint8_t * const header_data, const uint8_t * const de
     reading->alarms.mechanical_fraud_currently = header_data[2] >> 1 & 0x1;
     reading->alarms.mechanical_fraud_previously = header_data[2] & 0x1;
 
-    // Read the readings:
-    reading->current_reading = read_uint32_le(decoded_data, 1);
-    reading->h0_reading = read_uint32_le(decoded_data, 5);
+    // Read the readings, and the multiplier of their values:
+    reading->current_reading_raw = read_uint32_le(decoded_data, 1);
+    reading->h0_reading_raw = read_uint32_le(decoded_data, 5);
+    reading->reading_exponent = (header_data[3] & 0x07) - 6;
 
-    // Apply the multiplier to the values:
-    int8_t multiplier_exponent = (header_data[3] & 0x07) - 6;
+#if PRIOS_FLOAT_READINGS
+    reading->remaining_battery_life = reading->remaining_battery_half_years / 2.0;
+    reading->current_reading = reading->current_reading_raw;
+    reading->h0_reading = reading->h0_reading_raw;
+    int8_t multiplier_exponent = reading->reading_exponent;
     if (multiplier_exponent > 0) {
         reading->current_reading *= pow(10, multiplier_exponent);
         reading->h0_reading *= pow(10, multiplier_exponent);
@@ -143,6 +304,7 @@ void parsePRIOSFrame(const uint8_t * const header_data, const uint8_t * const de
         reading->current_reading /= pow(10, -multiplier_exponent);
         reading->h0_reading /= pow(10, -multiplier_exponent);
     }
+#endif
 
     // Extract the measurement unit:
     uint8_t unit_type = header_data[3] >> 3;
@@ -163,13 +325,156 @@ void parsePRIOSFrame(const uint8_t * const header_data, const uint8_t * const de
     reading->h0_day = decoded_data[9] & 0x1F;
 }
 
+/* The powers of ten a reading can be divided by, and the 6 decimals printed */
+static const uint32_t POWERS_OF_TEN[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+/**
+ * @brief Append an unsigned integer in decimal, like "%.*u" would.
+ * @param char *p Where to write it.
+ * @param uint32_t value The value to write.
+ * @param uint8_t min_digits The number of digits to pad it to with zeros.
+ * @retval char * The end of what was written.
+ */
+static char *appendDecimal(char *p, uint32_t value, const uint8_t min_digits) {
+    char digits[10];
+    uint8_t count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    while (count < min_digits) {
+        digits[count++] = '0';
+    }
+    while (count) {
+        *p++ = digits[--count];
+    }
+    return p;
+}
+
+/**
+ * @brief Append an unsigned integer in lowercase hexadecimal, like "%.*x" would.
+ * @param char *p Where to write it.
+ * @param uint32_t value The value to write.
+ * @param uint8_t min_digits The number of digits to pad it to with zeros.
+ * @retval char * The end of what was written.
+ */
+static char *appendHex(char *p, uint32_t value, const uint8_t min_digits) {
+    uint8_t count = 8;
+    while (count > min_digits && !(value >> (4 * (count - 1)))) {
+        count--;
+    }
+    while (count) {
+        *p++ = "0123456789abcdef"[(value >> (4 * --count)) & 0xF];
+    }
+    return p;
+}
+
+/**
+ * @brief Append raw * 10^exponent with 6 decimals, like "%f" would print it
+ *        without rounding errors.
+ * @param char *p Where to write it.
+ * @param uint32_t raw The raw value.
+ * @param int8_t exponent Its decimal exponent, from -6 to 1.
+ * @retval char * The end of what was written.
+ */
+static char *appendReadingValue(char *p, const uint32_t raw, const int8_t exponent) {
+    if (exponent >= 0) {
+        p = appendDecimal(p, raw, 1);
+        for (int8_t i = 0; i < exponent; ++i) {
+            *p++ = '0';
+        }
+        *p++ = '.';
+        return appendDecimal(p, 0, 6);
+    }
+    const uint32_t divisor = POWERS_OF_TEN[-exponent];
+    p = appendDecimal(p, raw / divisor, 1);
+    *p++ = '.';
+    return appendDecimal(p, (raw % divisor) * POWERS_OF_TEN[6 + exponent], 6);
+}
+
+/**
+ * @brief Format an entire IZAR reading as a CSV line, without printf.
+ * @param char *buffer Where to store the line, PRIOS_CSV_LINE_MAX bytes at
+ *        least. It is not NUL terminated.
+ * @param uint32_t A_Id The identifier of the device the reading was from.
+ * @param izar_reading *reading The reading to format
+ * @retval uint8_t The length of the line, "\r\n" included.
+ */
+uint8_t formatIZARReadingAsCSV(char * const buffer, const uint32_t A_Id, const izar_reading * const reading) {
+    const bool flags[] = {
+        reading->alarms.general_alarm,
+        reading->alarms.leakage_currently,
+        reading->alarms.leakage_previously,
+        reading->alarms.meter_blocked,
+        reading->alarms.back_flow,
+        reading->alarms.underflow,
+        reading->alarms.overflow,
+        reading->alarms.submarine,
+        reading->alarms.sensor_fraud_currently,
+        reading->alarms.sensor_fraud_previously,
+        reading->alarms.mechanical_fraud_currently,
+        reading->alarms.mechanical_fraud_previously,
+    };
+    char *p = buffer;
+
+    p = appendHex(p, A_Id, 6);
+    *p++ = ',';
+    p = appendReadingValue(p, reading->current_reading_raw, reading->reading_exponent);
+    *p++ = ',';
+    p = appendReadingValue(p, reading->h0_reading_raw, reading->reading_exponent);
+    *p++ = ',';
+    for (const char *unit = unit_displays[reading->unit_type]; *unit; ++unit) {
+        *p++ = *unit;
+    }
+    *p++ = ',';
+    p = appendDecimal(p, reading->h0_year, 2);
+    *p++ = ',';
+    p = appendDecimal(p, reading->h0_month, 2);
+    *p++ = ',';
+    p = appendDecimal(p, reading->h0_day, 2);
+    *p++ = ',';
+    p = appendDecimal(p, reading->remaining_battery_half_years / 2, 1);
+    *p++ = '.';
+    *p++ = reading->remaining_battery_half_years % 2 ? '5' : '0';
+    *p++ = ',';
+    p = appendDecimal(p, reading->radio_interval, 1);
+    *p++ = ',';
+    p = appendDecimal(p, reading->random_generator, 1);
+    for (uint8_t i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i) {
+        *p++ = ',';
+        *p++ = flags[i] ? '1' : '0';
+    }
+    *p++ = '\r';
+    *p++ = '\n';
+    return p - buffer;
+}
+
+/**
+ * @brief Send bytes to the standard output device: the UART TX queue, as a
+ *        single record, sent whole or dropped, on the board.
+ * @param uint8_t *data The bytes to send.
+ * @param uint8_t len How many.
+ */
+static void writeOutput(const uint8_t * const data, const uint8_t len) {
+#if defined(__arm__) || defined(__ICCARM__)
+    enqueueTxChars(data, len);
+#else
+    fwrite(data, 1, len, stdout);
+#endif
+}
+
 /**
  * @brief Print an entire IZAR reading to the standard output device, as CSV data.
  * @param uint32_t A_Id The identifier of the device the reading was from.
  * @param izar_reading *reading The reading to print
  */
 void printIZARReadingAsCSV(const uint32_t A_Id, const izar_reading * const reading) {
-    printf(
+#if PRIOS_FLOAT_READINGS
+    /* Formatted whole, then sent as one record, as the integer lines are:
+       printf() would hand the line to the UART in pieces */
+    char line[PRIOS_CSV_LINE_MAX];
+    int len = snprintf(
+        line, sizeof(line),
         "%.6x,%f,%f,%s,%.2d,%.2d,%.2d,%.1f,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\r\n",
         A_Id,
         reading->current_reading,
@@ -194,18 +499,348 @@ void printIZARReadingAsCSV(const uint32_t A_Id, const izar_reading * const readi
         reading->alarms.mechanical_fraud_currently,
         reading->alarms.mechanical_fraud_previously
     );
+    if (len < 0 || len >= (int) sizeof(line)) {
+        return;
+    }
+    writeOutput((const uint8_t *) line, len);
+#else
+#if defined(__arm__) || defined(__ICCARM__)
+    /* Straight into the UART TX queue, if it has room for the longest line
+       before its end; otherwise, its overflow policy decides on the line */
+    tx_queue_span span;
+    if (tryReserveTxChars(PRIOS_CSV_LINE_MAX, &span) && span.first_length >= PRIOS_CSV_LINE_MAX) {
+        commitTxChars(formatIZARReadingAsCSV((char *) span.first, A_Id, reading));
+        return;
+    }
+#endif
+    char line[PRIOS_CSV_LINE_MAX];
+    uint8_t len = formatIZARReadingAsCSV(line, A_Id, reading);
+    writeOutput((const uint8_t *) line, len);
+#endif
+}
+
+/**
+ * @brief Store a 32 bit unsigned integer into a stream of data in
+ *        little-endian format.
+ * @param uint8_t *data Where to store it.
+ * @param uint32_t value The value to store.
+ */
+static void write_uint32_le(uint8_t * const data, const uint32_t value) {
+    data[0] = value;
+    data[1] = value >> 8;
+    data[2] = value >> 16;
+    data[3] = value >> 24;
+}
+
+/**
+ * @brief Encode an entire IZAR reading as a binary record (see PRIOS.h).
+ * @param uint8_t *record Where to store it, PRIOS_RECORD_LEN bytes.
+ * @param uint32_t A_Id The identifier of the device the reading was from.
+ * @param izar_reading *reading The reading to encode
+ * @retval uint8_t The length of the record.
+ */
+uint8_t encodeIZARReadingAsRecord(uint8_t * const record, const uint32_t A_Id, const izar_reading * const reading) {
+    const bool flags[] = {
+        reading->alarms.general_alarm,
+        reading->alarms.leakage_currently,
+        reading->alarms.leakage_previously,
+        reading->alarms.meter_blocked,
+        reading->alarms.back_flow,
+        reading->alarms.underflow,
+        reading->alarms.overflow,
+        reading->alarms.submarine,
+        reading->alarms.sensor_fraud_currently,
+        reading->alarms.sensor_fraud_previously,
+        reading->alarms.mechanical_fraud_currently,
+        reading->alarms.mechanical_fraud_previously,
+    };
+    uint16_t alarms = 0;
+    for (uint8_t i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i) {
+        alarms |= flags[i] << i;
+    }
+    uint32_t packed = (reading->h0_day & 0x1F)
+        | (uint32_t) (reading->h0_month & 0xF) << 5
+        | (uint32_t) ((reading->h0_year - 1900) & 0xFF) << 9
+        | (uint32_t) (reading->remaining_battery_half_years & 0x1F) << 17
+        | (uint32_t) (reading->random_generator & 0x3) << 22
+        | (uint32_t) ((reading->reading_exponent + 6) & 0x7) << 24
+        | (uint32_t) (reading->unit_type & 0x1F) << 27;
+
+    write_uint32_le(record, A_Id);
+    write_uint32_le(record + 4, reading->current_reading_raw);
+    write_uint32_le(record + 8, reading->h0_reading_raw);
+    write_uint32_le(record + 12, packed);
+    record[16] = reading->radio_interval;
+    record[17] = alarms;
+    record[18] = alarms >> 8;
+    uint16_t crc = ~crcUpdate(0, record, PRIOS_RECORD_LEN - 2);
+    record[19] = crc >> 8;
+    record[20] = crc;
+    return PRIOS_RECORD_LEN;
 }
 
+/**
+ * @brief Decode a binary record (see PRIOS.h), the reverse of
+ *        encodeIZARReadingAsRecord().
+ * @param uint8_t *record The record, PRIOS_RECORD_LEN bytes.
+ * @param uint32_t *A_Id Where to store the identifier of the device.
+ * @param izar_reading *reading Where to store the reading.
+ * @retval uint8_t 0 if the CRC of the record is wrong, 1 otherwise.
+ */
+uint8_t decodeIZARRecord(const uint8_t * const record, uint32_t * const A_Id, izar_reading * const reading) {
+    uint16_t crc = ~crcUpdate(0, record, PRIOS_RECORD_LEN - 2);
+    if (record[19] != (uint8_t) (crc >> 8) || record[20] != (uint8_t) crc) {
+        return 0;
+    }
+    uint32_t packed = read_uint32_le(record, 12);
+    uint16_t alarms = record[17] | record[18] << 8;
+
+    *A_Id = read_uint32_le(record, 0);
+    reading->current_reading_raw = read_uint32_le(record, 4);
+    reading->h0_reading_raw = read_uint32_le(record, 8);
+    reading->h0_day = packed & 0x1F;
+    reading->h0_month = (packed >> 5) & 0xF;
+    reading->h0_year = 1900 + ((packed >> 9) & 0xFF);
+    reading->remaining_battery_half_years = (packed >> 17) & 0x1F;
+    reading->random_generator = (packed >> 22) & 0x3;
+    reading->reading_exponent = (int8_t) ((packed >> 24) & 0x7) - 6;
+    reading->unit_type = (packed >> 27) == VOLUME_CUBIC_METER ? VOLUME_CUBIC_METER : UNKNOWN_UNIT;
+    reading->radio_interval = record[16];
+    reading->alarms.general_alarm = alarms & 0x1;
+    reading->alarms.leakage_currently = alarms >> 1 & 0x1;
+    reading->alarms.leakage_previously = alarms >> 2 & 0x1;
+    reading->alarms.meter_blocked = alarms >> 3 & 0x1;
+    reading->alarms.back_flow = alarms >> 4 & 0x1;
+    reading->alarms.underflow = alarms >> 5 & 0x1;
+    reading->alarms.overflow = alarms >> 6 & 0x1;
+    reading->alarms.submarine = alarms >> 7 & 0x1;
+    reading->alarms.sensor_fraud_currently = alarms >> 8 & 0x1;
+    reading->alarms.sensor_fraud_previously = alarms >> 9 & 0x1;
+    reading->alarms.mechanical_fraud_currently = alarms >> 10 & 0x1;
+    reading->alarms.mechanical_fraud_previously = alarms >> 11 & 0x1;
+    return 1;
+}
+
+/**
+ * @brief Frame a binary record with COBS and a 0x00 delimiter.
+ * @param uint8_t *buffer Where to store it, len + 2 bytes.
+ * @param uint8_t *record The record, less than 254 bytes.
+ * @param uint8_t len Its length.
+ * @retval uint8_t The length of the framed record, delimiter included.
+ */
+static uint8_t frameRecord(uint8_t * const buffer, const uint8_t * const record, const uint8_t len) {
+    /* COBS: every 0x00 becomes the distance to the next one */
+    uint8_t code_index = 0;
+    uint8_t length = 1;
+    for (uint8_t i = 0; i < len; ++i) {
+        if (record[i] == 0) {
+            buffer[code_index] = length - code_index;
+            code_index = length++;
+        } else {
+            buffer[length++] = record[i];
+        }
+    }
+    buffer[code_index] = length - code_index;
+    buffer[length++] = 0;
+    return length;
+}
+
+/**
+ * @brief Encode an entire IZAR reading as a binary record, framed with COBS
+ *        and a 0x00 delimiter, ready to be sent.
+ * @param uint8_t *buffer Where to store it, PRIOS_FRAMED_RECORD_MAX bytes.
+ * @param uint32_t A_Id The identifier of the device the reading was from.
+ * @param izar_reading *reading The reading to encode
+ * @retval uint8_t The length of the framed record, delimiter included.
+ */
+uint8_t frameIZARReadingAsRecord(uint8_t * const buffer, const uint32_t A_Id, const izar_reading * const reading) {
+    uint8_t record[PRIOS_RECORD_LEN];
+    encodeIZARReadingAsRecord(record, A_Id, reading);
+    return frameRecord(buffer, record, PRIOS_RECORD_LEN);
+}
+
+/**
+ * @brief Send an entire IZAR reading to the standard output device, as a
+ *        framed binary record.
+ * @param uint32_t A_Id The identifier of the device the reading was from.
+ * @param izar_reading *reading The reading to send
+ */
+void printIZARReadingAsRecord(const uint32_t A_Id, const izar_reading * const reading) {
+#if defined(__arm__) || defined(__ICCARM__)
+    /* Straight into the UART TX queue, if it has room for the longest record
+       before its end; otherwise, its overflow policy decides on the record */
+    tx_queue_span span;
+    if (tryReserveTxChars(PRIOS_FRAMED_RECORD_MAX, &span) && span.first_length >= PRIOS_FRAMED_RECORD_MAX) {
+        commitTxChars(frameIZARReadingAsRecord(span.first, A_Id, reading));
+        return;
+    }
+#endif
+    uint8_t buffer[PRIOS_FRAMED_RECORD_MAX];
+    uint8_t len = frameIZARReadingAsRecord(buffer, A_Id, reading);
+    writeOutput(buffer, len);
+}
+
+/**
+ * @brief Send an entire IZAR reading to the standard output device, in the
+ *        output mode selected at build time.
+ * @param uint32_t A_Id The identifier of the device the reading was from.
+ * @param izar_reading *reading The reading to send
+ */
+void printIZARReading(const uint32_t A_Id, const izar_reading * const reading) {
+#if PRIOS_OUTPUT_BINARY
+    printIZARReadingAsRecord(A_Id, reading);
+#else
+    printIZARReadingAsCSV(A_Id, reading);
+#endif
+}
+
+/**
+ * @brief Format a report of what was dropped so far as a CSV comment line,
+ *        "#dropped,<records>,<bytes>,<frames ring full>,<frames too long>".
+ * @param char *buffer Where to store the line, PRIOS_CSV_LINE_MAX bytes at
+ *        least. It is not NUL terminated.
+ * @param prios_drop_report *report What was dropped.
+ * @retval uint8_t The length of the line.
+ */
+uint8_t formatDropReportAsCSV(char * const buffer, const prios_drop_report * const report) {
+    static const char prefix[] = "#dropped,";
+    char *p = buffer;
+    memcpy(p, prefix, sizeof(prefix) - 1);
+    p += sizeof(prefix) - 1;
+    p = appendDecimal(p, report->records, 1);
+    *p++ = ',';
+    p = appendDecimal(p, report->bytes, 1);
+    *p++ = ',';
+    p = appendDecimal(p, report->frames_full, 1);
+    *p++ = ',';
+    p = appendDecimal(p, report->frames_oversize, 1);
+    *p++ = '\r';
+    *p++ = '\n';
+    return p - buffer;
+}
+
+/**
+ * @brief Encode a report of what was dropped so far as a binary record (see
+ *        PRIOS.h), framed with COBS and a 0x00 delimiter.
+ * @param uint8_t *buffer Where to store it, PRIOS_DROP_REPORT_LEN + 2 bytes.
+ * @param prios_drop_report *report What was dropped.
+ * @retval uint8_t The length of the framed record, delimiter included.
+ */
+uint8_t frameDropReportAsRecord(uint8_t * const buffer, const prios_drop_report * const report) {
+    uint8_t record[PRIOS_DROP_REPORT_LEN];
+    write_uint32_le(record, report->records);
+    write_uint32_le(record + 4, report->bytes);
+    write_uint32_le(record + 8, report->frames_full);
+    write_uint32_le(record + 12, report->frames_oversize);
+    uint16_t crc = ~crcUpdate(0, record, PRIOS_DROP_REPORT_LEN - 2);
+    record[PRIOS_DROP_REPORT_LEN - 2] = crc >> 8;
+    record[PRIOS_DROP_REPORT_LEN - 1] = crc;
+    return frameRecord(buffer, record, PRIOS_DROP_REPORT_LEN);
+}
+
+/**
+ * @brief Decode a drop report record, the reverse of frameDropReportAsRecord()
+ *        once unframed.
+ * @param uint8_t *record The record, PRIOS_DROP_REPORT_LEN bytes.
+ * @param prios_drop_report *report Where to store what was dropped.
+ * @retval uint8_t 0 if the CRC of the record is wrong, 1 otherwise.
+ */
+uint8_t decodeDropReport(const uint8_t * const record, prios_drop_report * const report) {
+    uint16_t crc = ~crcUpdate(0, record, PRIOS_DROP_REPORT_LEN - 2);
+    if (record[PRIOS_DROP_REPORT_LEN - 2] != (uint8_t) (crc >> 8) || record[PRIOS_DROP_REPORT_LEN - 1] != (uint8_t) crc) {
+        return 0;
+    }
+    report->records = read_uint32_le(record, 0);
+    report->bytes = read_uint32_le(record, 4);
+    report->frames_full = read_uint32_le(record, 8);
+    report->frames_oversize = read_uint32_le(record, 12);
+    return 1;
+}
+
+/**
+ * @brief Send a report of what was dropped so far to the standard output
+ *        device, in the output mode selected at build time.
+ * @param prios_drop_report *report What was dropped.
+ */
+void printDropReport(const prios_drop_report * const report) {
+#if PRIOS_OUTPUT_BINARY
+    uint8_t buffer[PRIOS_DROP_REPORT_LEN + 2];
+    uint8_t len = frameDropReportAsRecord(buffer, report);
+#else
+    char buffer[PRIOS_CSV_LINE_MAX];
+    uint8_t len = formatDropReportAsCSV(buffer, report);
+#endif
+    writeOutput((const uint8_t *) buffer, len);
+}
+
+/**
+  * @brief  Find the prepared key of a meter in the meter key table.
+  * @param  uint32_t A_Id The identifier of the meter.
+  * @param  uint32_t *prepared_key Where to store its prepared key.
+  * @retval uint8_t 1 if the meter is in the table, 0 otherwise.
+  */
+static uint8_t findPRIOSMeterKey(const uint32_t A_Id, uint32_t * const prepared_key) {
+    uint16_t low = 0;
+    uint16_t high = PRIOS_METER_KEY_COUNT;
+    while (low < high) {
+        uint16_t middle = low + (high - low) / 2;
+        if (PRIOS_METER_KEYS[middle].A_Id < A_Id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == PRIOS_METER_KEY_COUNT || PRIOS_METER_KEYS[low].A_Id != A_Id) {
+        return 0;
+    }
+    *prepared_key = PRIOS_METER_KEYS[low].prepared_key;
+    return 1;
+}
+
+#if PRIOS_KEY_FALLBACK_CACHE_SIZE > 0
+/* The meter ids, and 1 + the index of the default key that decoded them */
+static uint32_t keyFallbackCacheIds[PRIOS_KEY_FALLBACK_CACHE_SIZE];
+static uint8_t keyFallbackCacheKeys[PRIOS_KEY_FALLBACK_CACHE_SIZE];
+#endif
+
 /**
   * @brief Get the water metrics from a WMBus Prios frame.
+  *        The frame is decoded with the key of its meter in the meter key
+  *        table, or else with the default keys, the one that worked for the
+  *        meter before first.
   * @param uint8_t *payload The location of the WMBus frame
   * @param izar_reading *reading Where to store the extracted data
   */
 uint8_t getMetricsFromPRIOSWMBusFrame(const uint8_t * const frame, izar_reading * const reading) {
     /* Decode the payload */
-    uint32_t key = preparePRIOSKey(PRIOS_DEFAULT_KEY1);
+    const uint32_t A_Id = read_uint32_le(frame, 4);
     uint8_t decodedPayload[32];
-    uint8_t r = decodePRIOSPayload(frame, 26 - 15, key, decodedPayload);
+    uint32_t key;
+    uint8_t r = 0;
+    if (findPRIOSMeterKey(A_Id, &key)) {
+        r = decodePRIOSPayloadCached(frame, PRIOS_PAYLOAD_LEN, key, decodedPayload);
+    } else {
+        uint8_t tried = PRIOS_DEFAULT_KEY_COUNT;
+#if PRIOS_KEY_FALLBACK_CACHE_SIZE > 0
+        const uint32_t slot = ((A_Id * 2654435761u) >> 16) & (PRIOS_KEY_FALLBACK_CACHE_SIZE - 1);
+        if (keyFallbackCacheKeys[slot] && keyFallbackCacheIds[slot] == A_Id) {
+            tried = keyFallbackCacheKeys[slot] - 1;
+            r = decodePRIOSPayloadCached(frame, PRIOS_PAYLOAD_LEN, PRIOS_DEFAULT_PREPARED_KEYS[tried], decodedPayload);
+        }
+#endif
+        for (uint8_t i = 0; !r && i < PRIOS_DEFAULT_KEY_COUNT; ++i) {
+            if (i == tried) {
+                continue;
+            }
+            r = decodePRIOSPayloadCached(frame, PRIOS_PAYLOAD_LEN, PRIOS_DEFAULT_PREPARED_KEYS[i], decodedPayload);
+#if PRIOS_KEY_FALLBACK_CACHE_SIZE > 0
+            if (r) {
+                keyFallbackCacheIds[slot] = A_Id;
+                keyFallbackCacheKeys[slot] = i + 1;
+            }
+#endif
+        }
+    }
     if (!r) {
           return 0;
     }
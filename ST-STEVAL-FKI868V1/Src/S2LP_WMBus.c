@@ -17,78 +17,28 @@
 #include "SDK_UTILS_Timers.h"
 
 /* Application includes */
-#include "WMBus.h"
-#include "PRIOS.h"
+#include "FramePipeline.h"
+#include "FrameReceiver.h"
 #include "S2LP_WMBus_T1.h"
 
-/* Interruption related elements */
+/* Interruption related elements: the priority must stay lower than the one
+   of the SPI DMA interrupt (1, see S2LPSpiRaw()), see FrameReceiver.h */
 #define IRQ_PREEMPTION_PRIORITY         0x03
 S2LPIrqs xIrqStatus;
 
-/* Variable to hold the received data */
-uint8_t s2lpRxData[64];
-
 void S2LP_HandleGPIOInterrupt() {
-    /* Get the IRQ status */
-    S2LPGpioIrqGetStatus(&xIrqStatus);
-
-    /* Check the S2LP RX_DATA_DISC IRQ flag */
-    if(xIrqStatus.IRQ_RX_DATA_DISC) {
-        /* Uncomment this for debugging purposes */
-	//printf("DATA DISCARDED\n\r");
-
-	/* RX command - to ensure the device will be ready for the next reception */
-	S2LPCmdStrobeRx();
-    }
-
-    /* Check the S2LP RX_DATA_READY IRQ flag */
-    if(xIrqStatus.IRQ_RX_DATA_READY) {
-	/* Get the RX FIFO size */
-	uint8_t cRxData = S2LPFifoReadNumberBytesRxFifo();
-
-	/* Read the RX FIFO */
-	S2LPSpiReadFifo(cRxData, s2lpRxData);
-
-	/* Flush the RX FIFO */
-	S2LPCmdStrobeFlushRxFifo();
-
-	/* RX command - to ensure the device will be ready for the next reception */
-	S2LPCmdStrobeRx();
-
-        if (!(s2lpRxData[0] == 0x19 && s2lpRxData[1] == 0x44 && s2lpRxData[2] == 0x30 && s2lpRxData[3] == 0x4C)) {
-          /* Let's not waste time checking the whole frame or calculting CRCs if the 1st 4 bytes are not the ones we're looking for */
-          return;
-        }
-
-        /* Uncomment this for debugging purposes */
-        /*for (uint8_t i = 0; i<cRxData; i++) {
-            printf("%.2X ", s2lpRxData[i]);
-        }
-        printf("\r\n");*/
-
-        /* Let's see if we're dealing with a correct WMBus frame */
-        uint8_t LField;
-        uint8_t CField;
-        uint16_t MField;
-        uint32_t A_Id;
-        uint8_t A_Ver;
-        uint8_t A_Type;
-        uint8_t isMBusFrame = CheckWMBusFrame(s2lpRxData, cRxData, &LField, &CField, &MField, &A_Id, &A_Ver, &A_Type);
-        if (!isMBusFrame) {
-            return;
-        }
-        
-        /* The frame is an IZAR meter reporting data, let's handle it */
-        if (LField == 0x19 && CField == 0x44 && MField == 0x4C30 && A_Ver == 0xD4 && A_Type == 0x01) {
-            izar_reading reading;
-            if (!getMetricsFromPRIOSWMBusFrame(s2lpRxData, &reading)) {
-                return;
-            }
-            
-            /* Output the data on the COM port */
-            printIZARReadingAsCSV(A_Id, &reading);
-        }
-    }
+    /* Read the IRQ status, then, for a frame, the RX FIFO into the next free
+       slot of the ring, if any, for the main loop, then flush it and go back
+       to RX, all from the SPI interrupt */
+    frameReceiverOnIrq(&rxFrameReceiver);
+}
+
+/**
+  * @brief End of a non blocking SPI transfer, from the SPI DMA interrupt: go
+  *        on with the IRQ of the radio.
+  */
+void SdkEvalSpiRawTC(void) {
+    frameReceiverOnTransferComplete(&rxFrameReceiver);
 }
 
 /**
@@ -11,11 +11,14 @@
 
 /* Application includes */
 #include "WMBus.h"
+#include "WMBus_CRCTables.h"
 
 #define CRC_POLYNOM			0x3D65
    
 /**
-* @brief  Calculates the 16-bit CRC. The function requires that the CRC_POLYNOM is defined,
+* @brief  Calculates the 16-bit CRC, one bit at a time. This is the reference
+*         for the table-driven implementations of crcUpdate().
+*         The function requires that the CRC_POLYNOM is defined,
 *           which gives the wanted CRC polynom.
 * @param  Input Param:uint8  crcData  - Data to perform the CRC-16 operation on.
 *                     uint16 crcReg   - Current or initial value of the CRC calculation
@@ -41,20 +44,61 @@ uint16_t crcCalc(uint16_t crcReg, uint8_t crcData) {
 
 
 /**
-* @brief  Calculates the 16-bit CRC.
-* @param  Input Param:uint8  crcData  - Data to perform the CRC-16 operation on.
-*                     uint16 crcReg   - Current or initial value of the CRC calculation
-* @retval LINK_STATUS : LINK_STATUS_SUCCESS
-*       LINK_STATUS_INVALID_SIZE   - The data-field buffer is too large
-*
+* @brief  Feeds a buffer to the 16-bit CRC, with the implementation selected
+*         by WMBUS_CRC_IMPL. Same result as crcCalc() on every byte.
+* @param  uint16_t crcReg Current or initial value of the CRC calculation
+* @param  const uint8_t *data The bytes to perform the CRC-16 operation on
+* @param  uint16_t len The number of bytes
+* @retval uint16_t The new value of the CRC calculation
 */
-uint8_t CRCCheck(const uint8_t * pStart, const uint8_t * const pStop) {
-  uint16_t  seed=0x0000;
+uint16_t crcUpdate(uint16_t crcReg, const uint8_t *data, uint16_t len) {
+#if WMBUS_CRC_IMPL == WMBUS_CRC_SLICE8
+  /* The register folds into the first two bytes, then each byte goes
+     through the table of the number of bytes following it */
+  while (len >= 8) {
+    uint16_t head = crcReg ^ (data[0] << 8 | data[1]);
+    crcReg = crcTable[7][head >> 8] ^ crcTable[6][head & 0xFF]
+           ^ crcTable[5][data[2]] ^ crcTable[4][data[3]]
+           ^ crcTable[3][data[4]] ^ crcTable[2][data[5]]
+           ^ crcTable[1][data[6]] ^ crcTable[0][data[7]];
+    data += 8;
+    len -= 8;
+  }
+#endif
+#if WMBUS_CRC_IMPL == WMBUS_CRC_SLICE4 || WMBUS_CRC_IMPL == WMBUS_CRC_SLICE8
+  while (len >= 4) {
+    uint16_t head = crcReg ^ (data[0] << 8 | data[1]);
+    crcReg = crcTable[3][head >> 8] ^ crcTable[2][head & 0xFF]
+           ^ crcTable[1][data[2]] ^ crcTable[0][data[3]];
+    data += 4;
+    len -= 4;
+  }
+#endif
 
-  while (pStart != pStop) {
-      seed = crcCalc(seed, *pStart);
-      pStart++;
+  while (len--) {
+#if WMBUS_CRC_IMPL == WMBUS_CRC_BITWISE
+    crcReg = crcCalc(crcReg, *data);
+#elif WMBUS_CRC_IMPL == WMBUS_CRC_NIBBLE
+    crcReg = (crcReg << 4) ^ crcNibbleTable[(crcReg >> 12) ^ (*data >> 4)];
+    crcReg = (crcReg << 4) ^ crcNibbleTable[(crcReg >> 12) ^ (*data & 0x0F)];
+#else
+    crcReg = (crcReg << 8) ^ crcTable[0][(crcReg >> 8) ^ *data];
+#endif
+    data++;
   }
+
+  return crcReg;
+}
+
+/**
+* @brief  Checks the 16-bit CRC of a block.
+* @param  const uint8_t *pStart The first byte of the block
+* @param  const uint8_t *pStop The end of the block, where its CRC is stored
+* @retval uint8_t 1 if the CRC matches, 0 otherwise
+*/
+uint8_t CRCCheck(const uint8_t * pStart, const uint8_t * const pStop) {
+  uint16_t  seed = crcUpdate(0x0000, pStart, pStop - pStart);
+
   seed =~seed;
   if((pStop[0]  == (uint8_t)(seed>>8))&&(pStop[1]  == (uint8_t)(seed))) {
       return 1;
@@ -96,6 +140,10 @@ uint8_t CheckWMBusFrame(const uint8_t *frame, const uint8_t len, uint8_t * const
     }
 
     if((len-12)%18!=0) {
+        if ((len-12)%18 < 2) {
+            /* Not even room for the CRC of the last block */
+            return 0;
+        }
         crc &= CRCCheck(&frame[len-((len-12)%18)], &frame[len-2]);
         if (!crc) {
             return 0;
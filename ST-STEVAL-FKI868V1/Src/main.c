@@ -17,6 +17,9 @@
 #include "SDK_EVAL_Com.h"
 #include "S2LP_WMBus.h"
 #include "S2LP_Middleware_Config.h"
+#include "FramePipeline.h"
+#include "FrameReceiver.h"
+#include "PRIOS.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -26,6 +29,8 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
+/* How often to report the output the serial link had to drop, if any */
+#define DROP_REPORT_PERIOD_MS 60000
 
 /* USER CODE END PD */
 
@@ -52,6 +57,32 @@ void SystemClock_Config(void);
 
 uint32_t M2S_GPIO_PIN_IRQ;
 
+/**
+  * @brief  Report the records the UART TX queue dropped, and the frames the
+  *         frame ring did, once a period, if either dropped more since the
+  *         last report. A report can be dropped too, then the next one
+  *         covers it.
+  */
+static void reportOutputDrops(void) {
+  static uint32_t lastReportTick = 0;
+  static prios_drop_report lastReport = {0};
+  uint32_t now = HAL_GetTick();
+  if (now - lastReportTick < DROP_REPORT_PERIOD_MS) {
+    return;
+  }
+  lastReportTick = now;
+
+  prios_drop_report report;
+  SdkEvalComGetTxDrops(&report.records, &report.bytes);
+  report.frames_full = rxFrameRing.dropped_full;
+  report.frames_oversize = rxFrameRing.dropped_oversize;
+  if (report.records != lastReport.records || report.frames_full != lastReport.frames_full
+      || report.frames_oversize != lastReport.frames_oversize) {
+    lastReport = report;
+    printDropReport(&report);
+  }
+}
+
 void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
   if(GPIO_Pin == M2S_GPIO_PIN_IRQ) {
     S2LP_HandleGPIOInterrupt();
@@ -82,6 +113,10 @@ int main(void) {
 
   /* USER CODE BEGIN SysInit */
   SdkEvalComInit();
+
+  /* Empty the ring of received frames before the radio can fill it */
+  frameRingInit(&rxFrameRing);
+  frameReceiverInit(&rxFrameReceiver, &rxFrameRing);
   
   /* Configure the link between the main board and the S2-LP board */
   S2LP_ConfigureSlaveBoardLink(&M2S_GPIO_PIN_IRQ);
@@ -107,6 +142,11 @@ int main(void) {
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
+    /* Decode and output the frames the radio interrupt received */
+    processPendingFrames(&rxFrameRing);
+
+    /* Tell the host what the serial link couldn't keep up with */
+    reportOutputDrops();
   }
   /* USER CODE END 3 */
 }